@@ -19,6 +19,19 @@ namespace snmalloc
     using GlobalMetaRange = typename LocalState::GlobalMetaRange;
     using Stats = typename LocalState::Stats;
 
+    /**
+     * Incremented each time the platform reports that memory is low.
+     * Allocators compare it against the last value they saw when they tick.
+     */
+    static inline stl::Atomic<uint64_t> low_memory_epoch_{0};
+
+    static void low_memory(PalNotificationObject*)
+    {
+      low_memory_epoch_++;
+    }
+
+    static inline PalNotificationObject low_memory_notification{&low_memory};
+
   public:
     using Pal = PAL;
     using SlabMetadata = typename PagemapEntry::SlabMetadata;
@@ -185,6 +198,68 @@ namespace snmalloc
       local_state.get_object_range()->dealloc_range(arena, size);
     }
 
+    /**
+     * Resize the chunk of `old_size` at `alloc` to `new_size` without moving
+     * it.  Both sizes are powers of two and `alloc` is aligned to the larger.
+     *
+     * Growing takes the free buddies of the chunk from the local caches,
+     * doubling its size each time, and fails if any of them is not free.
+     * Shrinking returns the tail of the chunk as buddy blocks.  On success
+     * the pagemap entries for the chunk are set to `ras` and `slab_metadata`.
+     */
+    static bool resize_chunk(
+      LocalState& local_state,
+      SlabMetadata& slab_metadata,
+      capptr::Alloc<void> alloc,
+      size_t old_size,
+      size_t new_size,
+      uintptr_t ras)
+    {
+      SNMALLOC_ASSERT(bits::is_pow2(old_size) && bits::is_pow2(new_size));
+      SNMALLOC_ASSERT(old_size >= MIN_CHUNK_SIZE);
+      SNMALLOC_ASSERT(new_size >= MIN_CHUNK_SIZE);
+      SNMALLOC_ASSERT(
+        (address_cast(alloc) & (bits::max(old_size, new_size) - 1)) == 0);
+
+      capptr::Arena<void> arena = Authmap::amplify(alloc);
+      auto object_range = local_state.get_object_range();
+
+      if (new_size > old_size)
+      {
+        size_t size = old_size;
+        for (; size < new_size; size *= 2)
+        {
+          if (!local_state.claim_buddy(arena, size))
+            break;
+        }
+
+        if (size < new_size)
+        {
+          // Give back the buddies taken so far.
+          while (size > old_size)
+          {
+            size /= 2;
+            object_range->dealloc_range(pointer_offset(arena, size), size);
+          }
+          return false;
+        }
+      }
+      else
+      {
+        typename Pagemap::Entry t(nullptr, 0);
+        t.claim_for_backend();
+        Pagemap::set_metaentry(
+          address_cast(alloc) + new_size, old_size - new_size, t);
+
+        for (size_t size = new_size; size < old_size; size *= 2)
+          object_range->dealloc_range(pointer_offset(arena, size), size);
+      }
+
+      typename Pagemap::Entry t(&slab_metadata, ras);
+      Pagemap::set_metaentry(address_cast(alloc), new_size, t);
+      return true;
+    }
+
     SNMALLOC_FAST_PATH static capptr::Alloc<void>
     capptr_rederive_alloc(capptr::Alloc<void> a, size_t objsize)
     {
@@ -199,6 +274,54 @@ namespace snmalloc
       return Pagemap::template get_metaentry<potentially_out_of_range>(p);
     }
 
+    /**
+     * Ask the platform to report low memory, if it can.  Should be called
+     * once during initialisation.
+     */
+    static void register_for_low_memory()
+    {
+      if constexpr (pal_supports<LowMemoryNotification, PAL>)
+      {
+        PAL::register_for_low_memory_callback(&low_memory_notification);
+      }
+    }
+
+    /**
+     * Number of low-memory notifications received so far.
+     */
+    static uint64_t low_memory_epoch()
+    {
+      return low_memory_epoch_.load(stl::memory_order_relaxed);
+    }
+
+    /**
+     * Return the memory cached in `local_state` to the shared ranges, which
+     * decommit it.
+     */
+    static void release_cached_memory(LocalState& local_state)
+    {
+      local_state.release_cached_memory();
+    }
+
+    /**
+     * Called periodically with the current time.  Decommits the memory in
+     * `local_state` that has gone unused for about `period_ms`.
+     */
+    static void decay_cached_memory(
+      LocalState& local_state, uint64_t now_ms, uint64_t period_ms)
+    {
+      local_state.decay_cached_memory(now_ms, period_ms);
+    }
+
+    /**
+     * Allocate from the memory of NUMA node `node` for `local_state` from now
+     * on.
+     */
+    static void bind_to_node(LocalState& local_state, size_t node)
+    {
+      local_state.bind_to_node(node);
+    }
+
     static size_t get_current_usage()
     {
       Stats stats_state;
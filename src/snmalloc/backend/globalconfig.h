@@ -18,23 +18,29 @@ namespace snmalloc
    *   LocalState - the per-thread/per-allocator state that may perform local
    *     caching of reserved memory. This also specifies the various Range types
    *     used to manage the memory.
+   *   RemoteQueue - the transport for messages between allocators; see
+   *     remoteallocator.h.
    *
    * The Configuration sets up a Pagemap for the backend to use, and the state
    * required to build new allocators (GlobalPoolState).
    */
   template<
     typename ClientMetaDataProvider = NoClientMetaDataProvider,
-    typename SecondaryAllocator_ = DefaultSecondaryAllocator>
+    typename SecondaryAllocator_ = DefaultSecondaryAllocator,
+    typename RemoteQueue_ = DefaultRemoteQueue>
   class StandardConfigClientMeta final : public CommonConfig
   {
-    using GlobalPoolState = PoolState<Allocator<
-      StandardConfigClientMeta<ClientMetaDataProvider, SecondaryAllocator_>>>;
+    using GlobalPoolState = PoolState<Allocator<StandardConfigClientMeta<
+      ClientMetaDataProvider,
+      SecondaryAllocator_,
+      RemoteQueue_>>>;
 
   public:
     using Pal = DefaultPal;
     using PagemapEntry = DefaultPagemapEntry<ClientMetaDataProvider>;
     using ClientMeta = ClientMetaDataProvider;
     using SecondaryAllocator = SecondaryAllocator_;
+    using RemoteQueue = RemoteQueue_;
 
   private:
     using ConcretePagemap =
@@ -129,6 +135,8 @@ namespace snmalloc
           Authmap::init();
         }
 
+        Backend::register_for_low_memory();
+
         initialised.store(true, stl::memory_order_release);
       });
     }
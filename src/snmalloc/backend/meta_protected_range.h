@@ -18,8 +18,8 @@ namespace snmalloc
    *
    * MinSizeBits is the minimum request size that can be passed to Base.
    * On Windows this 16 as VirtualAlloc cannot reserve less than 64KiB.
-   * Alternative configurations might make this 2MiB so that huge pages
-   * can be used.
+   * If the PAL backs memory with huge pages this is at least the huge page
+   * size, and memory is committed and decommitted in whole huge pages.
    */
   template<
     typename PAL,
@@ -44,12 +44,12 @@ namespace snmalloc
       bits::next_pow2_bits_const(PAL::page_size);
 
     static constexpr size_t max_page_chunk_size_bits =
-      bits::max(page_size_bits, MIN_CHUNK_BITS);
+      bits::max(CommitSizeBits<PAL>(), MIN_CHUNK_BITS);
 
     // Central source of object-range, does not pass back to GlobalR as
     // that would allow flows from Objects to Meta-data, and thus UAF
     // would be able to corrupt meta-data.
-    using CentralObjectRange = Pipe<
+    using CentralObjectStats = Pipe<
       GlobalR,
       LargeBuddyRange<GlobalCacheSizeBits, bits::BITS - 1, Pagemap>,
       LogRange<3>,
@@ -57,6 +57,23 @@ namespace snmalloc
       CommitRange<PAL>,
       StatsRange>;
 
+    using CentralObjectRange = Pipe<
+      CentralObjectStats,
+      // With huge pages, hold the free parts of partly used huge pages here
+      // so that only whole huge pages are decommitted.
+      stl::conditional_t<
+        (max_page_chunk_size_bits > MIN_CHUNK_BITS),
+        LargeBuddyRange<
+          max_page_chunk_size_bits,
+          max_page_chunk_size_bits,
+          Pagemap,
+          max_page_chunk_size_bits>,
+        NopRange>,
+      stl::conditional_t<
+        (max_page_chunk_size_bits > MIN_CHUNK_BITS),
+        GlobalRange,
+        NopRange>>;
+
     // Controls the padding around the meta-data range.
     // The larger the padding range the more randomisation that
     // can be used.
@@ -87,15 +104,21 @@ namespace snmalloc
       GlobalRange,
       StatsRange>;
 
+    // Local store of freed object range, returned to CentralObjectRange
+    // once it has gone unused for a while.
+    using LocalObjectDecay =
+      Pipe<CentralObjectRange, DecayRange<GlobalCacheSizeBits, Pagemap>>;
+
     // Local caching of object range
-    using ObjectRange = Pipe<
-      CentralObjectRange,
+    using LocalObjectCache = Pipe<
+      LocalObjectDecay,
       LargeBuddyRange<
         LocalCacheSizeBits,
         LocalCacheSizeBits,
         Pagemap,
-        page_size_bits>,
-      LogRange<5>>;
+        page_size_bits>>;
+
+    using ObjectRange = Pipe<LocalObjectCache, LogRange<5>>;
 
     // Local caching of meta-data range
     using MetaRange = Pipe<
@@ -111,7 +134,7 @@ namespace snmalloc
     MetaRange meta_range;
 
   public:
-    using Stats = StatsCombiner<CentralObjectRange, CentralMetaRange>;
+    using Stats = StatsCombiner<CentralObjectStats, CentralMetaRange>;
 
     ObjectRange* get_object_range()
     {
@@ -123,6 +146,48 @@ namespace snmalloc
       return meta_range;
     }
 
+    /**
+     * Decommit the object memory cached by this thread.  The local metadata
+     * cache has no parent to return memory to.
+     */
+    void release_cached_memory()
+    {
+      object_range.template ancestor<LocalObjectCache>()->release_all();
+      object_range.template ancestor<LocalObjectDecay>()->release_all();
+    }
+
+    /**
+     * Object and metadata ranges are shared by all NUMA nodes.
+     */
+    void bind_to_node(size_t) {}
+
+    /**
+     * Take the free buddy of the in-use chunk at `base` of `size` from this
+     * thread's object caches, so that the chunk can grow in place.
+     */
+    bool claim_buddy(capptr::Arena<void> base, size_t size)
+    {
+      return object_range.template ancestor<LocalObjectCache>()->claim_buddy(
+               base, size) ||
+        object_range.template ancestor<LocalObjectDecay>()->claim_buddy(
+          base, size);
+    }
+
+    /**
+     * Called periodically.  Decommits object memory this thread has not used
+     * for between one and two periods of `period_ms`.
+     */
+    void decay_cached_memory(uint64_t now_ms, uint64_t period_ms)
+    {
+      auto decay = object_range.template ancestor<LocalObjectDecay>();
+      if (!decay->should_decay(now_ms, period_ms))
+        return;
+
+      // The buddy cache's free blocks start ageing too.
+      object_range.template ancestor<LocalObjectCache>()->release_all();
+      decay->decay(now_ms);
+    }
+
     // Create global range that can service small meta-data requests.
     // Don't want to add the SmallBuddyRange to the CentralMetaRange as that
     // would require committing memory inside the main global lock.
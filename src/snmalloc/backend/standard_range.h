@@ -16,8 +16,8 @@ namespace snmalloc
    *
    * MinSizeBits is the minimum request size that can be passed to Base.
    * On Windows this 16 as VirtualAlloc cannot reserve less than 64KiB.
-   * Alternative configurations might make this 2MiB so that huge pages
-   * can be used.
+   * If the PAL backs memory with huge pages this is at least the huge page
+   * size, and memory is committed and decommitted in whole huge pages.
    */
   template<
     typename PAL,
@@ -26,6 +26,14 @@ namespace snmalloc
     size_t MinSizeBits = MinBaseSizeBits<PAL>()>
   struct StandardLocalState : BaseLocalStateConstants
   {
+  private:
+    static constexpr bool numa_aware = pal_supports<NumaAware, PAL>;
+
+    // If NUMA aware, each node has its own copy of the shared ranges, so
+    // they are locked but not global.
+    using SharedRange = stl::conditional_t<numa_aware, LockRange, GlobalRange>;
+
+  public:
     // Global range of memory, expose this so can be filled by init.
     using GlobalR = Pipe<
       Base,
@@ -35,27 +43,62 @@ namespace snmalloc
         Pagemap,
         MinSizeBits>,
       LogRange<2>,
-      GlobalRange>;
+      SharedRange>;
+
+  private:
+    static constexpr size_t commit_size_bits = CommitSizeBits<PAL>();
+
+    static constexpr bool commit_whole_chunks =
+      commit_size_bits <= MIN_CHUNK_BITS;
+
+    // Holds the free parts of partly used huge pages, so that only whole
+    // huge pages are decommitted.  Shared, so that threads do not each
+    // commit a huge page of their own.
+    using CommitCache = stl::conditional_t<
+      commit_whole_chunks,
+      NopRange,
+      LargeBuddyRange<
+        commit_size_bits,
+        commit_size_bits,
+        Pagemap,
+        commit_size_bits>>;
 
+  public:
     // Track stats of the committed memory
     using Stats = Pipe<GlobalR, CommitRange<PAL>, StatsRange>;
 
   private:
+    using Committed = Pipe<
+      Stats,
+      CommitCache,
+      stl::conditional_t<commit_whole_chunks, NopRange, SharedRange>,
+      stl::conditional_t<numa_aware, NumaRange<PAL>, NopRange>>;
+
     static constexpr size_t page_size_bits =
       bits::next_pow2_bits_const(PAL::page_size);
 
+    // Thread local store of committed memory that is returned to Stats
+    // once it has gone unused for a while.
+    using LocalDecay = DecayRange<GlobalCacheSizeBits, Pagemap>;
+
+    // Thread local cache of committed memory.
+    using LocalCache = LargeBuddyRange<
+      LocalCacheSizeBits,
+      LocalCacheSizeBits,
+      Pagemap,
+      page_size_bits>;
+
   public:
     // Source for object allocations and metadata
     // Use buddy allocators to cache locally.
-    using LargeObjectRange = Pipe<
-      Stats,
-      StaticConditionalRange<LargeBuddyRange<
-        LocalCacheSizeBits,
-        LocalCacheSizeBits,
-        Pagemap,
-        page_size_bits>>>;
+    using LargeObjectRange =
+      Pipe<Committed, StaticConditionalRange<LocalDecay, LocalCache>>;
 
   private:
+    // The thread local caches, for reaching past the conditional range.
+    using DecayR = Pipe<Committed, LocalDecay>;
+    using CacheR = Pipe<DecayR, LocalCache>;
+
     using ObjectRange = Pipe<LargeObjectRange, SmallBuddyRange>;
 
     ObjectRange object_range;
@@ -86,6 +129,59 @@ namespace snmalloc
       return object_range;
     }
 
+    /**
+     * Decommit the memory cached by this thread.
+     */
+    void release_cached_memory()
+    {
+      object_range.template ancestor<CacheR>()->release_all();
+      object_range.template ancestor<DecayR>()->release_all();
+    }
+
+    /**
+     * Take the free buddy of the in-use chunk at `base` of `size` from this
+     * thread's caches, so that the chunk can grow in place.
+     */
+    bool claim_buddy(capptr::Arena<void> base, size_t size)
+    {
+      auto cache = object_range.template ancestor<CacheR>();
+      auto decay = object_range.template ancestor<DecayR>();
+      return cache->claim_buddy(base, size) || decay->claim_buddy(base, size);
+    }
+
+    /**
+     * Called periodically.  Decommits memory this thread has not used for
+     * between one and two periods of `period_ms`.
+     */
+    void decay_cached_memory(uint64_t now_ms, uint64_t period_ms)
+    {
+      auto decay = object_range.template ancestor<DecayR>();
+      if (!decay->should_decay(now_ms, period_ms))
+        return;
+
+      // The buddy cache's free blocks start ageing too.
+      object_range.template ancestor<CacheR>()->release_all();
+      decay->decay(now_ms);
+    }
+
+    /**
+     * Allocate from `node`'s memory from now on.
+     */
+    void bind_to_node(size_t node)
+    {
+      if constexpr (numa_aware)
+      {
+        // Cached memory was handed out for the previous node, and goes back
+        // to it.
+        if (object_range.template ancestor<Committed>()->set_node(node))
+          release_cached_memory();
+      }
+      else
+      {
+        UNUSED(node);
+      }
+    }
+
     static void set_small_heap()
     {
       // This disables the thread local caching of large objects.
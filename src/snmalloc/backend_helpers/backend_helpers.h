@@ -3,6 +3,7 @@
 #include "buddy.h"
 #include "commitrange.h"
 #include "commonconfig.h"
+#include "decayrange.h"
 #include "defaultpagemapentry.h"
 #include "empty_range.h"
 #include "globalrange.h"
@@ -10,6 +11,7 @@
 #include "largebuddyrange.h"
 #include "logrange.h"
 #include "noprange.h"
+#include "numarange.h"
 #include "pagemap.h"
 #include "pagemapregisterrange.h"
 #include "palrange.h"
@@ -150,6 +150,24 @@ namespace snmalloc
       return Rep::null;
     }
 
+    /**
+     * Removes the buddy of the block at `addr` of `size`, if the buddy is
+     * held here as a single free block.  The block at `addr` itself is
+     * assumed to be in use.
+     *
+     * Returns true if the buddy was removed and now belongs to the caller.
+     */
+    bool remove_buddy_of(typename Rep::Contents addr, size_t size)
+    {
+      if (size >= bits::one_at_bit(MAX_SIZE_BITS))
+        return false;
+
+      validate_block(addr, size);
+      bool removed = remove_buddy(addr, size);
+      invariant();
+      return removed;
+    }
+
     /**
      * Removes a block of size from the buddy allocator.
      *
@@ -68,9 +68,32 @@ namespace snmalloc
      */
     bool HasDomesticate = false;
 
-    // const uint32_t block_num = 16;
-    // const uint32_t block_size = 4096;
-    ;
+    /**
+     * Budget for each pass over the message queue made on an allocation
+     * slow path.  A pass stops after the first message that exhausts any of
+     * these; whatever is left, including the rest of a partially consumed
+     * list, is picked up by the next pass.  Zero disables the message and
+     * tick limits.
+     *
+     * `RemoteDrainTicks` is measured with `Aal::tick()`, sampled every few
+     * messages, so it bounds the time spent to within a few deallocations.
+     * @{
+     */
+    size_t RemoteDrainBytes = REMOTE_BATCH_LIMIT;
+    size_t RemoteDrainMessages = 0;
+    uint64_t RemoteDrainTicks = 0;
+    ///@}
+
+    /**
+     * Free memory that an allocator's backend state has cached is kept
+     * committed, ready for reuse, until it has gone unused for between one
+     * and two periods of this many milliseconds.  It is then decommitted in
+     * as few, large ranges as possible.  The check is made when the allocator
+     * queries the clock, so an allocator that is not being used keeps its
+     * cache until `cleanup_unused` or a low-memory notification.  Zero
+     * decommits cached memory at the first opportunity.
+     */
+    uint64_t CacheDecayMs = 10000;
   };
 
   struct NoClientMetaDataProvider
@@ -122,19 +145,47 @@ namespace snmalloc
      */
     SNMALLOC_REQUIRE_CONSTINIT
     inline static RemoteAllocator unused_remote{};
+
+    /**
+     * The transport for remote deallocations.  A configuration may shadow
+     * this with `FreeListRemoteQueue` or a `BBQRemoteQueue` instantiation.
+     */
+    using RemoteQueue = DefaultRemoteQueue;
   };
 
+  /**
+   * The granularity at which memory is committed and decommitted: a page, or
+   * a huge page if the PAL backs memory with them, as decommitting part of a
+   * huge page would split it.
+   */
+  template<typename PAL>
+  static constexpr size_t CommitSizeBits()
+  {
+    if constexpr (pal_supports<HugePages, PAL>)
+    {
+      return bits::next_pow2_bits_const(PAL::huge_page_size);
+    }
+    else
+    {
+      return bits::next_pow2_bits_const(PAL::page_size);
+    }
+  }
+
   template<typename PAL>
   static constexpr size_t MinBaseSizeBits()
   {
+    size_t result = MIN_CHUNK_BITS;
     if constexpr (pal_supports<AlignedAllocation, PAL>)
     {
-      return bits::next_pow2_bits_const(PAL::minimum_alloc_size);
+      result = bits::next_pow2_bits_const(PAL::minimum_alloc_size);
     }
-    else
+
+    // Request whole huge pages from the platform.
+    if constexpr (pal_supports<HugePages, PAL>)
     {
-      return MIN_CHUNK_BITS;
+      result = bits::max(result, CommitSizeBits<PAL>());
     }
+    return result;
   }
 } // namespace snmalloc
 
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "../ds/ds.h"
+#include "../mem/mem.h"
+#include "buddy.h"
+#include "empty_range.h"
+#include "largebuddyrange.h"
+#include "range_helpers.h"
+
+namespace snmalloc
+{
+  /**
+   * Holds on to freed memory for a while before returning it to the parent,
+   * so that memory that is freed and soon reused is not decommitted and then
+   * faulted back in.
+   *
+   * Freed blocks go into the current generation.  Once a period has passed,
+   * `decay` returns the older generation to the parent and makes the current
+   * generation the older one.  A block that is not reused is therefore
+   * returned between one and two periods after it was freed.  Allocations
+   * are served from either generation before going to the parent.
+   *
+   * Each generation is a buddy allocator, so neighbouring blocks are
+   * consolidated and the parent is handed a few large blocks rather than
+   * many small ones.
+   *
+   * MAX_SIZE_BITS - Blocks of this size or larger are passed straight to
+   * the parent.
+   *
+   * Pagemap - How to access the pagemap, which is used to store the red black
+   * tree nodes for the buddy allocators.
+   */
+  template<size_t MAX_SIZE_BITS, SNMALLOC_CONCEPT(IsWritablePagemap) Pagemap>
+  struct DecayRange
+  {
+    template<typename ParentRange = EmptyRange<>>
+    class Type : public ContainsParent<ParentRange>
+    {
+      using ContainsParent<ParentRange>::parent;
+
+      using Generation =
+        Buddy<BuddyChunkRep<Pagemap>, MIN_CHUNK_BITS, MAX_SIZE_BITS>;
+
+      /**
+       * The current and older generations, indexed by `current`.
+       */
+      Generation generations[2];
+
+      size_t current = 0;
+
+      /**
+       * Time of the last generation change.
+       */
+      uint64_t last_decay_ms = 0;
+
+      void dealloc_overflow(uintptr_t overflow)
+      {
+        if (overflow != 0)
+        {
+          parent.dealloc_range(
+            capptr::Arena<void>::unsafe_from(reinterpret_cast<void*>(overflow)),
+            bits::one_at_bit(MAX_SIZE_BITS));
+        }
+      }
+
+      /**
+       * Return every block in `generation` to the parent, largest first so
+       * that no block is split on the way out.
+       */
+      void release(Generation& generation)
+      {
+        for (size_t size_bits = MAX_SIZE_BITS; size_bits > MIN_CHUNK_BITS;)
+        {
+          size_bits--;
+          size_t size = bits::one_at_bit(size_bits);
+          while (true)
+          {
+            auto block = generation.remove_block(size);
+            if (block == 0)
+              break;
+            parent.dealloc_range(
+              capptr::Arena<void>::unsafe_from(reinterpret_cast<void*>(block)),
+              size);
+          }
+        }
+      }
+
+    public:
+      static constexpr bool Aligned = true;
+
+      static constexpr bool ConcurrencySafe = false;
+
+      using ChunkBounds = capptr::bounds::Arena;
+      static_assert(
+        stl::is_same_v<typename ParentRange::ChunkBounds, ChunkBounds>);
+
+      constexpr Type() = default;
+
+      capptr::Arena<void> alloc_range(size_t size)
+      {
+        SNMALLOC_ASSERT(size >= MIN_CHUNK_SIZE);
+        SNMALLOC_ASSERT(bits::is_pow2(size));
+
+        if (size < bits::one_at_bit(MAX_SIZE_BITS))
+        {
+          // Prefer the more recently freed memory.
+          for (size_t i = 0; i < 2; i++)
+          {
+            auto block = generations[current ^ i].remove_block(size);
+            if (block != 0)
+              return capptr::Arena<void>::unsafe_from(
+                reinterpret_cast<void*>(block));
+          }
+        }
+
+        return parent.alloc_range(size);
+      }
+
+      void dealloc_range(capptr::Arena<void> base, size_t size)
+      {
+        SNMALLOC_ASSERT(size >= MIN_CHUNK_SIZE);
+        SNMALLOC_ASSERT(bits::is_pow2(size));
+
+        if (size >= bits::one_at_bit(MAX_SIZE_BITS))
+        {
+          parent.dealloc_range(base, size);
+          return;
+        }
+
+        dealloc_overflow(
+          generations[current].add_block(base.unsafe_uintptr(), size));
+      }
+
+      /**
+       * Take the buddy of the in-use block at `base` of `size` from either
+       * generation, so that the block can grow in place.
+       */
+      bool claim_buddy(capptr::Arena<void> base, size_t size)
+      {
+        for (size_t i = 0; i < 2; i++)
+        {
+          if (generations[current ^ i].remove_buddy_of(
+                base.unsafe_uintptr(), size))
+            return true;
+        }
+        return false;
+      }
+
+      /**
+       * Has at least `period_ms` passed since the last call to `decay`?
+       */
+      bool should_decay(uint64_t now_ms, uint64_t period_ms) const
+      {
+        return (now_ms - last_decay_ms) >= period_ms;
+      }
+
+      /**
+       * Return the older generation to the parent and start a new one.
+       */
+      void decay(uint64_t now_ms)
+      {
+        last_decay_ms = now_ms;
+        current ^= 1;
+        release(generations[current]);
+      }
+
+      /**
+       * Return everything held to the parent.
+       */
+      void release_all()
+      {
+        release(generations[0]);
+        release(generations[1]);
+      }
+    };
+  };
+} // namespace snmalloc
@@ -388,6 +388,42 @@ namespace snmalloc
             buddy_large.add_block(base.unsafe_uintptr(), size)));
         dealloc_overflow(overflow);
       }
+
+      /**
+       * Take the buddy of the in-use block at `base` of `size`, so that the
+       * block can grow in place to twice its size.  Returns false if the
+       * buddy is not held here as a single free block.
+       */
+      bool claim_buddy(capptr::Arena<void> base, size_t size)
+      {
+        return buddy_large.remove_buddy_of(base.unsafe_uintptr(), size);
+      }
+
+      /**
+       * Return every cached block to the parent range, largest first so that
+       * no block is split on the way out.  The refill heuristic starts again
+       * from the minimum, so the cache regrows gradually.
+       *
+       * Only available when the parent supports deallocation.
+       */
+      template<bool exists = MAX_SIZE_BITS != (bits::BITS - 1)>
+      stl::enable_if_t<exists> release_all()
+      {
+        for (size_t size_bits = MAX_SIZE_BITS; size_bits > MIN_CHUNK_BITS;)
+        {
+          size_bits--;
+          size_t size = bits::one_at_bit(size_bits);
+          while (true)
+          {
+            auto block = capptr::Arena<void>::unsafe_from(
+              reinterpret_cast<void*>(buddy_large.remove_block(size)));
+            if (block == nullptr)
+              break;
+            parent_dealloc_range(block, size);
+          }
+        }
+        requested_total = 0;
+      }
     };
   };
 } // namespace snmalloc
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "../ds/ds.h"
+#include "../pal/pal.h"
+#include "empty_range.h"
+#include "range_helpers.h"
+
+namespace snmalloc
+{
+  /**
+   * Splits memory between NUMA nodes.  Each node has its own instance of
+   * ParentRange, and so its own buddy allocators and locks.  An instance of
+   * this range is bound to a node, and allocates only from that node's range.
+   *
+   * Memory handed out is recorded in a map from chunk to node, and the PAL is
+   * asked to place its pages on that node.  Memory given back goes to the
+   * range of the node it was handed out for, whichever node the instance is
+   * bound to, so memory freed by an allocator that has moved node still
+   * returns to its owner.
+   *
+   * MAX_NODES - Nodes with a larger index share ranges modulo MAX_NODES.
+   */
+  template<SNMALLOC_CONCEPT(IsPAL) PAL, size_t MAX_NODES = 64>
+  struct NumaRange
+  {
+    static_assert(
+      MAX_NODES > 0 && MAX_NODES < 256, "Node map entries are one byte");
+
+    template<typename ParentRange = EmptyRange<>>
+    class Type
+    {
+      static_assert(
+        ParentRange::ConcurrencySafe,
+        "NumaRange requires a concurrency safe parent.");
+
+      /**
+       * One range per node.  Node n uses the entry at n % MAX_NODES.
+       */
+      SNMALLOC_REQUIRE_CONSTINIT
+      static inline ParentRange nodes[MAX_NODES]{};
+
+      /**
+       * For each chunk that has been handed out, one more than the node it
+       * was last handed out for.  Zero for chunks never handed out.
+       */
+      using NodeMap = FlatPagemap<MIN_CHUNK_BITS, uint8_t, PAL, false>;
+
+      SNMALLOC_REQUIRE_CONSTINIT
+      static inline NodeMap node_map{};
+
+      SNMALLOC_REQUIRE_CONSTINIT
+      static inline stl::Atomic<bool> node_map_initialised{false};
+
+      SNMALLOC_REQUIRE_CONSTINIT
+      static inline FlagWord node_map_lock{};
+
+      /**
+       * The node this instance allocates from.
+       */
+      size_t node = 0;
+
+      static void ensure_node_map()
+      {
+        if (SNMALLOC_LIKELY(
+              node_map_initialised.load(stl::memory_order_acquire)))
+          return;
+
+        with(node_map_lock, [&]() {
+          if (node_map_initialised.load(stl::memory_order_relaxed))
+            return;
+
+          node_map.template init<false>();
+          node_map_initialised.store(true, stl::memory_order_release);
+        });
+      }
+
+      /**
+       * Record that the block at `base` of `size` bytes now belongs to this
+       * instance's node, and move its pages there if it belonged to another.
+       */
+      void claim(address_t base, size_t size)
+      {
+        ensure_node_map();
+        if (!node_map.register_range(base, size))
+          PAL::error("Failed to extend the NUMA node map.");
+
+        auto tag = static_cast<uint8_t>(node + 1);
+        bool moved = false;
+        for (size_t offset = 0; offset < size; offset += MIN_CHUNK_SIZE)
+        {
+          if (node_map.template get<false>(base + offset) != tag)
+          {
+            node_map.set(base + offset, tag);
+            moved = true;
+          }
+        }
+
+        if (moved)
+          PAL::numa_bind(reinterpret_cast<void*>(base), size, node);
+      }
+
+    public:
+      static constexpr bool Aligned = ParentRange::Aligned;
+
+      static constexpr bool ConcurrencySafe = true;
+
+      using ChunkBounds = typename ParentRange::ChunkBounds;
+
+      constexpr Type() = default;
+
+      CapPtr<void, ChunkBounds> alloc_range(size_t size)
+      {
+        auto result = nodes[node].alloc_range(size);
+        if (result != nullptr)
+          claim(address_cast(result), size);
+        return result;
+      }
+
+      void dealloc_range(CapPtr<void, ChunkBounds> base, size_t size)
+      {
+        nodes[node_of(address_cast(base))].dealloc_range(base, size);
+      }
+
+      /**
+       * Allocate from `n`'s range from now on.  Returns false if this was
+       * already the case.
+       */
+      bool set_node(size_t n)
+      {
+        size_t previous = node;
+        node = n % MAX_NODES;
+        return node != previous;
+      }
+
+      [[nodiscard]] size_t get_node() const
+      {
+        return node;
+      }
+
+      /**
+       * The node whose range the chunk containing `a` was handed out from.
+       * Defaults to this instance's node for memory never handed out.
+       */
+      size_t node_of(address_t a)
+      {
+        if (!node_map_initialised.load(stl::memory_order_acquire))
+          return node;
+
+        auto tag = node_map.template get<true>(a);
+        return tag == 0 ? node : static_cast<size_t>(tag - 1);
+      }
+    };
+  };
+} // namespace snmalloc
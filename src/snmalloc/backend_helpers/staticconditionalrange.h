@@ -5,23 +5,23 @@
 
 namespace snmalloc
 {
-  template<typename OptionalRange>
+  template<typename... OptionalRanges>
   struct StaticConditionalRange
   {
-    // This is a range that can bypass the OptionalRange if it is disabled.
+    // This is a range that can bypass the OptionalRanges if it is disabled.
     // Disabling is global, and not local.
     // This is used to allow disabling thread local buddy allocators when the
     // initial fixed size heap is small.
     //
     // The range builds a more complex parent
-    //    Pipe<ParentRange, OptionalRange>
-    // and uses the ancestor functions to bypass the OptionalRange if the flag
+    //    Pipe<ParentRange, OptionalRanges...>
+    // and uses the ancestor functions to bypass the OptionalRanges if the flag
     // has been set.
     template<typename ParentRange>
-    class Type : public ContainsParent<Pipe<ParentRange, OptionalRange>>
+    class Type : public ContainsParent<Pipe<ParentRange, OptionalRanges...>>
     {
-      // This contains connects the optional range to the parent range.
-      using ActualParentRange = Pipe<ParentRange, OptionalRange>;
+      // This contains connects the optional ranges to the parent range.
+      using ActualParentRange = Pipe<ParentRange, OptionalRanges...>;
 
       using ContainsParent<ActualParentRange>::parent;
 
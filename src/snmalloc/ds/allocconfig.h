@@ -123,6 +123,26 @@ namespace snmalloc
   static constexpr size_t REMOTE_SLOTS = 1 << REMOTE_SLOT_BITS;
   static constexpr size_t REMOTE_MASK = REMOTE_SLOTS - 1;
 
+  // Reallocations that copy at least this much move the pages instead, if
+  // enabled and the platform can.
+  static constexpr size_t REALLOC_REMAP_THRESHOLD = bits::one_at_bit(21);
+
+  // Large zeroed allocations of at least this size, a huge page on x86-64,
+  // are zeroed by the PAL rather than with a memset, see
+  // DefaultConts::success_large in mem/corealloc.h.
+  static constexpr size_t LARGE_ZERO_BY_PAL_SIZE = bits::one_at_bit(21);
+
+  // Move the pages of large reallocations rather than copying them.  Off by
+  // default: the moved pages split the heap's mappings, and keep the
+  // `madvise` and NUMA policy of where they came from.
+  static constexpr bool REALLOC_REMAP_ENABLED =
+#ifdef SNMALLOC_REALLOC_REMAP
+    true
+#else
+    false
+#endif
+    ;
+
 #if defined(SNMALLOC_DEALLOC_BATCH_RING_ASSOC)
   static constexpr size_t DEALLOC_BATCH_RING_ASSOC =
     SNMALLOC_DEALLOC_BATCH_RING_ASSOC;
@@ -195,6 +215,56 @@ namespace snmalloc
 #endif
     ;
 
+  // Count allocations, deallocations and slabs per allocator, see
+  // mem/allocstats.h.  Without this the counters compile away.
+  static constexpr bool STATS_ENABLED =
+#ifdef SNMALLOC_STATS
+    true
+#else
+    false
+#endif
+    ;
+
+  // Sample allocations and record their stacks, see mem/heapprofile.h.
+  // Without this the sampling countdown compiles away.
+  static constexpr bool HEAP_PROFILE_ENABLED =
+#ifdef SNMALLOC_HEAP_PROFILE
+    true
+#else
+    false
+#endif
+    ;
+
+  // Record slow-path events in per-allocator rings, see mem/eventtrace.h.
+  // Without this the rings and the recording compile away.
+  static constexpr bool EVENT_TRACE_ENABLED =
+#ifdef SNMALLOC_EVENT_TRACE
+    true
+#else
+    false
+#endif
+    ;
+
+  // Events each allocator's trace ring holds before overwriting the oldest.
+  static constexpr size_t EVENT_TRACE_RECORDS =
+#ifdef SNMALLOC_EVENT_TRACE_RECORDS
+    SNMALLOC_EVENT_TRACE_RECORDS
+#else
+    256
+#endif
+    ;
+
+  // Thread new slabs onto their free lists a batch at a time from a bump
+  // cursor, rather than all at once, see Allocator::carve in
+  // mem/corealloc.h.
+  static constexpr bool LAZY_SLAB_ENABLED =
+#ifdef SNMALLOC_LAZY_SLAB
+    true
+#else
+    false
+#endif
+    ;
+
   // Used to configure when the backend should use thread local buddies.
   // This only basically is used to disable some buddy allocators on small
   // fixed heap scenarios like OpenEnclave.
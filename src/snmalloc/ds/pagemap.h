@@ -218,6 +218,18 @@ namespace snmalloc
         PAL::notify_do_not_dump(new_body_untyped, request_size);
       }
 
+#ifndef SNMALLOC_HUGE_PAGEMAP
+      if constexpr (pal_supports<HugePages, PAL>)
+      {
+        // The pagemap is sparse, so huge pages would commit far more of it
+        // than is used.  SNMALLOC_HUGE_PAGEMAP trades that memory for fewer
+        // TLB misses on pagemap lookups.
+        if (new_body_untyped != nullptr)
+          PAL::notify_no_huge_pages(
+            new_body_untyped, bits::align_up(request_size, PAL::page_size));
+      }
+#endif
+
       if (new_body_untyped == nullptr)
       {
         PAL::error("Failed to initialise snmalloc.");
@@ -27,6 +27,7 @@
 #  define SNMALLOC_REQUIRE_CONSTINIT
 #  define SNMALLOC_UNUSED_FUNCTION
 #  define SNMALLOC_USED_FUNCTION
+#  define SNMALLOC_TARGET(isa)
 #else
 #  define SNMALLOC_FAST_FAIL() __builtin_trap()
 #  define SNMALLOC_LIKELY(x) __builtin_expect(!!(x), 1)
@@ -50,6 +51,11 @@
 #  define SNMALLOC_COLD __attribute__((cold))
 #  define SNMALLOC_UNUSED_FUNCTION __attribute((unused))
 #  define SNMALLOC_USED_FUNCTION __attribute((used))
+/**
+ * Compile one function for an instruction set extension that the rest of the
+ * code may not assume, such as "avx2".  Callers must check for it at run time.
+ */
+#  define SNMALLOC_TARGET(isa) __attribute__((target(isa)))
 #  if defined(__clang__) && __cplusplus >= 202002L
 #    define SNMALLOC_REQUIRE_CONSTINIT \
       [[clang::require_constant_initialization]]
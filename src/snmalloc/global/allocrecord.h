@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../ds_core/ds_core.h"
+
+#include <stdint.h>
+
+namespace snmalloc
+{
+  /**
+   * The calls an allocation trace records.  `calloc`, the `realloc`
+   * variants and the aligned allocation functions are recorded as the
+   * operation they perform.
+   */
+  enum class AllocOp : uint8_t
+  {
+    /**
+     * Not a call.  Replays skip these.
+     */
+    None = 0,
+    Malloc,
+    Free,
+    Realloc,
+    Memalign,
+  };
+
+  /**
+   * An allocation trace is this header followed by `AllocRecordEntry`s.
+   * Each thread's entries are written in chunks, in no order across
+   * threads, so readers sort them by `sequence`.  All fields are in host byte
+   * order.
+   */
+  struct AllocRecordHeader
+  {
+    static constexpr uint64_t MAGIC = 0x32434f4c4c414e53; // "SNALLOC2"
+
+    uint64_t magic = MAGIC;
+    uint64_t entry_size = 0;
+  };
+
+  /**
+   * One call.  Objects are identified by their address while live, so a
+   * `Free` refers to the most recent allocation that returned its `old`.
+   */
+  struct AllocRecordEntry
+  {
+    AllocOp op = AllocOp::None;
+
+    /**
+     * log2 of the alignment of a `Memalign`, otherwise zero.
+     */
+    uint8_t align_bits = 0;
+    uint16_t reserved = 0;
+
+    /**
+     * The calling thread, numbered from one in order of first call.
+     */
+    uint32_t thread = 0;
+
+    /**
+     * The size asked for, by all but `Free`.
+     */
+    uint64_t size = 0;
+
+    /**
+     * The object returned, by all but `Free`.  Zero if the call failed.
+     */
+    uint64_t result = 0;
+
+    /**
+     * The object passed in, to `Free` and `Realloc`.
+     */
+    uint64_t old = 0;
+
+    /**
+     * The order in which the calls took effect, across all threads.
+     */
+    uint64_t sequence = 0;
+  };
+
+  static_assert(sizeof(AllocRecordEntry) == 40);
+} // namespace snmalloc
@@ -1,3 +1,4 @@
+#include "allocrecord.h"
 #include "bounds_checks.h"
 #include "globalalloc.h"
 #include "libc.h"
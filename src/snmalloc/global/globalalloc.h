@@ -24,6 +24,7 @@ namespace snmalloc
       while (alloc != nullptr)
       {
         alloc->flush();
+        alloc->release_cached_memory();
         last = alloc;
         alloc = AllocPool<Config_>::extract(alloc);
       }
@@ -128,6 +129,72 @@ namespace snmalloc
     }
   }
 
+  /**
+   * Read the allocation statistics, in the manner of jemalloc's `stats.*`.
+   *
+   * Allocators fold their counters into the global totals when they flush,
+   * which includes thread teardown.  The calling thread's counters are folded
+   * here; other threads' counts since their last flush are not included.
+   * With per-CPU allocators, every CPU's allocator is folded.  Without SNMALLOC_STATS only the committed memory is reported.
+   */
+  inline static void get_stats(AllocStatsSnapshot& result)
+  {
+    if constexpr (STATS_ENABLED)
+    {
+#ifdef SNMALLOC_PER_CPU_ALLOC
+      // Any CPU's allocator may hold counts for this thread.
+      ThreadAlloc::with_each([](Alloc& a) { a.fold_stats(); });
+#else
+      ThreadAlloc::CheckInit::check_init(
+        []() { ThreadAlloc::with([](Alloc& a) { a.fold_stats(); }); },
+        [](Alloc* a) { a->fold_stats(); });
+#endif
+    }
+
+    AllocStats<>::read(result);
+    result.committed_bytes = Alloc::Config::Backend::get_current_usage();
+    result.peak_committed_bytes = Alloc::Config::Backend::get_peak_usage();
+  }
+
+  /**
+   * Start sampling allocations for the heap profile, on average once every
+   * `interval` bytes allocated.  Does nothing without SNMALLOC_HEAP_PROFILE.
+   */
+  inline void
+  heap_profile_start(size_t interval = HEAP_PROFILE_DEFAULT_INTERVAL)
+  {
+    HeapProfiler<Alloc::Config>::start(interval);
+  }
+
+  /**
+   * Stop sampling.  Samples of objects that are still live are kept.
+   */
+  inline void heap_profile_stop()
+  {
+    HeapProfiler<Alloc::Config>::stop();
+  }
+
+  /**
+   * Write the sampled objects that are still live as a pprof heap profile,
+   * by calls to `write(const char*, size_t)`.  See `HeapProfiler::dump`.
+   */
+  template<typename Write>
+  inline void heap_profile_dump(Write&& write)
+  {
+    HeapProfiler<Alloc::Config>::dump(stl::forward<Write>(write));
+  }
+
+  /**
+   * Write the slow-path events every allocator has recorded since the last
+   * flush, by calls to `write(const void*, size_t)`.  May be called from any
+   * thread; see `EventTrace::flush` and `trace_decode` for the format.
+   */
+  template<typename Write>
+  inline void trace_flush(Write&& write)
+  {
+    EventTrace<>::flush<Alloc::Config::Pal>(stl::forward<Write>(write));
+  }
+
   /**
    * Returns the number of remaining bytes in an object.
    *
@@ -285,9 +352,13 @@ namespace snmalloc
       auto pm_sc = entry.get_sizeclass();
       auto rsize = sizeclass_full_to_size(sc);
       auto pm_size = sizeclass_full_to_size(pm_sc);
+      // Sampled objects have a chunk of their own, whatever their size.
+      bool sampled = false;
+      if constexpr (HEAP_PROFILE_ENABLED)
+        sampled = entry.get_slab_metadata()->heap_sample() != nullptr;
       snmalloc_check_client(
         mitigations(sanity_checks),
-        (sc == pm_sc) || (p == nullptr),
+        (sc == pm_sc) || (p == nullptr) || sampled,
         "Dealloc rounded size mismatch: {} != {}",
         rsize,
         pm_size);
@@ -321,50 +392,97 @@ namespace snmalloc
     return sizeclass_full_to_size(entry.get_sizeclass());
   }
 
+  /**
+   * @brief Try to resize the allocation at `p` to hold `size` bytes without
+   * moving it.  Returns true on success, in which case `alloc_size(p)` is at
+   * least `size` and any grown part is uninitialised.
+   *
+   * Only large allocations owned by the calling thread are resized.  Growing
+   * needs the neighbouring address space to be free in this thread's cache.
+   */
+  inline bool resize_in_place(void* p, size_t size)
+  {
+    return ThreadAlloc::with(
+      [&](Alloc& a) { return a.resize_in_place(p, size); });
+  }
+
   template<size_t size, typename Conts = Uninit, size_t align = 1>
   SNMALLOC_FAST_PATH_INLINE void* alloc()
   {
-    return ThreadAlloc::get().alloc<Conts, ThreadAlloc::CheckInit>(
-      aligned_size(align, size));
+    return ThreadAlloc::with([&](Alloc& a) {
+      return a.alloc<Conts, ThreadAlloc::CheckInit>(aligned_size(align, size));
+    });
   }
 
   template<typename Conts = Uninit, size_t align = 1>
   SNMALLOC_FAST_PATH_INLINE void* alloc(size_t size)
   {
-    return ThreadAlloc::get().alloc<Conts, ThreadAlloc::CheckInit>(
-      aligned_size(align, size));
+    return ThreadAlloc::with([&](Alloc& a) {
+      return a.alloc<Conts, ThreadAlloc::CheckInit>(aligned_size(align, size));
+    });
   }
 
   template<typename Conts = Uninit>
   SNMALLOC_FAST_PATH_INLINE void* alloc_aligned(size_t align, size_t size)
   {
-    return ThreadAlloc::get().alloc<Conts, ThreadAlloc::CheckInit>(
-      aligned_size(align, size));
+    return ThreadAlloc::with([&](Alloc& a) {
+      return a.alloc<Conts, ThreadAlloc::CheckInit>(aligned_size(align, size));
+    });
+  }
+
+  /**
+   * Allocates `n` blocks of `size` bytes into `out`, resolving the size class
+   * once for the whole batch.  Returns the number allocated, which is less
+   * than `n` only if an allocation failed.
+   */
+  template<typename Conts = Uninit>
+  inline size_t alloc_batch(size_t size, size_t n, void** out)
+  {
+    return ThreadAlloc::with([&](Alloc& a) {
+      return a.alloc_batch<Conts, ThreadAlloc::CheckInit>(size, n, out);
+    });
   }
 
   SNMALLOC_FAST_PATH_INLINE void dealloc(void* p)
   {
-    ThreadAlloc::get().dealloc<ThreadAlloc::CheckInit>(p);
+    ThreadAlloc::with(
+      [&](Alloc& a) { a.dealloc<ThreadAlloc::CheckInit>(p); });
   }
 
   SNMALLOC_FAST_PATH_INLINE void dealloc(void* p, size_t size)
   {
     check_size(p, size);
-    ThreadAlloc::get().dealloc<ThreadAlloc::CheckInit>(p);
+    ThreadAlloc::with(
+      [&](Alloc& a) { a.dealloc<ThreadAlloc::CheckInit>(p); });
   }
 
   template<size_t size>
   SNMALLOC_FAST_PATH_INLINE void dealloc(void* p)
   {
     check_size(p, size);
-    ThreadAlloc::get().dealloc<ThreadAlloc::CheckInit>(p);
+    ThreadAlloc::with(
+      [&](Alloc& a) { a.dealloc<ThreadAlloc::CheckInit>(p); });
   }
 
   SNMALLOC_FAST_PATH_INLINE void dealloc(void* p, size_t size, size_t align)
   {
     auto rsize = aligned_size(align, size);
     check_size(p, rsize);
-    ThreadAlloc::get().dealloc<ThreadAlloc::CheckInit>(p);
+    ThreadAlloc::with(
+      [&](Alloc& a) { a.dealloc<ThreadAlloc::CheckInit>(p); });
+  }
+
+  /**
+   * Deallocates the `n` objects in `ptrs`, which may come from any
+   * allocators.  Pagemap lookups are overlapped, and consecutive objects from
+   * the same slab are freed together, so this is fastest when objects
+   * allocated together are freed together.
+   */
+  inline void dealloc_batch(void** ptrs, size_t n)
+  {
+    ThreadAlloc::with([&](Alloc& a) {
+      a.dealloc_batch<ThreadAlloc::CheckInit>(ptrs, n);
+    });
   }
 
   SNMALLOC_FAST_PATH_INLINE void debug_teardown()
@@ -50,6 +50,32 @@ namespace snmalloc::libc
     return alloc<Zero>(sz);
   }
 
+  /**
+   * Copy the `size` bytes a reallocation keeps from the old allocation at
+   * `src` to the new one at `dst`.  With SNMALLOC_REALLOC_REMAP, large
+   * page-aligned copies move the pages where the platform can, which leaves
+   * `src` zeroed, so `src` must be freed afterwards.
+   */
+  inline void realloc_copy(void* dst, void* src, size_t size)
+  {
+    using Pal = typename Config::Pal;
+    if constexpr (REALLOC_REMAP_ENABLED && pal_supports<RemapPages, Pal>)
+    {
+      size_t pages = bits::align_down(size, Pal::page_size);
+      if (
+        (pages >= REALLOC_REMAP_THRESHOLD) &&
+        is_aligned_block<Pal::page_size>(dst, pages) &&
+        is_aligned_block<Pal::page_size>(src, pages) &&
+        Pal::remap(dst, src, pages))
+      {
+        ::memcpy(
+          pointer_offset(dst, pages), pointer_offset(src, pages), size - pages);
+        return;
+      }
+    }
+    ::memcpy(dst, src, size);
+  }
+
   SNMALLOC_FAST_PATH_INLINE void* realloc(void* ptr, size_t size)
   {
     // Glibc treats
@@ -78,6 +104,14 @@ namespace snmalloc::libc
       return ptr;
     }
 
+    // Large allocations may be able to grow or shrink where they are.
+    if (
+      (sz > MAX_SMALL_SIZECLASS_SIZE) && (size > MAX_SMALL_SIZECLASS_SIZE) &&
+      resize_in_place(ptr, size))
+    {
+      return ptr;
+    }
+
     void* p = alloc(size);
     if (SNMALLOC_LIKELY(p != nullptr))
     {
@@ -87,7 +121,7 @@ namespace snmalloc::libc
       if (SNMALLOC_UNLIKELY(sz != 0))
       {
         SNMALLOC_ASSUME(ptr != nullptr);
-        ::memcpy(p, ptr, sz);
+        realloc_copy(p, ptr, sz);
       }
       dealloc(ptr);
     }
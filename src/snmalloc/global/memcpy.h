@@ -1,6 +1,13 @@
 #pragma once
 #include "bounds_checks.h"
 
+#if defined(__x86_64__) || defined(_M_X64)
+#  include <immintrin.h>
+#  if !defined(_MSC_VER)
+#    include <cpuid.h>
+#  endif
+#endif
+
 namespace snmalloc
 {
   /**
@@ -142,6 +149,151 @@ namespace snmalloc
     }
   }
 
+  /**
+   * Predicate indicating whether `len` bytes at `dst` and at `src` share any
+   * bytes, so that copying between them needs `move` rather than `copy`.
+   */
+  SNMALLOC_FAST_PATH_INLINE bool
+  overlaps(const void* dst, const void* src, size_t len)
+  {
+    return ((address_cast(dst) - address_cast(src)) < len) ||
+      ((address_cast(src) - address_cast(dst)) < len);
+  }
+
+  /**
+   * Move a small size, at most `Size` bytes, between buffers that may
+   * overlap.  Sizes of at least half of `Size` are moved as two overlapping
+   * halves, both loaded before either is stored; smaller ones recurse.
+   */
+  template<size_t Size>
+  SNMALLOC_FAST_PATH_INLINE void
+  small_move(void* dst, const void* src, size_t len)
+  {
+    if constexpr (Size == 1)
+    {
+      if (len != 0)
+        copy_one<1>(dst, src);
+    }
+    else
+    {
+      constexpr size_t Half = Size / 2;
+      if (len >= Half)
+      {
+        struct Block
+        {
+          char data[Half];
+        } first, last;
+
+        copy_one<Half>(&first, src);
+        copy_one<Half>(&last, pointer_offset(src, len - Half));
+        copy_one<Half>(dst, &first);
+        copy_one<Half>(pointer_offset(dst, len - Half), &last);
+      }
+      else
+      {
+        small_move<Half>(dst, src, len);
+      }
+    }
+  }
+
+  /**
+   * Move at least `Size` bytes between buffers that may overlap.  This copies
+   * `Size`-byte blocks forwards if the destination is below the source and
+   * backwards if it is above, so no source byte is overwritten before it is
+   * read.  The partial block at the far end is loaded before anything is
+   * stored and stored last, overlapping the others.
+   */
+  template<size_t Size>
+  SNMALLOC_FAST_PATH_INLINE void
+  block_move(void* dst, const void* src, size_t len)
+  {
+    struct Block
+    {
+      char data[Size];
+    } block, end;
+
+    if ((address_cast(dst) - address_cast(src)) >= len)
+    {
+      copy_one<Size>(&end, pointer_offset(src, len - Size));
+      for (size_t i = 0; (i + Size) <= len; i += Size)
+      {
+        copy_one<Size>(&block, pointer_offset(src, i));
+        copy_one<Size>(pointer_offset(dst, i), &block);
+      }
+      copy_one<Size>(pointer_offset(dst, len - Size), &end);
+    }
+    else
+    {
+      copy_one<Size>(&end, src);
+      for (size_t i = len; i >= Size; i -= Size)
+      {
+        copy_one<Size>(&block, pointer_offset(src, i - Size));
+        copy_one<Size>(pointer_offset(dst, i - Size), &block);
+      }
+      copy_one<Size>(dst, &end);
+    }
+  }
+
+  /**
+   * A block of `Size` bytes, each of them `c`, for the set functions below
+   * to store.
+   */
+  template<size_t Size>
+  SNMALLOC_FAST_PATH_INLINE auto splat(int c)
+  {
+    struct Block
+    {
+      uint64_t words[bits::max<size_t>(Size / sizeof(uint64_t), 1)];
+    } block;
+
+    for (auto& word : block.words)
+      word = 0x0101010101010101ULL * static_cast<uint8_t>(c);
+    return block;
+  }
+
+  /**
+   * Set a small size, at most `Size` bytes, from a `splat` block of at least
+   * half of `Size`.  Like `small_move`, this uses two overlapping stores.
+   */
+  template<size_t Size>
+  SNMALLOC_FAST_PATH_INLINE void
+  small_set(void* dst, const void* block, size_t len)
+  {
+    if constexpr (Size == 1)
+    {
+      if (len != 0)
+        copy_one<1>(dst, block);
+    }
+    else
+    {
+      constexpr size_t Half = Size / 2;
+      if (len >= Half)
+      {
+        copy_one<Half>(dst, block);
+        copy_one<Half>(pointer_offset(dst, len - Half), block);
+      }
+      else
+      {
+        small_set<Half>(dst, block, len);
+      }
+    }
+  }
+
+  /**
+   * Set at least `Size` bytes from a `splat` block of `Size` bytes, finishing
+   * with an overlapping store of the end.
+   */
+  template<size_t Size>
+  SNMALLOC_FAST_PATH_INLINE void
+  block_set(void* dst, const void* block, size_t len)
+  {
+    for (size_t i = 0; (i + Size) <= len; i += Size)
+    {
+      copy_one<Size>(pointer_offset(dst, i), block);
+    }
+    copy_one<Size>(pointer_offset(dst, len - Size), block);
+  }
+
   /**
    * Default architecture definition.  Provides sane defaults.
    */
@@ -177,6 +329,32 @@ namespace snmalloc
       }
       return orig_dst;
     }
+
+    /**
+     * Hook for architecture-specific optimisations of moves, which may
+     * overlap.
+     */
+    static void* move(void* dst, const void* src, size_t len)
+    {
+      if (len <= LargestRegisterSize)
+        small_move<LargestRegisterSize>(dst, src, len);
+      else
+        block_move<LargestRegisterSize>(dst, src, len);
+      return dst;
+    }
+
+    /**
+     * Hook for architecture-specific optimisations of sets.
+     */
+    static void* set(void* dst, int c, size_t len)
+    {
+      auto block = splat<LargestRegisterSize>(c);
+      if (len <= LargestRegisterSize)
+        small_set<LargestRegisterSize>(dst, &block, len);
+      else
+        block_set<LargestRegisterSize>(dst, &block, len);
+      return dst;
+    }
   };
 
   /**
@@ -300,8 +478,14 @@ namespace snmalloc
       /*
        * Otherwise, we cannot use pointer-width operations because one of
        * the load or store is going to be misaligned and so will trap.
-       * So, same dance, but with integer registers only.
+       * So, same dance, but with integer registers only.  `copy_end` copies a
+       * whole register's worth back from the end, so anything shorter than
+       * that must use a jump table instead.
        */
+      else if (len < LargestRegisterSize)
+      {
+        small_copies<LargestRegisterSize - 1, sizeof(long)>(dst, src, len);
+      }
       else
       {
         block_copy<LargestRegisterSize>(dst, src, len);
@@ -309,12 +493,595 @@ namespace snmalloc
       }
       return orig_dst;
     }
+
+    /**
+     * Move `count` elements of type `T`, one at a time, in the given
+     * direction.
+     */
+    template<typename T, bool Forward>
+    static void move_each(void* dst, const void* src, size_t count)
+    {
+      auto d = static_cast<T*>(dst);
+      auto s = static_cast<const T*>(src);
+      if constexpr (Forward)
+      {
+        for (size_t i = 0; i < count; i++)
+          d[i] = s[i];
+      }
+      else
+      {
+        for (size_t i = count; i > 0; i--)
+          d[i - 1] = s[i - 1];
+      }
+    }
+
+    template<bool Forward>
+    static void move_parts(
+      void* dst, const void* src, size_t head, size_t pointers, size_t tail)
+    {
+      size_t middle = pointers * sizeof(void*);
+      auto body_dst = pointer_offset(dst, head);
+      auto body_src = pointer_offset(src, head);
+      auto tail_dst = pointer_offset(body_dst, middle);
+      auto tail_src = pointer_offset(body_src, middle);
+      if constexpr (Forward)
+      {
+        move_each<char, true>(dst, src, head);
+        move_each<void*, true>(body_dst, body_src, pointers);
+        move_each<char, true>(tail_dst, tail_src, tail);
+      }
+      else
+      {
+        move_each<char, false>(tail_dst, tail_src, tail);
+        move_each<void*, false>(body_dst, body_src, pointers);
+        move_each<char, false>(dst, src, head);
+      }
+    }
+
+    /**
+     * Overlapping moves cannot go through a temporary, so move whole
+     * pointers where the buffers are equally misaligned, to keep their tags,
+     * and bytes elsewhere.
+     */
+    static void* move(void* dst, const void* src, size_t len)
+    {
+      if (!overlaps(dst, src, len))
+        return copy(dst, src, len);
+
+      size_t head = len;
+      size_t pointers = 0;
+      size_t tail = 0;
+      if (
+        address_misalignment<alignof(void*)>(address_cast(src)) ==
+        address_misalignment<alignof(void*)>(address_cast(dst)))
+      {
+        head = bits::min(
+          len,
+          static_cast<size_t>(-static_cast<ptrdiff_t>(address_cast(src))) &
+            (alignof(void*) - 1));
+        pointers = (len - head) / sizeof(void*);
+        tail = len - head - (pointers * sizeof(void*));
+      }
+
+      if ((address_cast(dst) - address_cast(src)) >= len)
+        move_parts<true>(dst, src, head, pointers, tail);
+      else
+        move_parts<false>(dst, src, head, pointers, tail);
+      return dst;
+    }
+
+    /**
+     * Sets store integers, which clears any tags as it should.
+     */
+    static void* set(void* dst, int c, size_t len)
+    {
+      auto block = splat<sizeof(uint64_t)>(c);
+      if (len <= sizeof(uint64_t))
+        small_set<sizeof(uint64_t)>(dst, &block, len);
+      else
+        block_set<sizeof(uint64_t)>(dst, &block, len);
+      return dst;
+    }
   };
 
 #if defined(__x86_64__) || defined(_M_X64)
+  /**
+   * Kernels for large copies and sets on x86-64, and the CPU features that
+   * choose between them.  `X86_64Arch` uses these for 512 bytes or more.
+   */
+  namespace x86_copy
+  {
+    /**
+     * The vector kernels, from narrowest to widest.  SSE2 is always there on
+     * x86-64; the others need support from both the CPU and the OS.
+     */
+    enum class Kernel : uint8_t
+    {
+      SSE2,
+      AVX2,
+      AVX512
+    };
+
+    /**
+     * Which kernel to use for which sizes, chosen once from CPUID.  The
+     * thresholds are log2 of the smallest size to use `rep movsb` or
+     * non-temporal stores for, so the whole plan fits in one atomic word.
+     */
+    struct Plan
+    {
+      Kernel kernel;
+      uint8_t rep_movsb_bits;
+      uint8_t non_temporal_bits;
+      bool detected;
+    };
+
+    /**
+     * The plan for this CPU, filled in by the first large copy.  Detection
+     * gives the same answer every time, so racing to fill it is benign.
+     */
+    inline stl::Atomic<Plan> current_plan{};
+
+    inline void cpuid(unsigned leaf, unsigned subleaf, unsigned (&regs)[4])
+    {
+#  if defined(_MSC_VER)
+      int info[4];
+      __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+      for (size_t i = 0; i < 4; i++)
+        regs[i] = static_cast<unsigned>(info[i]);
+#  else
+      __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#  endif
+    }
+
+    /**
+     * The register state the OS saves on context switch, which must include
+     * the vector registers before a kernel can use them.
+     */
+    inline uint64_t xgetbv()
+    {
+#  if defined(_MSC_VER)
+      return _xgetbv(0);
+#  else
+      unsigned lo, hi;
+      asm volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+      return (static_cast<uint64_t>(hi) << 32) | lo;
+#  endif
+    }
+
+    /**
+     * The size of the largest data cache, from the deterministic cache
+     * parameters leaf (Intel) or its AMD equivalent, or zero if neither is
+     * there.
+     */
+    inline size_t last_level_cache_size()
+    {
+      unsigned regs[4];
+      size_t largest = 0;
+      const unsigned leaves[] = {0x4U, 0x8000001dU};
+      for (unsigned leaf : leaves)
+      {
+        cpuid(leaf & 0x80000000U, 0, regs);
+        if (regs[0] < leaf)
+          continue;
+        for (unsigned i = 0; i < 16; i++)
+        {
+          cpuid(leaf, i, regs);
+          unsigned type = regs[0] & 0x1f;
+          if (type == 0)
+            break;
+          // Instruction caches do not matter here.
+          if (type == 2)
+            continue;
+          size_t ways = (regs[1] >> 22) + 1;
+          size_t partitions = ((regs[1] >> 12) & 0x3ff) + 1;
+          size_t line = (regs[1] & 0xfff) + 1;
+          size_t sets = static_cast<size_t>(regs[2]) + 1;
+          largest = bits::max(largest, ways * partitions * line * sets);
+        }
+      }
+      return largest;
+    }
+
+    inline Plan detect()
+    {
+      unsigned regs[4];
+      cpuid(0, 0, regs);
+      unsigned max_leaf = regs[0];
+
+      bool osxsave = false;
+      if (max_leaf >= 1)
+      {
+        cpuid(1, 0, regs);
+        osxsave = (regs[2] & (1U << 27)) != 0;
+      }
+
+      bool avx2 = false;
+      bool avx512 = false;
+      bool erms = false;
+      bool fsrm = false;
+      if (max_leaf >= 7)
+      {
+        cpuid(7, 0, regs);
+        avx2 = (regs[1] & (1U << 5)) != 0;
+        erms = (regs[1] & (1U << 9)) != 0;
+        avx512 = (regs[1] & (1U << 16)) != 0;
+        fsrm = (regs[3] & (1U << 4)) != 0;
+      }
+
+      // The OS must save the YMM (and for AVX-512 the opmask and ZMM) state.
+      uint64_t xcr0 = osxsave ? xgetbv() : 0;
+      bool ymm = (xcr0 & 0x6) == 0x6;
+      bool zmm = (xcr0 & 0xe6) == 0xe6;
+
+      Plan plan{};
+      plan.kernel = (avx512 && zmm) ? Kernel::AVX512 :
+        (avx2 && ymm)               ? Kernel::AVX2 :
+                                      Kernel::SSE2;
+
+      // `rep movsb` has a startup cost that vector loops beat up to a few
+      // KiB, less so with fast short `rep movsb`.  Without enhanced `rep
+      // movsb` it is never the fastest.
+      plan.rep_movsb_bits = fsrm ? 12 : (erms ? 13 : 63);
+
+      // Copies bigger than the last-level cache would only evict everything
+      // else from it, so bypass it.
+      size_t llc = last_level_cache_size();
+      plan.non_temporal_bits = static_cast<uint8_t>(
+        llc == 0 ? 23 : bits::next_pow2_bits(llc));
+
+      plan.detected = true;
+      return plan;
+    }
+
+    SNMALLOC_FAST_PATH_INLINE Plan plan()
+    {
+      auto p = current_plan.load(stl::memory_order_relaxed);
+      if (SNMALLOC_UNLIKELY(!p.detected))
+      {
+        p = detect();
+        current_plan.store(p, stl::memory_order_relaxed);
+      }
+      return p;
+    }
+
+    /**
+     * Whether this CPU and OS support `kernel`.
+     */
+    inline bool supported(Kernel kernel)
+    {
+      return kernel <= plan().kernel;
+    }
+
+    /**
+     * The block copy kernels.  Each copies the first and last vector of the
+     * range unaligned and the rest with stores aligned on the destination,
+     * four vectors at a time, optionally bypassing the cache.  These need
+     * `len` to be at least four vectors, and the buffers not to overlap.
+     */
+    template<bool NonTemporal>
+    NOINLINE inline void copy_sse2(void* dst, const void* src, size_t len)
+    {
+      using V = __m128i;
+      constexpr size_t W = sizeof(V);
+      auto d = static_cast<char*>(dst);
+      auto s = static_cast<const char*>(src);
+      V head = _mm_loadu_si128(reinterpret_cast<const V*>(s));
+      V tail = _mm_loadu_si128(reinterpret_cast<const V*>(s + len - W));
+
+      size_t i = W - (address_cast(d) & (W - 1));
+      for (; i + 4 * W <= len; i += 4 * W)
+      {
+        V v0 = _mm_loadu_si128(reinterpret_cast<const V*>(s + i));
+        V v1 = _mm_loadu_si128(reinterpret_cast<const V*>(s + i + W));
+        V v2 = _mm_loadu_si128(reinterpret_cast<const V*>(s + i + 2 * W));
+        V v3 = _mm_loadu_si128(reinterpret_cast<const V*>(s + i + 3 * W));
+        if constexpr (NonTemporal)
+        {
+          _mm_stream_si128(reinterpret_cast<V*>(d + i), v0);
+          _mm_stream_si128(reinterpret_cast<V*>(d + i + W), v1);
+          _mm_stream_si128(reinterpret_cast<V*>(d + i + 2 * W), v2);
+          _mm_stream_si128(reinterpret_cast<V*>(d + i + 3 * W), v3);
+        }
+        else
+        {
+          _mm_store_si128(reinterpret_cast<V*>(d + i), v0);
+          _mm_store_si128(reinterpret_cast<V*>(d + i + W), v1);
+          _mm_store_si128(reinterpret_cast<V*>(d + i + 2 * W), v2);
+          _mm_store_si128(reinterpret_cast<V*>(d + i + 3 * W), v3);
+        }
+      }
+      if constexpr (NonTemporal)
+        _mm_sfence();
+      for (; i + W <= len; i += W)
+        _mm_store_si128(
+          reinterpret_cast<V*>(d + i),
+          _mm_loadu_si128(reinterpret_cast<const V*>(s + i)));
+      _mm_storeu_si128(reinterpret_cast<V*>(d), head);
+      _mm_storeu_si128(reinterpret_cast<V*>(d + len - W), tail);
+    }
+
+    template<bool NonTemporal>
+    SNMALLOC_TARGET("avx2")
+    NOINLINE inline void copy_avx2(void* dst, const void* src, size_t len)
+    {
+      using V = __m256i;
+      constexpr size_t W = sizeof(V);
+      auto d = static_cast<char*>(dst);
+      auto s = static_cast<const char*>(src);
+      V head = _mm256_loadu_si256(reinterpret_cast<const V*>(s));
+      V tail = _mm256_loadu_si256(reinterpret_cast<const V*>(s + len - W));
+
+      size_t i = W - (address_cast(d) & (W - 1));
+      for (; i + 4 * W <= len; i += 4 * W)
+      {
+        V v0 = _mm256_loadu_si256(reinterpret_cast<const V*>(s + i));
+        V v1 = _mm256_loadu_si256(reinterpret_cast<const V*>(s + i + W));
+        V v2 = _mm256_loadu_si256(reinterpret_cast<const V*>(s + i + 2 * W));
+        V v3 = _mm256_loadu_si256(reinterpret_cast<const V*>(s + i + 3 * W));
+        if constexpr (NonTemporal)
+        {
+          _mm256_stream_si256(reinterpret_cast<V*>(d + i), v0);
+          _mm256_stream_si256(reinterpret_cast<V*>(d + i + W), v1);
+          _mm256_stream_si256(reinterpret_cast<V*>(d + i + 2 * W), v2);
+          _mm256_stream_si256(reinterpret_cast<V*>(d + i + 3 * W), v3);
+        }
+        else
+        {
+          _mm256_store_si256(reinterpret_cast<V*>(d + i), v0);
+          _mm256_store_si256(reinterpret_cast<V*>(d + i + W), v1);
+          _mm256_store_si256(reinterpret_cast<V*>(d + i + 2 * W), v2);
+          _mm256_store_si256(reinterpret_cast<V*>(d + i + 3 * W), v3);
+        }
+      }
+      if constexpr (NonTemporal)
+        _mm_sfence();
+      for (; i + W <= len; i += W)
+        _mm256_store_si256(
+          reinterpret_cast<V*>(d + i),
+          _mm256_loadu_si256(reinterpret_cast<const V*>(s + i)));
+      _mm256_storeu_si256(reinterpret_cast<V*>(d), head);
+      _mm256_storeu_si256(reinterpret_cast<V*>(d + len - W), tail);
+    }
+
+    template<bool NonTemporal>
+    SNMALLOC_TARGET("avx512f")
+    NOINLINE inline void copy_avx512(void* dst, const void* src, size_t len)
+    {
+      using V = __m512i;
+      constexpr size_t W = sizeof(V);
+      auto d = static_cast<char*>(dst);
+      auto s = static_cast<const char*>(src);
+      V head = _mm512_loadu_si512(s);
+      V tail = _mm512_loadu_si512(s + len - W);
+
+      size_t i = W - (address_cast(d) & (W - 1));
+      for (; i + 4 * W <= len; i += 4 * W)
+      {
+        V v0 = _mm512_loadu_si512(s + i);
+        V v1 = _mm512_loadu_si512(s + i + W);
+        V v2 = _mm512_loadu_si512(s + i + 2 * W);
+        V v3 = _mm512_loadu_si512(s + i + 3 * W);
+        if constexpr (NonTemporal)
+        {
+          _mm512_stream_si512(reinterpret_cast<V*>(d + i), v0);
+          _mm512_stream_si512(reinterpret_cast<V*>(d + i + W), v1);
+          _mm512_stream_si512(reinterpret_cast<V*>(d + i + 2 * W), v2);
+          _mm512_stream_si512(reinterpret_cast<V*>(d + i + 3 * W), v3);
+        }
+        else
+        {
+          _mm512_store_si512(d + i, v0);
+          _mm512_store_si512(d + i + W, v1);
+          _mm512_store_si512(d + i + 2 * W, v2);
+          _mm512_store_si512(d + i + 3 * W, v3);
+        }
+      }
+      if constexpr (NonTemporal)
+        _mm_sfence();
+      for (; i + W <= len; i += W)
+        _mm512_store_si512(d + i, _mm512_loadu_si512(s + i));
+      _mm512_storeu_si512(d, head);
+      _mm512_storeu_si512(d + len - W, tail);
+    }
+
+    /**
+     * Copy with the given vector kernel, which the CPU must support.
+     */
+    template<bool NonTemporal = false>
+    inline void
+    copy_vector(Kernel kernel, void* dst, const void* src, size_t len)
+    {
+      switch (kernel)
+      {
+        case Kernel::AVX512:
+          copy_avx512<NonTemporal>(dst, src, len);
+          return;
+        case Kernel::AVX2:
+          copy_avx2<NonTemporal>(dst, src, len);
+          return;
+        case Kernel::SSE2:
+          copy_sse2<NonTemporal>(dst, src, len);
+          return;
+      }
+    }
+
+    /**
+     * Copy with `rep movsb`, having aligned to a cache line if the source
+     * and destination are equally misaligned.
+     */
+    SNMALLOC_FAST_PATH_INLINE void
+    copy_rep_movsb(void* dst, const void* src, size_t len)
+    {
+      unaligned_start<64, 16>(dst, src, len);
+#  ifdef __GNUC__
+      asm volatile("rep movsb" : "+S"(src), "+D"(dst), "+c"(len) : : "memory");
+#  elif defined(_MSC_VER)
+      __movsb(
+        static_cast<unsigned char*>(dst),
+        static_cast<const unsigned char*>(src),
+        len);
+#  else
+#    error No inline assembly or rep movsb intrinsic for this compiler.
+#  endif
+    }
+
+    /**
+     * The set kernels, like the block copy kernels above.  These need `len` to
+     * be at least one vector.
+     */
+    template<bool NonTemporal>
+    NOINLINE inline void set_sse2(void* dst, int c, size_t len)
+    {
+      using V = __m128i;
+      constexpr size_t W = sizeof(V);
+      auto d = static_cast<char*>(dst);
+      V v = _mm_set1_epi8(static_cast<char>(c));
+      _mm_storeu_si128(reinterpret_cast<V*>(d), v);
+      _mm_storeu_si128(reinterpret_cast<V*>(d + len - W), v);
+
+      size_t i = W - (address_cast(d) & (W - 1));
+      for (; i + 4 * W <= len; i += 4 * W)
+      {
+        for (size_t j = 0; j < 4 * W; j += W)
+        {
+          if constexpr (NonTemporal)
+            _mm_stream_si128(reinterpret_cast<V*>(d + i + j), v);
+          else
+            _mm_store_si128(reinterpret_cast<V*>(d + i + j), v);
+        }
+      }
+      if constexpr (NonTemporal)
+        _mm_sfence();
+      for (; i + W <= len; i += W)
+        _mm_store_si128(reinterpret_cast<V*>(d + i), v);
+    }
+
+    template<bool NonTemporal>
+    SNMALLOC_TARGET("avx2")
+    NOINLINE inline void set_avx2(void* dst, int c, size_t len)
+    {
+      using V = __m256i;
+      constexpr size_t W = sizeof(V);
+      auto d = static_cast<char*>(dst);
+      V v = _mm256_set1_epi8(static_cast<char>(c));
+      _mm256_storeu_si256(reinterpret_cast<V*>(d), v);
+      _mm256_storeu_si256(reinterpret_cast<V*>(d + len - W), v);
+
+      size_t i = W - (address_cast(d) & (W - 1));
+      for (; i + 4 * W <= len; i += 4 * W)
+      {
+        for (size_t j = 0; j < 4 * W; j += W)
+        {
+          if constexpr (NonTemporal)
+            _mm256_stream_si256(reinterpret_cast<V*>(d + i + j), v);
+          else
+            _mm256_store_si256(reinterpret_cast<V*>(d + i + j), v);
+        }
+      }
+      if constexpr (NonTemporal)
+        _mm_sfence();
+      for (; i + W <= len; i += W)
+        _mm256_store_si256(reinterpret_cast<V*>(d + i), v);
+    }
+
+    template<bool NonTemporal>
+    SNMALLOC_TARGET("avx512f")
+    NOINLINE inline void set_avx512(void* dst, int c, size_t len)
+    {
+      using V = __m512i;
+      constexpr size_t W = sizeof(V);
+      auto d = static_cast<char*>(dst);
+      V v = _mm512_set1_epi8(static_cast<char>(c));
+      _mm512_storeu_si512(d, v);
+      _mm512_storeu_si512(d + len - W, v);
+
+      size_t i = W - (address_cast(d) & (W - 1));
+      for (; i + 4 * W <= len; i += 4 * W)
+      {
+        for (size_t j = 0; j < 4 * W; j += W)
+        {
+          if constexpr (NonTemporal)
+            _mm512_stream_si512(reinterpret_cast<V*>(d + i + j), v);
+          else
+            _mm512_store_si512(d + i + j, v);
+        }
+      }
+      if constexpr (NonTemporal)
+        _mm_sfence();
+      for (; i + W <= len; i += W)
+        _mm512_store_si512(d + i, v);
+    }
+
+    /**
+     * Set with the given vector kernel, which the CPU must support.
+     */
+    template<bool NonTemporal = false>
+    inline void set_vector(Kernel kernel, void* dst, int c, size_t len)
+    {
+      switch (kernel)
+      {
+        case Kernel::AVX512:
+          set_avx512<NonTemporal>(dst, c, len);
+          return;
+        case Kernel::AVX2:
+          set_avx2<NonTemporal>(dst, c, len);
+          return;
+        case Kernel::SSE2:
+          set_sse2<NonTemporal>(dst, c, len);
+          return;
+      }
+    }
+
+    SNMALLOC_FAST_PATH_INLINE void set_rep_stosb(void* dst, int c, size_t len)
+    {
+#  ifdef __GNUC__
+      asm volatile("rep stosb" : "+D"(dst), "+c"(len) : "a"(c) : "memory");
+#  elif defined(_MSC_VER)
+      __stosb(
+        static_cast<unsigned char*>(dst), static_cast<unsigned char>(c), len);
+#  else
+#    error No inline assembly or rep stosb intrinsic for this compiler.
+#  endif
+    }
+
+    /**
+     * Set at least 512 bytes with whichever of the above suits the size on
+     * this CPU.  Enhanced `rep movsb` speeds up `rep stosb` alike, but with
+     * no loads to wait for the string instruction overtakes the vector loops
+     * at about half the size that it does for copies.
+     */
+    SNMALLOC_SLOW_PATH inline void set_large(void* dst, int c, size_t len)
+    {
+      auto p = plan();
+      if (SNMALLOC_UNLIKELY((len >> p.non_temporal_bits) != 0))
+        set_vector<true>(p.kernel, dst, c, len);
+      else if ((len >> (p.rep_movsb_bits - 1)) != 0)
+        set_rep_stosb(dst, c, len);
+      else
+        set_vector(p.kernel, dst, c, len);
+    }
+
+    /**
+     * Copy at least 512 bytes with whichever of the above suits the size on
+     * this CPU.
+     */
+    SNMALLOC_SLOW_PATH inline void
+    copy_large(void* dst, const void* src, size_t len)
+    {
+      auto p = plan();
+      if (SNMALLOC_UNLIKELY((len >> p.non_temporal_bits) != 0))
+        copy_vector<true>(p.kernel, dst, src, len);
+      else if ((len >> p.rep_movsb_bits) != 0)
+        copy_rep_movsb(dst, src, len);
+      else
+        copy_vector(p.kernel, dst, src, len);
+    }
+  } // namespace x86_copy
+
   /**
    * x86-64 architecture.  Prefers SSE registers for small and medium copies
-   * and uses `rep movsb` for large ones.
+   * and, for large ones, picks between `rep movsb` and AVX-512, AVX2 or SSE
+   * kernels by what the CPU supports, see `x86_copy`.
    */
   struct X86_64Arch
   {
@@ -325,13 +1092,14 @@ namespace snmalloc
      * machine level: the compiler may spill temporaries to the stack, just not
      * to the source or destination object.
      *
-     * We set this to 16 unconditionally for now because using AVX registers
-     * imposes stronger alignment requirements that seem to not be a net win.
+     * We set this to 16 unconditionally because the inline paths are compiled
+     * for the baseline ISA; wider registers are only used by the out-of-line
+     * kernels for large copies, once the CPU is known to have them.
      */
     static constexpr size_t LargestRegisterSize = 16;
 
     /**
-     * Platform-specific copy hook.  For large copies, use `rep movsb`.
+     * Platform-specific copy hook.  Large copies go to `x86_copy`.
      */
     static inline void* copy(void* dst, const void* src, size_t len)
     {
@@ -343,27 +1111,13 @@ namespace snmalloc
         small_copies<LargestRegisterSize>(dst, src, len);
       }
 
-      // The Intel optimisation manual recommends doing this for sizes >256
+      // The Intel optimisation manual recommends `rep movsb` for sizes >256
       // bytes on modern systems and for all sizes on very modern systems.
-      // Testing shows that this is somewhat overly optimistic.
+      // Testing shows that this is somewhat overly optimistic, so below 512
+      // bytes stay inline and let x86_copy choose above it.
       else if (SNMALLOC_UNLIKELY(len >= 512))
       {
-        // Align to cache-line boundaries if possible.
-        unaligned_start<64, LargestRegisterSize>(dst, src, len);
-        // Bulk copy.  This is aggressively optimised on modern x86 cores.
-#  ifdef __GNUC__
-        asm volatile("rep movsb"
-                     : "+S"(src), "+D"(dst), "+c"(len)
-                     :
-                     : "memory");
-#  elif defined(_MSC_VER)
-        __movsb(
-          static_cast<unsigned char*>(dst),
-          static_cast<const unsigned char*>(src),
-          len);
-#  else
-#    error No inline assembly or rep movsb intrinsic for this compiler.
-#  endif
+        x86_copy::copy_large(dst, src, len);
       }
 
       // Otherwise do a simple bulk copy loop.
@@ -374,6 +1128,40 @@ namespace snmalloc
       }
       return orig_dst;
     }
+
+    /**
+     * Platform-specific move hook.  Moves between buffers that do not overlap
+     * are copies; others use SSE registers in the safe direction.
+     */
+    static inline void* move(void* dst, const void* src, size_t len)
+    {
+      if (len <= LargestRegisterSize)
+        small_move<LargestRegisterSize>(dst, src, len);
+      else if (!overlaps(dst, src, len))
+        copy(dst, src, len);
+      else
+        block_move<LargestRegisterSize>(dst, src, len);
+      return dst;
+    }
+
+    /**
+     * Platform-specific set hook.  Large sets go to `x86_copy`.
+     */
+    static inline void* set(void* dst, int c, size_t len)
+    {
+      if (SNMALLOC_UNLIKELY(len >= 512))
+      {
+        x86_copy::set_large(dst, c, len);
+        return dst;
+      }
+
+      auto block = splat<LargestRegisterSize>(c);
+      if (len <= LargestRegisterSize)
+        small_set<LargestRegisterSize>(dst, &block, len);
+      else
+        block_set<LargestRegisterSize>(dst, &block, len);
+      return dst;
+    }
   };
 #endif
 
@@ -413,6 +1201,27 @@ namespace snmalloc
       }
       return orig_dst;
     }
+
+    static void* move(void* dst, const void* src, size_t len)
+    {
+      if (len <= LargestRegisterSize)
+        small_move<LargestRegisterSize>(dst, src, len);
+      else if (!overlaps(dst, src, len))
+        copy(dst, src, len);
+      else
+        block_move<LargestRegisterSize>(dst, src, len);
+      return dst;
+    }
+
+    static void* set(void* dst, int c, size_t len)
+    {
+      auto block = splat<LargestRegisterSize>(c);
+      if (len <= LargestRegisterSize)
+        small_set<LargestRegisterSize>(dst, &block, len);
+      else
+        block_set<LargestRegisterSize>(dst, &block, len);
+      return dst;
+    }
   };
 #endif
 
@@ -438,6 +1247,8 @@ namespace snmalloc
    *    of `memcpy` and returns `true` if it performs a copy, `false`
    *    otherwise.  This can be used to special-case some or all sizes for a
    *    particular architecture.
+   *  - `move` and `set` functions that do the same for `memmove` and
+   *    `memset`, for the functions below.
    */
   template<
     bool Checked,
@@ -454,4 +1265,39 @@ namespace snmalloc
           [&]() { return Arch::copy(dst, src, len); });
       });
   }
+
+  /**
+   * Snmalloc checked memmove.  Like `memcpy`, this checks that the destination,
+   * and if `ReadsChecked` the source, are within one heap allocation.
+   */
+  template<
+    bool Checked,
+    bool ReadsChecked = CheckReads,
+    typename Arch = DefaultArch>
+  SNMALLOC_FAST_PATH_INLINE void*
+  memmove(void* dst, const void* src, size_t len)
+  {
+    return check_bound<(Checked && ReadsChecked)>(
+      src, len, "memmove with source out of bounds of heap allocation", [&]() {
+        return check_bound<Checked>(
+          dst,
+          len,
+          "memmove with destination out of bounds of heap allocation",
+          [&]() { return Arch::move(dst, src, len); });
+      });
+  }
+
+  /**
+   * Snmalloc checked memset.  This checks that the destination is within one
+   * heap allocation.
+   */
+  template<bool Checked, typename Arch = DefaultArch>
+  SNMALLOC_FAST_PATH_INLINE void* memset(void* dst, int c, size_t len)
+  {
+    return check_bound<Checked>(
+      dst,
+      len,
+      "memset with destination out of bounds of heap allocation",
+      [&]() { return Arch::set(dst, c, len); });
+  }
 } // namespace snmalloc
@@ -45,6 +45,15 @@ extern "C" void* __dso_handle;
 #endif
 extern "C" void _malloc_thread_cleanup();
 
+#if defined(SNMALLOC_PER_CPU_ALLOC)
+#  if defined(SNMALLOC_EXTERNAL_THREAD_ALLOC)
+#    error SNMALLOC_PER_CPU_ALLOC and SNMALLOC_EXTERNAL_THREAD_ALLOC conflict.
+#  endif
+#  if defined(SNMALLOC_PTHREAD_ATFORK_WORKS)
+#    include <pthread.h>
+#  endif
+#endif
+
 namespace snmalloc
 {
 #ifdef SNMALLOC_EXTERNAL_THREAD_ALLOC
@@ -63,6 +72,15 @@ namespace snmalloc
       return ThreadAllocExternal::get();
     }
 
+    /**
+     * Run `f` with the allocator for this thread.
+     */
+    template<typename F>
+    static SNMALLOC_FAST_PATH decltype(auto) with(F&& f)
+    {
+      return f(get());
+    }
+
     static void teardown() {}
 
     // This will always call the success path as the client is responsible
@@ -70,6 +88,159 @@ namespace snmalloc
     using CheckInit = CheckInitNoOp;
   };
 
+#elif defined(SNMALLOC_PER_CPU_ALLOC)
+  /**
+   * The allocator for one CPU, and whether a thread has claimed it.
+   */
+  struct alignas(CACHELINE_SIZE) PerCpuSlot
+  {
+    stl::Atomic<bool> claimed{false};
+    Alloc* alloc{nullptr};
+  };
+
+  /**
+   * Version of the `ThreadAlloc` interface that shares one allocator between
+   * the threads running on each CPU, rather than giving each thread its own.
+   * With many more threads than CPUs, this bounds the memory held in
+   * allocator caches, and the number of remote queues, by the number of
+   * CPUs rather than threads.
+   *
+   * Each operation runs under `with`, which claims the allocator for the
+   * current CPU for its duration.  The claim only fails if another thread
+   * was preempted or migrated while holding it, in which case the next
+   * allocator along is used rather than waiting for that thread.  Claiming
+   * is an atomic exchange and releasing a release store, on every operation,
+   * which the per-thread allocator does not pay.
+   *
+   * There is no `get`, as no thread owns an allocator: callers that need the
+   * allocator itself use `with`.
+   */
+  class ThreadAlloc
+  {
+    /**
+     * Number of allocators.  CPUs beyond this share allocators modulo it.
+     */
+    static constexpr size_t MAX_CPUS = 256;
+
+    using Slot = PerCpuSlot;
+
+    SNMALLOC_REQUIRE_CONSTINIT
+    static inline Slot slots[MAX_CPUS]{};
+
+    /**
+     * Releases a claimed slot on scope exit.
+     */
+    class Claim
+    {
+      Slot& slot;
+
+    public:
+      Claim(Slot& slot) : slot(slot) {}
+
+      ~Claim()
+      {
+        slot.claimed.store(false, stl::memory_order_release);
+      }
+    };
+
+    static SNMALLOC_FAST_PATH bool try_claim(Slot& slot)
+    {
+      return !slot.claimed.load(stl::memory_order_relaxed) &&
+        !slot.claimed.exchange(true, stl::memory_order_acquire);
+    }
+
+    static SNMALLOC_FAST_PATH Slot& claim()
+    {
+      size_t cpu = Config::Pal::current_cpu();
+      while (true)
+      {
+        auto& slot = slots[cpu % MAX_CPUS];
+        if (SNMALLOC_LIKELY(try_claim(slot)))
+          return slot;
+        cpu++;
+      }
+    }
+
+#  if defined(SNMALLOC_PTHREAD_ATFORK_WORKS)
+    /**
+     * A fork while a thread has claimed a slot would leave the allocator
+     * claimed forever in the child, so claim them all across the fork.
+     * Registered after the handlers for the allocator's own locks, so this
+     * runs before them and no thread is left waiting for those with a slot
+     * claimed.
+     */
+    static void prefork()
+    {
+      for (auto& slot : slots)
+      {
+        while (!try_claim(slot))
+          Aal::pause();
+      }
+    }
+
+    static void postfork()
+    {
+      for (auto& slot : slots)
+        slot.claimed.store(false, stl::memory_order_release);
+    }
+#  endif
+
+    SNMALLOC_SLOW_PATH static void init_slot(Slot& slot)
+    {
+      slot.alloc = AllocPool<Config>::acquire();
+
+#  if defined(SNMALLOC_PTHREAD_ATFORK_WORKS)
+      static stl::Atomic<bool> fork_handlers{false};
+      if (!fork_handlers.exchange(true))
+        pthread_atfork(prefork, postfork, postfork);
+#  endif
+    }
+
+  public:
+    static_assert(
+      pal_supports<CurrentCpu, Config::Pal>,
+      "SNMALLOC_PER_CPU_ALLOC needs a PAL that reports the current CPU");
+
+    /**
+     * Run `f` with the allocator for the current CPU, which no other thread
+     * uses until `f` returns.
+     */
+    template<typename F>
+    static SNMALLOC_FAST_PATH decltype(auto) with(F&& f)
+    {
+      auto& slot = claim();
+      Claim c(slot);
+      if (SNMALLOC_UNLIKELY(slot.alloc == nullptr))
+        init_slot(slot);
+      return f(*slot.alloc);
+    }
+
+    /**
+     * Run `f` with each CPU's allocator in turn, waiting for any thread
+     * using it to finish.  Must not be called from within `with`.
+     */
+    template<typename F>
+    static void with_each(F&& f)
+    {
+      for (auto& slot : slots)
+      {
+        while (!try_claim(slot))
+          Aal::pause();
+        Claim c(slot);
+        if (slot.alloc != nullptr)
+          f(*slot.alloc);
+      }
+    }
+
+    /**
+     * Threads own no allocator state, so there is nothing to tear down.
+     */
+    static void teardown() {}
+
+    // Allocators are initialised by `with`.
+    using CheckInit = CheckInitNoOp;
+  };
+
 #else
 
   class CheckInitPthread;
@@ -116,6 +287,15 @@ namespace snmalloc
       return *alloc;
     }
 
+    /**
+     * Run `f` with the allocator for this thread.
+     */
+    template<typename F>
+    static SNMALLOC_FAST_PATH decltype(auto) with(F&& f)
+    {
+      return f(get());
+    }
+
     static void teardown()
     {
       // No work required for teardown.
@@ -0,0 +1,252 @@
+#pragma once
+
+#include "../ds/ds.h"
+#include "sizeclasstable.h"
+
+#include <stdint.h>
+
+namespace snmalloc
+{
+  /**
+   * Allocation statistics, either for a single allocator or summed over every
+   * allocator that has folded its counters into the global totals.
+   *
+   * All counts are cumulative; the derived accessors give the current values.
+   */
+  struct AllocStatsSnapshot
+  {
+    struct SizeclassStats
+    {
+      uint64_t allocs = 0;
+      uint64_t deallocs = 0;
+      uint64_t slabs_allocated = 0;
+      uint64_t slabs_released = 0;
+    };
+
+    SizeclassStats small[NUM_SMALL_SIZECLASSES]{};
+
+    uint64_t large_allocs = 0;
+    uint64_t large_deallocs = 0;
+    uint64_t large_bytes_allocated = 0;
+    uint64_t large_bytes_deallocated = 0;
+
+    /**
+     * Objects freed by a thread other than their owner, and their size.
+     */
+    uint64_t remote_deallocs = 0;
+    uint64_t remote_bytes_sent = 0;
+
+    /**
+     * Bytes of remote frees that have been handed back to the owning slabs.
+     */
+    uint64_t remote_bytes_received = 0;
+
+    /**
+     * Memory committed by the backend, filled in by `get_stats`.
+     */
+    size_t committed_bytes = 0;
+    size_t peak_committed_bytes = 0;
+
+    constexpr AllocStatsSnapshot() = default;
+
+    void add(const AllocStatsSnapshot& other)
+    {
+      for (size_t i = 0; i < NUM_SMALL_SIZECLASSES; i++)
+      {
+        small[i].allocs += other.small[i].allocs;
+        small[i].deallocs += other.small[i].deallocs;
+        small[i].slabs_allocated += other.small[i].slabs_allocated;
+        small[i].slabs_released += other.small[i].slabs_released;
+      }
+      large_allocs += other.large_allocs;
+      large_deallocs += other.large_deallocs;
+      large_bytes_allocated += other.large_bytes_allocated;
+      large_bytes_deallocated += other.large_bytes_deallocated;
+      remote_deallocs += other.remote_deallocs;
+      remote_bytes_sent += other.remote_bytes_sent;
+      remote_bytes_received += other.remote_bytes_received;
+    }
+
+    uint64_t live_objects(smallsizeclass_t sizeclass) const
+    {
+      return small[sizeclass].allocs - small[sizeclass].deallocs;
+    }
+
+    uint64_t live_slabs(smallsizeclass_t sizeclass) const
+    {
+      return small[sizeclass].slabs_allocated - small[sizeclass].slabs_released;
+    }
+
+    /**
+     * Bytes of small objects handed to the application and not yet freed.
+     */
+    uint64_t small_bytes_allocated() const
+    {
+      uint64_t result = 0;
+      for (smallsizeclass_t i = 0; i < NUM_SMALL_SIZECLASSES; i++)
+        result += live_objects(i) * sizeclass_to_size(i);
+      return result;
+    }
+
+    /**
+     * Bytes held in slabs, whether or not their objects are in use.
+     */
+    uint64_t slab_bytes() const
+    {
+      uint64_t result = 0;
+      for (smallsizeclass_t i = 0; i < NUM_SMALL_SIZECLASSES; i++)
+        result += live_slabs(i) * sizeclass_to_slab_size(i);
+      return result;
+    }
+
+    uint64_t large_bytes() const
+    {
+      return large_bytes_allocated - large_bytes_deallocated;
+    }
+
+    /**
+     * Bytes freed remotely that have not yet been returned to their owner:
+     * sitting in remote deallocation caches or in message queues.
+     */
+    uint64_t remote_bytes_in_flight() const
+    {
+      return remote_bytes_sent - remote_bytes_received;
+    }
+
+    /**
+     * Committed memory that holds neither a slab nor a large allocation.  This
+     * is the free memory cached by the backend's buddy allocators, plus the
+     * allocator and slab metadata.
+     */
+    uint64_t retained_bytes() const
+    {
+      uint64_t used = slab_bytes() + large_bytes();
+      return committed_bytes > used ? committed_bytes - used : 0;
+    }
+  };
+
+  /**
+   * Per-allocator statistics counters.
+   *
+   * The counters are plain integers written only by the owning thread, so
+   * counting costs an increment to memory the allocator already has in cache.
+   * They become visible to `get_stats` once `fold` has moved them into the
+   * global totals, which the allocator does on every `flush`.
+   *
+   * The disabled specialisation below is empty and every operation on it is a
+   * no-op.
+   */
+  template<bool Enabled = STATS_ENABLED>
+  class AllocStats
+  {
+    AllocStatsSnapshot local{};
+
+    static inline FlagWord global_lock{};
+    static inline AllocStatsSnapshot global{};
+
+  public:
+    constexpr AllocStats() = default;
+
+    SNMALLOC_FAST_PATH void small_alloc(smallsizeclass_t sizeclass)
+    {
+      local.small[sizeclass].allocs++;
+    }
+
+    SNMALLOC_FAST_PATH void large_alloc(size_t size)
+    {
+      local.large_allocs++;
+      local.large_bytes_allocated += size;
+    }
+
+    /**
+     * A large allocation changed size in place.
+     */
+    void large_resize(size_t old_size, size_t new_size)
+    {
+      if (new_size > old_size)
+        local.large_bytes_allocated += new_size - old_size;
+      else
+        local.large_bytes_deallocated += old_size - new_size;
+    }
+
+    SNMALLOC_FAST_PATH void dealloc(sizeclass_t sizeclass)
+    {
+      if (sizeclass.is_small())
+      {
+        local.small[sizeclass.as_small()].deallocs++;
+        return;
+      }
+      local.large_deallocs++;
+      local.large_bytes_deallocated += sizeclass_full_to_size(sizeclass);
+    }
+
+    SNMALLOC_FAST_PATH void remote_dealloc(sizeclass_t sizeclass)
+    {
+      dealloc(sizeclass);
+      local.remote_deallocs++;
+      local.remote_bytes_sent += sizeclass_full_to_size(sizeclass);
+    }
+
+    void remote_received(size_t bytes)
+    {
+      local.remote_bytes_received += bytes;
+    }
+
+    void slab_allocated(smallsizeclass_t sizeclass)
+    {
+      local.small[sizeclass].slabs_allocated++;
+    }
+
+    void slab_released(smallsizeclass_t sizeclass)
+    {
+      local.small[sizeclass].slabs_released++;
+    }
+
+    /**
+     * Add this allocator's counters to the global totals and reset them.
+     */
+    void fold()
+    {
+      with(global_lock, [&]() { global.add(local); });
+      local = AllocStatsSnapshot();
+    }
+
+    /**
+     * Copy out the global totals.  Counts not yet folded are not included.
+     */
+    static void read(AllocStatsSnapshot& result)
+    {
+      with(global_lock, [&]() { result = global; });
+    }
+  };
+
+  template<>
+  class AllocStats<false>
+  {
+  public:
+    constexpr AllocStats() = default;
+
+    void small_alloc(smallsizeclass_t) {}
+
+    void large_alloc(size_t) {}
+
+    void large_resize(size_t, size_t) {}
+
+    void dealloc(sizeclass_t) {}
+
+    void remote_dealloc(sizeclass_t) {}
+
+    void remote_received(size_t) {}
+
+    void slab_allocated(smallsizeclass_t) {}
+
+    void slab_released(smallsizeclass_t) {}
+
+    void fold() {}
+
+    static void read(AllocStatsSnapshot& result)
+    {
+      result = AllocStatsSnapshot();
+    }
+  };
+} // namespace snmalloc
@@ -34,6 +34,121 @@ namespace snmalloc
     return true;
   }
 
+  /**
+   * SFINAE helper.  Matched only if `T` implements `low_memory_epoch`.  Calls
+   * it if it exists.
+   */
+  template<typename T>
+  SNMALLOC_FAST_PATH_INLINE auto call_low_memory_epoch(T*, int)
+    -> decltype(T::low_memory_epoch())
+  {
+    return T::low_memory_epoch();
+  }
+
+  /**
+   * SFINAE helper.  Matched only if `T` does not implement `low_memory_epoch`.
+   * Such a back end never reports low memory, so the epoch never changes.
+   */
+  template<typename T>
+  SNMALLOC_FAST_PATH_INLINE uint64_t call_low_memory_epoch(T*, long)
+  {
+    return 0;
+  }
+
+  /**
+   * SFINAE helper.  Matched only if `T` implements `release_cached_memory`.
+   * Calls it if it exists.
+   */
+  template<typename T, typename LocalState>
+  SNMALLOC_FAST_PATH_INLINE auto call_release_cached_memory(LocalState& ls, int)
+    -> decltype(T::release_cached_memory(ls))
+  {
+    return T::release_cached_memory(ls);
+  }
+
+  /**
+   * SFINAE helper.  Matched only if `T` does not implement
+   * `release_cached_memory`.  Does nothing.
+   */
+  template<typename T, typename LocalState>
+  SNMALLOC_FAST_PATH_INLINE void call_release_cached_memory(LocalState&, long)
+  {}
+
+  /**
+   * SFINAE helper.  Matched only if `T` implements `decay_cached_memory`.
+   * Calls it if it exists.
+   */
+  template<typename T, typename LocalState>
+  SNMALLOC_FAST_PATH_INLINE auto call_decay_cached_memory(
+    LocalState& ls, uint64_t now_ms, uint64_t period_ms, int)
+    -> decltype(T::decay_cached_memory(ls, now_ms, period_ms))
+  {
+    return T::decay_cached_memory(ls, now_ms, period_ms);
+  }
+
+  /**
+   * SFINAE helper.  Matched only if `T` does not implement
+   * `decay_cached_memory`.  Does nothing.
+   */
+  template<typename T, typename LocalState>
+  SNMALLOC_FAST_PATH_INLINE void
+  call_decay_cached_memory(LocalState&, uint64_t, uint64_t, long)
+  {}
+
+  /**
+   * SFINAE helper.  Matched only if `T` implements `resize_chunk`.  Calls it
+   * if it exists.
+   */
+  template<typename T, typename LocalState, typename SlabMetadata>
+  SNMALLOC_FAST_PATH_INLINE auto call_resize_chunk(
+    LocalState& ls,
+    SlabMetadata& meta,
+    capptr::Alloc<void> alloc,
+    size_t old_size,
+    size_t new_size,
+    uintptr_t ras,
+    int) -> decltype(T::resize_chunk(ls, meta, alloc, old_size, new_size, ras))
+  {
+    return T::resize_chunk(ls, meta, alloc, old_size, new_size, ras);
+  }
+
+  /**
+   * SFINAE helper.  Matched only if `T` does not implement `resize_chunk`.
+   * Chunks then never change size in place.
+   */
+  template<typename T, typename LocalState, typename SlabMetadata>
+  SNMALLOC_FAST_PATH_INLINE bool call_resize_chunk(
+    LocalState&,
+    SlabMetadata&,
+    capptr::Alloc<void>,
+    size_t,
+    size_t,
+    uintptr_t,
+    long)
+  {
+    return false;
+  }
+
+  /**
+   * SFINAE helper.  Matched only if `T` implements `bind_to_node`.  Calls it
+   * if it exists.
+   */
+  template<typename T, typename LocalState>
+  SNMALLOC_FAST_PATH_INLINE auto
+  call_bind_to_node(LocalState& ls, size_t node, int)
+    -> decltype(T::bind_to_node(ls, node))
+  {
+    return T::bind_to_node(ls, node);
+  }
+
+  /**
+   * SFINAE helper.  Matched only if `T` does not implement `bind_to_node`.
+   * Does nothing.
+   */
+  template<typename T, typename LocalState>
+  SNMALLOC_FAST_PATH_INLINE void call_bind_to_node(LocalState&, size_t, long)
+  {}
+
   namespace detail
   {
     /**
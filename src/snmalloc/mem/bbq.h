@@ -742,12 +742,14 @@ namespace snmalloc
       }
       else
       {
+        /* with a single consumer there is no reservation in flight to wait
+         * for: the next block is still being drained, so the queue is full*/
         if (
           consumed.meta.ver < head.meta.ver ||
           (consumed.meta.ver == head.meta.ver &&
            consumed.meta.ptr != block_size))
         {
-          return Blockstate::NOT_AVAILABLE;
+          return Blockstate::NO_ENTRY;
         }
       }
 #elif defined(DROP_OLD)
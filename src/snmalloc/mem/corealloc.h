@@ -1,8 +1,11 @@
 #pragma once
 
 #include "../ds/ds.h"
+#include "allocstats.h"
 #include "check_init.h"
+#include "eventtrace.h"
 #include "freelist.h"
+#include "heapprofile.h"
 #include "metadata.h"
 #include "pool.h"
 #include "remotecache.h"
@@ -51,6 +54,35 @@ namespace snmalloc
       return p;
     }
 
+    /**
+     * `success` for a large object, which starts a chunk and covers whole
+     * pages.  The PAL can zero these without touching pages that are not
+     * backed, such as those of fresh or decommitted chunks, where a memset
+     * would commit every page just to write zeros to it.
+     *
+     * Dropping pages costs a TLB shootdown and a fault per page when they
+     * are next used, so below `LARGE_ZERO_BY_PAL_SIZE` a memset of memory
+     * that is likely already hot is cheaper.  With huge pages it is never
+     * used, as it would split the huge pages the backend keeps whole.
+     */
+    template<typename Pal>
+    static void* success_large(void* p, size_t size)
+    {
+      SNMALLOC_ASSERT(p != nullptr);
+
+      if (zero_mem == ZeroMem::YesZero)
+      {
+        size_t rsize = round_size(size);
+        if (
+          !pal_supports<HugePages, Pal> && (rsize >= LARGE_ZERO_BY_PAL_SIZE))
+          Pal::template zero<true>(p, rsize);
+        else
+          ::memset(p, 0, rsize);
+      }
+
+      return p;
+    }
+
     static void* failure(size_t size) noexcept
     {
       UNUSED(size);
@@ -72,6 +104,31 @@ namespace snmalloc
     return Conts::success(capptr_reveal(p.as_void()), size, false);
   }
 
+  /**
+   * Whether `Conts` provides `success_large`.
+   */
+  template<typename Conts, typename Pal, typename = void>
+  static constexpr bool has_success_large = false;
+
+  template<typename Conts, typename Pal>
+  static constexpr bool has_success_large<
+    Conts,
+    Pal,
+    stl::void_t<decltype(Conts::template success_large<Pal>(nullptr, 0))>> =
+    true;
+
+  /**
+   * Finish a large allocation, with `success_large` if `Conts` has it.
+   */
+  template<typename Conts, typename Pal>
+  inline static void* finish_alloc_large(void* p, size_t size)
+  {
+    if constexpr (has_success_large<Conts, Pal>)
+      return Conts::template success_large<Pal>(p, size);
+    else
+      return Conts::success(p, size);
+  }
+
   struct FastFreeLists
   {
     // Free list per small size class.  These are used for
@@ -150,18 +207,14 @@ namespace snmalloc
      */
     LocalEntropy entropy;
 
-    // #if defined(__SNMALLOC_USE_BBQ__)
-    //     mutable MessageQueueStatus st{MessageQueueStatus::BUSY};
-    // #endif
-
     /**
      * Message queue for allocations being returned to this
      * allocator
      */
     stl::conditional_t<
       Config::Options.IsQueueInline,
-      RemoteAllocator,
-      RemoteAllocator*>
+      RemoteAllocatorT<typename Config::RemoteQueue>,
+      RemoteAllocatorT<typename Config::RemoteQueue>*>
       remote_alloc{};
 
     /**
@@ -186,6 +239,28 @@ namespace snmalloc
      */
     Ticker<typename Config::Pal> ticker;
 
+    /**
+     * The backend's low-memory epoch when this allocator last released its
+     * cached memory.
+     */
+    uint64_t low_memory_epoch = 0;
+
+    /**
+     * Allocation statistics, empty unless built with SNMALLOC_STATS.
+     */
+    SNMALLOC_NO_UNIQUE_ADDRESS AllocStats<> stats;
+
+    /**
+     * Heap profile sampling countdown, empty unless built with
+     * SNMALLOC_HEAP_PROFILE.
+     */
+    SNMALLOC_NO_UNIQUE_ADDRESS HeapProfiler<Config> heap_profile;
+
+    /**
+     * Ring of slow-path events, empty unless built with SNMALLOC_EVENT_TRACE.
+     */
+    SNMALLOC_NO_UNIQUE_ADDRESS EventTrace<> trace;
+
     /**
      * The message queue needs to be accessible from other threads
      *
@@ -243,7 +318,6 @@ namespace snmalloc
       return *public_state();
     }
 
-#if !defined(__SNMALLOC_USE_BBQ__)
     /**
      * Check if this allocator has messages to deallocate blocks from another
      * thread
@@ -252,7 +326,6 @@ namespace snmalloc
     {
       return message_queue().can_dequeue();
     }
-#endif
 
     /**
      * Initialiser, shared code between the constructors for different
@@ -269,11 +342,10 @@ namespace snmalloc
       // This must occur before any freelists are constructed.
       entropy.init<typename Config::Pal>();
 
-      // Ignoring stats for now.
-      //      stats().start();
-
       // Initialise the remote cache
       remote_dealloc_cache.init();
+
+      trace.init(public_state()->trunc_id());
     }
 
     /**
@@ -357,7 +429,8 @@ namespace snmalloc
      * configure the message queue for use.
      */
     template<bool InlineQueue = Config::Options.IsQueueInline>
-    stl::enable_if_t<!InlineQueue> init_message_queue(RemoteAllocator* q)
+    stl::enable_if_t<!InlineQueue>
+    init_message_queue(RemoteAllocatorT<typename Config::RemoteQueue>* q)
     {
       remote_alloc = q;
     }
@@ -373,7 +446,7 @@ namespace snmalloc
       // stats().remote_post();  // TODO queue not in line!
       bool sent_something =
         remote_dealloc_cache.template post<sizeof(Allocator)>(
-          backend_state_ptr(), public_state()->trunc_id());
+          backend_state_ptr(), public_state()->trunc_id(), trace);
 
       return sent_something;
     }
@@ -412,26 +485,18 @@ namespace snmalloc
     SNMALLOC_FAST_PATH decltype(auto)
     handle_message_queue(Action action, Args... args) noexcept(noexc)
     {
-#if !defined(__SNMALLOC_USE_BBQ__)
       // Inline the empty check, but not necessarily the full queue handling.
       if (SNMALLOC_LIKELY(!has_messages()))
       {
         return action(args...);
       }
-#else
-      /* we could also early return the handling routine, but there's little
-       * benefit for bbq due to overhead caused by memory accessing*/
-      // if (SNMALLOC_LIKELY(message_queue().is_empty()))
-      //{
-      //   return action(args...);
-      // }
-#endif
 
       return handle_message_queue_slow<noexc>(action, args...);
     }
 
     /**
-     * Process remote frees into this allocator.
+     * Process remote frees into this allocator, within the drain budget set
+     * by `Config::Options`.
      */
     template<bool noexc, typename Action, typename... Args>
     SNMALLOC_FAST_PATH decltype(auto)
@@ -439,17 +504,44 @@ namespace snmalloc
     {
       bool need_post = false;
       size_t bytes_freed = 0;
+      size_t messages = 0;
+      uint64_t start = 0;
+      if constexpr (Config::Options.RemoteDrainTicks != 0)
+        start = Aal::tick();
+
       auto local_state = backend_state_ptr();
       auto domesticate = [local_state](freelist::QueuePtr p)
                            SNMALLOC_FAST_PATH_LAMBDA {
                              return capptr_domesticate<Config>(local_state, p);
                            };
-      auto cb = [this, domesticate, &need_post, &bytes_freed](
+      auto cb = [this, domesticate, &need_post, &bytes_freed, &messages, start](
                   capptr::Alloc<RemoteMessage> msg) SNMALLOC_FAST_PATH_LAMBDA {
         auto& entry =
           Config::Backend::get_metaentry(snmalloc::address_cast(msg));
         handle_dealloc_remote(entry, msg, need_post, domesticate, bytes_freed);
-        return bytes_freed < REMOTE_BATCH_LIMIT;
+        messages++;
+
+        if constexpr (Config::Options.RemoteDrainMessages != 0)
+        {
+          if (messages >= Config::Options.RemoteDrainMessages)
+            return false;
+        }
+
+        if constexpr (Config::Options.RemoteDrainTicks != 0)
+        {
+          // Reading the clock costs about as much as a deallocation.
+          static constexpr size_t tick_interval = 16;
+          if (
+            ((messages % tick_interval) == 0) &&
+            ((Aal::tick() - start) >= Config::Options.RemoteDrainTicks))
+            return false;
+        }
+        else
+        {
+          UNUSED(start);
+        }
+
+        return bytes_freed < Config::Options.RemoteDrainBytes;
       };
 
 #ifdef SNMALLOC_TRACING
@@ -465,41 +557,18 @@ namespace snmalloc
           [](freelist::QueuePtr p) SNMALLOC_FAST_PATH_LAMBDA {
             return freelist::HeadPtr::unsafe_from(p.unsafe_ptr());
           };
-#if defined(__SNMALLOC_USE_BBQ__)
-        while ((
-#endif
-          message_queue().dequeue(domesticate_first, domesticate, cb)
-#if defined(__SNMALLOC_USE_BBQ__)
-            ))
-        {
-          if (SNMALLOC_LIKELY(
-                message_queue().status == MessageQueueStatus::EMPTY))
-          {
-            return action(args...);
-          }
-        }
-#endif
-        ;
+        message_queue().template dequeue<Config>(
+          domesticate_first, domesticate, cb, local_state);
       }
       else
       {
-#if defined(__SNMALLOC_USE_BBQ__)
-        while ((
-#endif
-          message_queue().dequeue(domesticate, domesticate, cb)
-#if defined(__SNMALLOC_USE_BBQ__)
-            ))
-        {
-          if (SNMALLOC_LIKELY(
-                message_queue().status == MessageQueueStatus::EMPTY))
-          {
-            return action(args...);
-          }
-        }
-#endif
-        ;
+        message_queue().template dequeue<Config>(
+          domesticate, domesticate, cb, local_state);
       }
 
+      if (messages != 0)
+        trace.drain(messages, bytes_freed);
+
       if (need_post)
       {
         post();
@@ -522,16 +591,17 @@ namespace snmalloc
       Domesticator_queue domesticate,
       size_t& bytes_returned)
     {
-      // TODO this needs to not double count stats
       // TODO this needs to not double revoke if using MTE
       // TODO thread capabilities?
 
       if (SNMALLOC_LIKELY(entry.get_remote() == public_state()))
       {
         auto meta = entry.get_slab_metadata();
+        size_t bytes_before = bytes_returned;
 
         auto unreturned = dealloc_local_objects_fast(
           msg, entry, meta, entropy, domesticate, bytes_returned);
+        stats.remote_received(bytes_returned - bytes_before);
 
         /*
          * dealloc_local_objects_fast has updated the free list but not updated
@@ -617,13 +687,14 @@ namespace snmalloc
      *      - if no fast free list,
      *         - check for message queue
      *         - small_refill(size_t)
-     *           - If another free list is available, use it.
+     *           - If another free list is available, use it, carving
+     *             another batch of its slab first with lazy slab carving.
      *           - Otherwise,
      *             - Check if the allocator has been initialised, if it hasn't
      *               restart with a fresh allocator.
      *             - Otherwise, call small_refill_slow(size_t) which allocates
      *               a new slab and fills it with a free list using
-     *               alloc_new_list.
+     *               alloc_new_list, or only its first batch using carve.
      *    - static alloc_not_small(size_t, Allocator*)
      *      - If size is zero, call small_alloc(1) - this deals with the
      *        annoying case of zero off the fast path.
@@ -678,7 +749,11 @@ namespace snmalloc
       auto* fl = &small_fast_free_lists[sizeclass];
       if (SNMALLOC_LIKELY(!fl->empty()))
       {
+        if (SNMALLOC_UNLIKELY(heap_profile.count(size)))
+          return alloc_sampled<Conts>(size);
+
         auto p = fl->take(key, domesticate);
+        stats.small_alloc(sizeclass);
         return finish_alloc<Conts>(p, size);
       }
 
@@ -738,40 +813,17 @@ namespace snmalloc
                 return Conts::success(result, size, true);
               }
 
-              // Grab slab of correct size
-              // Set remote as large allocator remote.
-              auto [chunk, meta] = Config::Backend::alloc_chunk(
-                self->get_backend_local_state(),
-                large_size_to_chunk_size(size),
-                PagemapEntry::encode(
-                  self->public_state(), size_to_sizeclass_full(size)),
-                size_to_sizeclass_full(size));
-
-#ifdef SNMALLOC_TRACING
-              message<1024>(
-                "size {} pow2size {}", size, bits::next_pow2_bits(size));
-#endif
-
-              SNMALLOC_ASSERT(
-                (chunk.unsafe_ptr() == nullptr) == (meta == nullptr));
+              void* p = self->alloc_large_chunk(size);
+              if (p == nullptr)
+                return Conts::failure(size);
 
-              // set up meta data so sizeclass is correct, and hence alloc size,
-              // and external pointer. Initialise meta data for a successful
-              // large allocation.
-              if (meta != nullptr)
+              if (SNMALLOC_UNLIKELY(self->heap_profile.count(size)))
               {
-                meta->initialise_large(
-                  address_cast(chunk), freelist::Object::key_root);
-                self->laden.insert(meta);
-
-                // Make capptr system happy we are allowed to pass this to
-                // `success`.
-                auto p = capptr_reveal(
-                  capptr_chunk_is_alloc(capptr_to_user_address_control(chunk)));
-                return Conts::success(p, size);
+                if (self->heap_profile.should_sample(self->entropy))
+                  self->record_sample(p, size);
               }
 
-              return Conts::failure(size);
+              return finish_alloc_large<Conts, typename Config::Pal>(p, size);
             },
             [](Allocator* a, size_t size) SNMALLOC_FAST_PATH_LAMBDA {
               return alloc_not_small<Conts, CheckInitNoOp>(size, a);
@@ -782,6 +834,173 @@ namespace snmalloc
         size);
     }
 
+  private:
+    /**
+     * Allocate a chunk of `size` bytes, rounded up to a power of two, for a
+     * large object.  Returns nullptr if the backend is out of memory.
+     */
+    void* alloc_large_chunk(size_t size)
+    {
+      size_t chunk_size = large_size_to_chunk_size(size);
+      // Not `size_to_sizeclass_full`, as heap profile samples need a large
+      // class for chunks that could hold a small object.
+      auto sizeclass =
+        sizeclass_t::from_large_class(bits::clz(chunk_size - 1));
+
+      // Grab slab of correct size
+      // Set remote as large allocator remote.
+      auto [chunk, meta] = Config::Backend::alloc_chunk(
+        get_backend_local_state(),
+        chunk_size,
+        PagemapEntry::encode(public_state(), sizeclass),
+        sizeclass);
+
+#ifdef SNMALLOC_TRACING
+      message<1024>("size {} pow2size {}", size, bits::next_pow2_bits(size));
+#endif
+
+      SNMALLOC_ASSERT((chunk.unsafe_ptr() == nullptr) == (meta == nullptr));
+
+      if (meta == nullptr)
+        return nullptr;
+
+      // set up meta data so sizeclass is correct, and hence alloc size, and
+      // external pointer. Initialise meta data for a successful large
+      // allocation.
+      meta->initialise_large(address_cast(chunk), freelist::Object::key_root);
+      laden.insert(meta);
+      stats.large_alloc(chunk_size);
+      trace.alloc_chunk(sizeclass, chunk_size);
+
+      // Make capptr system happy we are allowed to pass this to `success`.
+      return capptr_reveal(
+        capptr_chunk_is_alloc(capptr_to_user_address_control(chunk)));
+    }
+
+    /**
+     * Slow path for a small allocation that has used up the heap profile
+     * countdown.  If it is a sample, it is given a chunk of its own, whose
+     * metadata carries the sample until the object is freed.
+     */
+    template<typename Conts>
+    SNMALLOC_SLOW_PATH void*
+    alloc_sampled(size_t size) noexcept(noexcept(Conts::failure(0)))
+    {
+      if (!heap_profile.should_sample(entropy))
+        return small_alloc<Conts, CheckInitNoOp>(size);
+
+      void* p = alloc_large_chunk(bits::max(size, MIN_CHUNK_SIZE));
+      if (p == nullptr)
+        return Conts::failure(size);
+
+      record_sample(p, size);
+      return Conts::success(p, size);
+    }
+
+    /**
+     * Attach a heap profile sample of `size` bytes to the chunk at `p`.
+     */
+    void record_sample(void* p, size_t size)
+    {
+      if constexpr (HEAP_PROFILE_ENABLED)
+      {
+        auto* meta =
+          Config::Backend::get_metaentry(address_cast(p)).get_slab_metadata();
+        meta->heap_sample() = HeapProfiler<Config>::record(size);
+      }
+      else
+      {
+        UNUSED(p, size);
+      }
+    }
+
+  public:
+    /**
+     * Allocates `n` blocks of `size` bytes into `out`.  Returns the number
+     * allocated, which is less than `n` only if an allocation failed.
+     *
+     * For small sizes the size class is resolved once, and each run of the
+     * fast free list is drained in a tight loop.  When it runs dry a single
+     * `small_alloc` handles messages and refills the list from a whole slab.
+     */
+    template<typename Conts = Uninit, typename CheckInit = CheckInitNoOp>
+    size_t alloc_batch(size_t size, size_t n, void** out) noexcept(
+      noexcept(Conts::failure(0)))
+    {
+      return CheckInit::check_init(
+        [this, size, n, out]() SNMALLOC_FAST_PATH_LAMBDA {
+          return alloc_batch_inner<Conts>(size, n, out);
+        },
+        [](Allocator* a, size_t size, size_t n, void** out)
+          SNMALLOC_FAST_PATH_LAMBDA {
+            return a->alloc_batch_inner<Conts>(size, n, out);
+          },
+        size,
+        n,
+        out);
+    }
+
+  private:
+    template<typename Conts>
+    SNMALLOC_FAST_PATH size_t
+    alloc_batch_inner(size_t size, size_t n, void** out) noexcept(
+      noexcept(Conts::failure(0)))
+    {
+      size_t i = 0;
+
+      // As for `alloc`, zero-sized requests get the smallest object.
+      if (size == 0)
+        size = 1;
+
+      if (!is_small_sizeclass(size))
+      {
+        for (; i < n; i++)
+        {
+          out[i] = alloc<Conts>(size);
+          if (out[i] == nullptr)
+            break;
+        }
+        return i;
+      }
+
+      auto domesticate =
+        [this](freelist::QueuePtr p) SNMALLOC_FAST_PATH_LAMBDA {
+          return capptr_domesticate<Config>(backend_state_ptr(), p);
+        };
+
+      auto& key = freelist::Object::key_root;
+      smallsizeclass_t sizeclass = size_to_sizeclass(size);
+      auto& fl = small_fast_free_lists[sizeclass];
+      while (i < n)
+      {
+        while (!fl.empty() && i < n)
+        {
+          if (SNMALLOC_UNLIKELY(heap_profile.count(size)))
+          {
+            out[i] = alloc_sampled<Conts>(size);
+            if (out[i] == nullptr)
+              return i;
+            i++;
+            continue;
+          }
+
+          auto p = fl.take(key, domesticate);
+          stats.small_alloc(sizeclass);
+          out[i++] = finish_alloc<Conts>(p, size);
+        }
+
+        if (i == n)
+          break;
+
+        out[i] = small_alloc<Conts, CheckInitNoOp>(size);
+        if (out[i] == nullptr)
+          break;
+        i++;
+      }
+      return i;
+    }
+
+  public:
     template<typename Conts, typename CheckInit>
     SNMALLOC_FAST_PATH void* small_refill(
       smallsizeclass_t sizeclass,
@@ -830,6 +1049,12 @@ namespace snmalloc
         if (meta->needed() == 0)
           alloc_classes[sizeclass].unused--;
 
+        if constexpr (LAZY_SLAB_ENABLED)
+        {
+          if (meta->uncarved() != 0)
+            carve(meta, sizeclass);
+        }
+
         auto domesticate =
           [this](freelist::QueuePtr p) SNMALLOC_FAST_PATH_LAMBDA {
             return capptr_domesticate<Config>(backend_state_ptr(), p);
@@ -847,8 +1072,13 @@ namespace snmalloc
           laden.insert(meta);
         }
 
+        trace.refill(sizeclass, 0);
+        stats.small_alloc(sizeclass);
+        // Samples are taken on the fast path; if this uses up the heap
+        // profile countdown, the next allocation from a free list is one.
+        heap_profile.count(size);
         auto r = finish_alloc<Conts>(p, size);
-        return ticker.check_tick(r);
+        return tick(r);
       }
       return small_refill_slow<Conts, CheckInit>(
         sizeclass, fast_free_list, size);
@@ -887,9 +1117,21 @@ namespace snmalloc
           // Set meta slab to empty.
           meta->initialise(
             sizeclass, address_cast(slab), freelist::Object::key_root);
+          stats.slab_allocated(sizeclass);
+          trace.refill(sizeclass, slab_size);
 
-          // Build a free list for the slab
-          alloc_new_list(slab, meta, rsize, slab_size, entropy);
+          if constexpr (LAZY_SLAB_ENABLED)
+          {
+            // Build the free list a batch at a time as it is used.
+            meta->bump() = slab;
+            meta->uncarved() = sizeclass_to_slab_object_count(sizeclass);
+            carve(meta, sizeclass);
+          }
+          else
+          {
+            // Build a free list for the slab
+            alloc_new_list(slab, meta, rsize, slab_size, entropy);
+          }
 
           auto domesticate =
             [this](freelist::QueuePtr p) SNMALLOC_FAST_PATH_LAMBDA {
@@ -908,8 +1150,12 @@ namespace snmalloc
             laden.insert(meta);
           }
 
+          stats.small_alloc(sizeclass);
+          // Samples are taken on the fast path; if this uses up the heap
+          // profile countdown, the next allocation from a free list is one.
+          heap_profile.count(size);
           auto r = finish_alloc<Conts>(p, size);
-          return ticker.check_tick(r);
+          return tick(r);
         },
         [](Allocator* a, size_t size) SNMALLOC_FAST_PATH_LAMBDA {
           return a->small_alloc<Conts, CheckInitNoOp>(size);
@@ -917,6 +1163,10 @@ namespace snmalloc
         size);
     }
 
+    /**
+     * Threads the objects in the `slab_size` bytes from `bumpptr` onto the
+     * free queue of `meta`.  This is a whole slab, or a batch of one.
+     */
     static SNMALLOC_FAST_PATH void alloc_new_list(
       capptr::Chunk<void>& bumpptr,
       BackendSlabMetadata* meta,
@@ -1010,6 +1260,30 @@ namespace snmalloc
       bumpptr = slab_end;
     }
 
+    /**
+     * Threads the next batch of a lazily carved slab onto its free queue.  A
+     * batch is a page of objects, or one object if they are bigger, so a
+     * refill touches about a page however big the slab.  Each batch is
+     * shuffled separately when `random_initial` is on.
+     *
+     * The last batch takes everything if what would be left is too little to
+     * wake the slab: a sleeping slab is in no list to carve it from.
+     */
+    SNMALLOC_SLOW_PATH void
+    carve(BackendSlabMetadata* meta, smallsizeclass_t sizeclass)
+    {
+      size_t rsize = sizeclass_to_size(sizeclass);
+      size_t n = bits::min<size_t>(
+        meta->uncarved(), bits::max<size_t>(Config::Pal::page_size / rsize, 1));
+      if (meta->uncarved() - n < threshold_for_waking_slab(sizeclass))
+        n = meta->uncarved();
+
+      auto start = meta->bump();
+      alloc_new_list(start, meta, rsize, n * rsize, entropy);
+      meta->bump() = pointer_offset(meta->bump(), n * rsize);
+      meta->uncarved() = static_cast<uint16_t>(meta->uncarved() - n);
+    }
+
     /***************************************************************************
      *   Deallocation code
      *
@@ -1083,6 +1357,7 @@ namespace snmalloc
       if (SNMALLOC_LIKELY(public_state() == entry.get_remote()))
       {
         dealloc_cheri_checks(p_tame.unsafe_ptr());
+        stats.dealloc(entry.get_sizeclass());
         dealloc_local_object(p_tame, entry);
         return;
       }
@@ -1090,6 +1365,161 @@ namespace snmalloc
       dealloc_remote<CheckInit>(entry, p_tame);
     }
 
+    /**
+     * Deallocates the `n` objects in `ptrs`.
+     *
+     * A run of consecutive objects from one of this allocator's slabs is
+     * added to the slab's free list with a single update of its metadata,
+     * while the pagemap entries for the objects that follow are prefetched.
+     * Finding the end of a run costs a mispredicted branch, so after a run of
+     * one object the next few are freed as by `dealloc`.  Objects owned by
+     * other allocators go to the remote cache, which gathers them per slab.
+     */
+    template<typename CheckInit = CheckInitNoOp>
+    void dealloc_batch(void** ptrs, size_t n) noexcept
+    {
+      CheckInit::check_init(
+        [this, ptrs, n]() SNMALLOC_FAST_PATH_LAMBDA {
+          dealloc_batch_inner(ptrs, n);
+        },
+        [](Allocator* a, void** ptrs, size_t n) SNMALLOC_FAST_PATH_LAMBDA {
+          a->dealloc_batch_inner(ptrs, n);
+        },
+        ptrs,
+        n);
+    }
+
+  private:
+    /**
+     * How far ahead of the object being freed to prefetch pagemap entries.
+     */
+    static constexpr size_t DEALLOC_BATCH_PREFETCH = 8;
+
+    /**
+     * How many objects to free singly after a run of one.
+     */
+    static constexpr size_t DEALLOC_BATCH_BACKOFF = 64;
+
+    SNMALLOC_FAST_PATH capptr::Alloc<void> dealloc_batch_tame(void* p_raw)
+    {
+#ifdef __CHERI_PURE_CAPABILITY__
+      // As in dealloc.
+      p_raw = __builtin_cheri_offset_set(p_raw, 0);
+#endif
+      return capptr_domesticate<Config>(
+        backend_state_ptr(), capptr_from_client(p_raw));
+    }
+
+    void dealloc_batch_inner(void** ptrs, size_t n) noexcept
+    {
+      size_t singly = 0;
+      size_t i = 0;
+      while (i < n)
+      {
+        auto p = dealloc_batch_tame(ptrs[i]);
+        const PagemapEntry& entry =
+          Config::Backend::get_metaentry(address_cast(p));
+
+        if (singly > 0 || public_state() != entry.get_remote())
+        {
+          singly -= (singly > 0);
+          dealloc_batch_one(p, entry);
+          i++;
+          continue;
+        }
+
+        size_t run = dealloc_local_run(&ptrs[i], n - i, p, entry);
+        if (run == 1)
+          singly = DEALLOC_BATCH_BACKOFF;
+        i += run;
+      }
+    }
+
+    /**
+     * Deallocates one object, as `dealloc` does.
+     */
+    SNMALLOC_FAST_PATH void
+    dealloc_batch_one(capptr::Alloc<void> p, const PagemapEntry& entry)
+    {
+      if (SNMALLOC_LIKELY(public_state() == entry.get_remote()))
+      {
+        dealloc_cheri_checks(p.unsafe_ptr());
+        stats.dealloc(entry.get_sizeclass());
+        dealloc_local_object(p, entry);
+        return;
+      }
+
+      dealloc_remote<CheckInitNoOp>(entry, p);
+    }
+
+    /**
+     * Deallocates the run of objects at the start of `ptrs` that share the
+     * slab of the first, `p`, which this allocator owns.  Returns the length
+     * of the run.
+     */
+    SNMALLOC_FAST_PATH size_t dealloc_local_run(
+      void** ptrs,
+      size_t n,
+      capptr::Alloc<void> p,
+      const PagemapEntry& entry) noexcept
+    {
+      auto meta = entry.get_slab_metadata();
+      if (SNMALLOC_UNLIKELY(meta->is_large()))
+      {
+        dealloc_batch_one(p, entry);
+        return 1;
+      }
+
+      // A slab holds fewer objects than this, so only a double free could
+      // make a longer run, which return_objects could not count.
+      size_t limit = bits::min(n, bits::one_at_bit(MAX_CAPACITY_BITS));
+      size_t run = 0;
+      while (true)
+      {
+        if (run + DEALLOC_BATCH_PREFETCH < n)
+        {
+          Aal::prefetch(
+            const_cast<PagemapEntry*>(&Config::Backend::get_metaentry(
+              address_cast(ptrs[run + DEALLOC_BATCH_PREFETCH]))));
+        }
+
+        dealloc_cheri_checks(p.unsafe_ptr());
+        stats.dealloc(entry.get_sizeclass());
+
+        snmalloc_check_client(
+          mitigations(sanity_checks),
+          is_start_of_object(entry.get_sizeclass(), address_cast(p)),
+          "Not deallocating start of an object");
+
+        meta->free_queue.add(
+          p.template as_static<freelist::Object::T<>>(),
+          freelist::Object::key_root,
+          meta->as_key_tweak(),
+          entropy);
+
+        if (++run == limit)
+          break;
+
+        p = dealloc_batch_tame(ptrs[run]);
+        const auto& next = Config::Backend::get_metaentry(address_cast(p));
+        if (next.get_slab_metadata() != meta)
+          break;
+      }
+
+      // As for a batch of remote frees, see handle_dealloc_remote.
+      auto unreturned = meta->return_objects(static_cast<uint16_t>(run));
+      if (SNMALLOC_UNLIKELY(unreturned.template step<true>()))
+      {
+        do
+        {
+          dealloc_local_object_meta(entry, meta);
+        } while (SNMALLOC_UNLIKELY(unreturned.template step<false>()));
+      }
+
+      return run;
+    }
+
+  public:
     SNMALLOC_FAST_PATH void dealloc_local_object(
       CapPtr<void, capptr::bounds::Alloc> p,
       const typename Config::PagemapEntry& entry) noexcept
@@ -1143,12 +1573,20 @@ namespace snmalloc
 
 #ifdef SNMALLOC_TRACING
         message<1024>("Large deallocation: {}", size);
-#else
-        UNUSED(size);
 #endif
 
+        if constexpr (HEAP_PROFILE_ENABLED)
+        {
+          if (meta->heap_sample() != nullptr)
+          {
+            HeapProfiler<Config>::release(meta->heap_sample());
+            meta->heap_sample() = nullptr;
+          }
+        }
+
         // Remove from set of fully used slabs.
         meta->node.remove();
+        trace.chunk_release(size);
 
         Config::Backend::dealloc_chunk(
           get_backend_local_state(), *meta, p, size, entry.get_sizeclass());
@@ -1191,7 +1629,7 @@ namespace snmalloc
         message<1024>("Slab is woken up");
 #endif
 
-        ticker.check_tick();
+        tick();
         return;
       }
 
@@ -1206,7 +1644,29 @@ namespace snmalloc
       {
         dealloc_local_slabs(sizeclass);
       }
-      ticker.check_tick();
+      tick();
+    }
+
+    /**
+     * Advance the ticker.  When the clock is queried, check whether the
+     * platform has reported low memory since this allocator last looked, and
+     * let the backend decommit memory that has not been reused for a while.
+     */
+    template<typename T = void*>
+    SNMALLOC_FAST_PATH T tick(T p = nullptr)
+    {
+      return ticker.check_tick(p, [this](uint64_t now_ms) {
+        auto epoch =
+          call_low_memory_epoch<typename Config::Backend>(nullptr, 0);
+        if (SNMALLOC_UNLIKELY(epoch != low_memory_epoch))
+        {
+          low_memory_epoch = epoch;
+          release_cached_memory();
+        }
+
+        call_decay_cached_memory<typename Config::Backend>(
+          get_backend_local_state(), now_ms, Config::Options.CacheDecayMs, 0);
+      });
     }
 
     template<bool check_slabs = false>
@@ -1245,6 +1705,8 @@ namespace snmalloc
         // TODO delay the clear to the next user of the slab, or teardown so
         // don't touch the cache lines at this point in snmalloc_check_client.
         auto start = clear_slab(meta, sizeclass);
+        stats.slab_released(sizeclass);
+        trace.slab_release(sizeclass, sizeclass_to_slab_size(sizeclass));
 
         Config::Backend::dealloc_chunk(
           get_backend_local_state(),
@@ -1288,9 +1750,10 @@ namespace snmalloc
           fl.take(freelist::Object::key_root, domesticate);
           count++;
         }
-        // Check the list contains all the elements
+        // Check the list contains all the elements, apart from any that were
+        // never carved.
         SNMALLOC_CHECK(
-          (count + more) ==
+          (count + more + meta->uncarved()) ==
           snmalloc::sizeclass_to_slab_object_count(sizeclass));
 
         if (more > 0)
@@ -1307,7 +1770,8 @@ namespace snmalloc
           }
         }
         SNMALLOC_CHECK(
-          count == snmalloc::sizeclass_to_slab_object_count(sizeclass));
+          (count + meta->uncarved()) ==
+          snmalloc::sizeclass_to_slab_object_count(sizeclass));
       }
       auto start_of_slab = pointer_align_down<void>(
         p, snmalloc::sizeclass_to_slab_size(sizeclass));
@@ -1338,6 +1802,7 @@ namespace snmalloc
         // Check if we have space for the remote deallocation
         if (SNMALLOC_LIKELY(remote_dealloc_cache.reserve_space(entry)))
         {
+          stats.remote_dealloc(entry.get_sizeclass());
           remote_dealloc_cache.template dealloc<sizeof(Allocator)>(
             entry.get_slab_metadata(), p_tame, &entropy);
 #ifdef SNMALLOC_TRACING
@@ -1388,6 +1853,7 @@ namespace snmalloc
             sizeclass_full_to_size(entry.get_sizeclass()),
             address_cast(entry.get_slab_metadata()));
 #endif
+          stats.remote_dealloc(entry.get_sizeclass());
           remote_dealloc_cache.template dealloc<sizeof(Allocator)>(
             entry.get_slab_metadata(), p, &entropy);
 
@@ -1396,7 +1862,7 @@ namespace snmalloc
         [](Allocator* a, void* p) SNMALLOC_FAST_PATH_LAMBDA {
           // Recheck what kind of dealloc we should do in case the allocator
           // we get from lazy_init is the originating allocator.
-          a->dealloc(p); // TODO don't double count statistics
+          a->dealloc(p);
         },
         p.unsafe_ptr());
     }
@@ -1425,42 +1891,17 @@ namespace snmalloc
               Config::Backend::get_metaentry(snmalloc::address_cast(m));
             handle_dealloc_remote(
               entry, m, need_post, domesticate, bytes_flushed);
-#if defined(__SNMALLOC_USE_BBQ__)
-            return true;
-#endif
           };
 
-#if defined(__SNMALLOC_USE_BBQ__)
-        MessageQueueStatus st{};
-        while ((st = message_queue().dequeue(domesticate, domesticate, cb)))
-        {
-          if (st == MessageQueueStatus::EMPTY)
-          {
-            break;
-          }
-        }
-#else
-        message_queue().destroy_and_iterate(domesticate, cb);
-#endif
+        message_queue().template destroy_and_iterate<Config>(
+          domesticate, cb, local_state);
       }
       else
       {
-// Process incoming message queue
-// Loop as normally only processes a batch
-#if defined(__SNMALLOC_USE_BBQ__)
-        while (true)
-        {
-          handle_message_queue<true>([](){});
-          // handle_message_queue_slow<true>([](){});
-          if (message_queue().status == MessageQueueStatus::EMPTY)
-          {
-            break;
-          }
-        }
-#else
+        // Process incoming message queue
+        // Loop as normally only processes a batch
         while (has_messages())
-          handle_message_queue<true>([](){});
-#endif
+          handle_message_queue<true>([]() {});
       }
 
       auto& key = freelist::Object::key_root;
@@ -1483,7 +1924,7 @@ namespace snmalloc
       }
 
       auto posted = remote_dealloc_cache.template post<sizeof(Allocator)>(
-        local_state, get_trunc_id());
+        local_state, get_trunc_id(), trace);
 
       // We may now have unused slabs, return to the global allocator.
       for (smallsizeclass_t sizeclass = 0; sizeclass < NUM_SMALL_SIZECLASSES;
@@ -1504,9 +1945,105 @@ namespace snmalloc
       // Set the remote_dealloc_cache to immediately slow path.
       remote_dealloc_cache.capacity = 0;
 
+      stats.fold();
+
       return posted;
     }
 
+    /**
+     * Return this allocator's empty slabs, and the memory the backend is
+     * caching for it, so that the memory is decommitted.
+     */
+    SNMALLOC_SLOW_PATH void release_cached_memory()
+    {
+      for (smallsizeclass_t sizeclass = 0; sizeclass < NUM_SMALL_SIZECLASSES;
+           sizeclass++)
+      {
+        dealloc_local_slabs(sizeclass);
+      }
+
+      call_release_cached_memory<typename Config::Backend>(
+        get_backend_local_state(), 0);
+    }
+
+    /**
+     * Allocate from the memory of the NUMA node the calling thread is running
+     * on.  Called when a thread acquires this allocator from the pool.
+     */
+    void bind_to_current_node()
+    {
+      using Pal = typename Config::Pal;
+      if constexpr (pal_supports<NumaAware, Pal>)
+      {
+        call_bind_to_node<typename Config::Backend>(
+          get_backend_local_state(), Pal::numa_node(), 0);
+      }
+    }
+
+    /**
+     * Try to resize the large object `p_raw`, owned by this allocator, to
+     * hold `size` bytes without moving it.  Returns true if the object now
+     * has room for `size` bytes.  The contents are unchanged and any grown
+     * part is uninitialised.
+     *
+     * Growing succeeds only if the neighbouring address space is free in
+     * this thread's backend caches.  Small objects are never resized.
+     */
+    SNMALLOC_SLOW_PATH bool resize_in_place(void* p_raw, size_t size)
+    {
+      if constexpr (aal_supports<StrictProvenance>)
+      {
+        // The bounds of the pointer the client holds cannot be changed.
+        UNUSED(p_raw, size);
+        return false;
+      }
+      else
+      {
+        const PagemapEntry& entry =
+          Config::Backend::get_metaentry(address_cast(p_raw));
+        auto old_sizeclass = entry.get_sizeclass();
+        if (
+          (entry.get_remote() != public_state()) || old_sizeclass.is_small() ||
+          old_sizeclass.is_default() || is_small_sizeclass(size) ||
+          (size > bits::one_at_bit(bits::BITS - 1)))
+          return false;
+
+        auto* meta = entry.get_slab_metadata();
+        size_t old_size = sizeclass_full_to_size(old_sizeclass);
+        size_t new_size = large_size_to_chunk_size(size);
+        if (
+          (meta == nullptr) ||
+          !is_start_of_object(old_sizeclass, address_cast(p_raw)) ||
+          (address_cast(p_raw) & (new_size - 1)) != 0)
+          return false;
+
+        if (new_size == old_size)
+          return true;
+
+        auto sizeclass = size_to_sizeclass_full(size);
+        if (!call_resize_chunk<typename Config::Backend>(
+              get_backend_local_state(),
+              *meta,
+              capptr::Alloc<void>::unsafe_from(p_raw),
+              old_size,
+              new_size,
+              PagemapEntry::encode(public_state(), sizeclass),
+              0))
+          return false;
+
+        stats.large_resize(old_size, new_size);
+        return true;
+      }
+    }
+
+    /**
+     * Publish this allocator's statistics without a full flush.
+     */
+    void fold_stats()
+    {
+      stats.fold();
+    }
+
     /**
      * If result parameter is non-null, then false is assigned into the
      * the location pointed to by result if this allocator is non-empty.
@@ -1638,9 +2175,24 @@ namespace snmalloc
   };
 
   /**
-   * Use this alias to access the pool of allocators throughout snmalloc.
+   * Use this to access the pool of allocators throughout snmalloc.
    */
   template<typename Config>
-  using AllocPool =
-    Pool<Allocator<Config>, ConstructAllocator<Config>, Config::pool>;
+  class AllocPool
+  : public Pool<Allocator<Config>, ConstructAllocator<Config>, Config::pool>
+  {
+    using Base =
+      Pool<Allocator<Config>, ConstructAllocator<Config>, Config::pool>;
+
+  public:
+    /**
+     * Acquire an allocator, bound to the NUMA node of the calling thread.
+     */
+    static Allocator<Config>* acquire()
+    {
+      auto* alloc = Base::acquire();
+      alloc->bind_to_current_node();
+      return alloc;
+    }
+  };
 } // namespace snmalloc
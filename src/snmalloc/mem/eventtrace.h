@@ -0,0 +1,432 @@
+#pragma once
+
+#include "../ds/ds.h"
+#include "sizeclasstable.h"
+
+#include <stdint.h>
+
+namespace snmalloc
+{
+  /**
+   * Slow-path events recorded by the event trace.  The payload fields each
+   * event uses are noted; the others are zero.
+   */
+  enum class TraceEvent : uint8_t
+  {
+    /**
+     * A small free list was refilled.  `sizeclass`, and in `bytes` the size
+     * of the slab that was allocated for it, or zero if an existing slab was
+     * reused.
+     */
+    Refill = 1,
+
+    /**
+     * A slab with no live objects went back to the backend.  `sizeclass` and
+     * the slab's `bytes`.
+     */
+    SlabRelease,
+
+    /**
+     * A chunk for a large object was allocated from the backend.
+     * `sizeclass`, as the raw value of the full sizeclass, and `bytes`.
+     */
+    AllocChunk,
+
+    /**
+     * A large object's chunk went back to the backend.  `bytes`.
+     */
+    ChunkRelease,
+
+    /**
+     * Remote frees were posted to the allocator `target`.
+     */
+    Post,
+
+    /**
+     * A post found the tail segment of `target`'s queue full.
+     */
+    QueueFull,
+
+    /**
+     * A post found the tail segment of `target`'s queue busy.
+     */
+    QueueBusy,
+
+    /**
+     * The message queue was drained: `count` messages freeing `bytes`.
+     */
+    Drain,
+  };
+
+  static constexpr size_t TRACE_EVENT_COUNT =
+    static_cast<size_t>(TraceEvent::Drain) + 1;
+
+  inline const char* trace_event_name(TraceEvent e)
+  {
+    switch (e)
+    {
+      case TraceEvent::Refill:
+        return "refill";
+      case TraceEvent::SlabRelease:
+        return "slab_release";
+      case TraceEvent::AllocChunk:
+        return "alloc_chunk";
+      case TraceEvent::ChunkRelease:
+        return "chunk_release";
+      case TraceEvent::Post:
+        return "post";
+      case TraceEvent::QueueFull:
+        return "queue_full";
+      case TraceEvent::QueueBusy:
+        return "queue_busy";
+      case TraceEvent::Drain:
+        return "drain";
+    }
+    return "unknown";
+  }
+
+  /**
+   * A decoded event.  `timestamp` is in `Aal::tick` units.
+   */
+  struct TraceRecord
+  {
+    uint64_t timestamp = 0;
+    TraceEvent event{};
+    uint16_t sizeclass = 0;
+    uint32_t count = 0;
+    uint64_t bytes = 0;
+    uint64_t target = 0;
+  };
+
+  /**
+   * A trace file is a sequence of flushes, each this header followed by
+   * `rings` ring blocks.  All fields are in host byte order.
+   */
+  struct TraceFlushHeader
+  {
+    static constexpr uint64_t MAGIC = 0x3145434152544e53; // "SNTRACE1"
+
+    uint64_t magic = MAGIC;
+
+    /**
+     * `Aal::tick` and, where the platform has a clock, its time in
+     * milliseconds, both taken at the flush.  Two flushes give the tick
+     * rate.
+     */
+    uint64_t tick = 0;
+    uint64_t time_ms = 0;
+
+    uint64_t rings = 0;
+  };
+
+  /**
+   * A ring block: this header followed by `records` encoded records, each
+   * `TRACE_RECORD_WORDS` 64-bit words.
+   */
+  struct TraceRingHeader
+  {
+    /**
+     * The allocator the ring belongs to, as the id that appears as the
+     * `target` of posts to it.
+     */
+    uint64_t owner = 0;
+    uint64_t records = 0;
+
+    /**
+     * Events overwritten before this flush could read them.
+     */
+    uint64_t dropped = 0;
+  };
+
+  static constexpr size_t TRACE_RECORD_WORDS = 4;
+
+  /**
+   * Records are written as four words: the timestamp; the event, sizeclass
+   * and count packed as 8, 16 and 32 bits from the bottom; bytes; target.
+   */
+  inline TraceRecord trace_decode_record(const uint64_t* words)
+  {
+    TraceRecord r;
+    r.timestamp = words[0];
+    r.event = static_cast<TraceEvent>(words[1] & 0xff);
+    r.sizeclass = static_cast<uint16_t>(words[1] >> 8);
+    r.count = static_cast<uint32_t>(words[1] >> 32);
+    r.bytes = words[2];
+    r.target = words[3];
+    return r;
+  }
+
+  /**
+   * Decode a trace of `length` bytes, calling `v.flush(TraceFlushHeader)` for
+   * each flush, `v.ring(TraceRingHeader)` for each ring block in it, and
+   * `v.record(TraceRingHeader, TraceRecord)` for each record in that.
+   * Returns false if the trace is malformed or truncated.
+   */
+  template<typename Visitor>
+  bool trace_decode(const void* data, size_t length, Visitor&& v)
+  {
+    auto* p = static_cast<const unsigned char*>(data);
+    auto* end = p + length;
+
+    auto take = [&](void* out, size_t size) {
+      if (static_cast<size_t>(end - p) < size)
+        return false;
+      __builtin_memcpy(out, p, size);
+      p += size;
+      return true;
+    };
+
+    while (p != end)
+    {
+      TraceFlushHeader flush;
+      if (!take(&flush, sizeof(flush)) || flush.magic != flush.MAGIC)
+        return false;
+      v.flush(flush);
+
+      for (uint64_t i = 0; i < flush.rings; i++)
+      {
+        TraceRingHeader ring;
+        if (!take(&ring, sizeof(ring)))
+          return false;
+        v.ring(ring);
+
+        for (uint64_t j = 0; j < ring.records; j++)
+        {
+          uint64_t words[TRACE_RECORD_WORDS];
+          if (!take(words, sizeof(words)))
+            return false;
+          v.record(ring, trace_decode_record(words));
+        }
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Per-allocator ring of trace events.
+   *
+   * Only the owning allocator writes its ring, so recording is a handful of
+   * relaxed stores and a release store of the head, with no atomic
+   * read-modify-write.  When the ring is full the oldest events are
+   * overwritten.
+   *
+   * `flush` reads every ring while their owners carry on writing, in the
+   * manner of a sequence lock: records are copied, then the head is read
+   * again, and any record the owner may have overwritten in between is
+   * counted as dropped rather than reported.  Flushes can therefore run from
+   * any thread, for instance a reader that periodically copies the trace to
+   * a file or to shared memory.
+   *
+   * The disabled specialisation below is empty and every operation on it is a
+   * no-op.
+   */
+  template<bool Enabled = EVENT_TRACE_ENABLED>
+  class EventTrace
+  {
+    static constexpr size_t RECORDS = EVENT_TRACE_RECORDS;
+    static_assert(bits::is_pow2(RECORDS), "Trace rings must be a power of 2");
+    // Flushes copy a whole ring onto the stack.
+    static_assert(RECORDS <= 1024, "Trace rings are limited to 1024 records");
+
+    struct Slot
+    {
+      stl::Atomic<uint64_t> words[TRACE_RECORD_WORDS]{};
+    };
+
+    Slot slots[RECORDS]{};
+
+    /**
+     * Index of the next record to write.  Records before `head - RECORDS`
+     * have been overwritten.
+     */
+    stl::Atomic<uint64_t> head{0};
+
+    /**
+     * Index of the first record not yet flushed.  Only touched by flushes,
+     * under `flush_lock`.
+     */
+    uint64_t flushed = 0;
+
+    uint64_t owner = 0;
+
+    /**
+     * Every ring that has been registered.  Allocators are never freed, so
+     * neither are rings, and the list only grows.
+     */
+    EventTrace* next_ring = nullptr;
+    static inline stl::Atomic<EventTrace*> rings{nullptr};
+
+    static inline FlagWord flush_lock{};
+
+    void record(
+      TraceEvent event,
+      size_t sizeclass,
+      size_t count,
+      uint64_t bytes,
+      uint64_t target)
+    {
+      uint64_t h = head.load(stl::memory_order_relaxed);
+      // Order the previous record's publication before this one overwrites
+      // a slot, so that a flush that sees the new contents also sees a head
+      // that marks the slot's old record as overwritten.
+      stl::atomic_thread_fence(stl::memory_order_release);
+
+      auto& slot = slots[h & (RECORDS - 1)];
+      slot.words[0].store(Aal::tick(), stl::memory_order_relaxed);
+      slot.words[1].store(
+        static_cast<uint64_t>(event) | (static_cast<uint64_t>(sizeclass) << 8) |
+          (static_cast<uint64_t>(count) << 32),
+        stl::memory_order_relaxed);
+      slot.words[2].store(bytes, stl::memory_order_relaxed);
+      slot.words[3].store(target, stl::memory_order_relaxed);
+
+      head.store(h + 1, stl::memory_order_release);
+    }
+
+    /**
+     * Write the records of this ring that have not been flushed.
+     */
+    template<typename Write>
+    void flush_ring(Write& write)
+    {
+      uint64_t words[RECORDS][TRACE_RECORD_WORDS];
+
+      uint64_t end = head.load(stl::memory_order_acquire);
+      uint64_t start = bits::max(flushed, end - bits::min(end, RECORDS));
+      for (uint64_t i = start; i < end; i++)
+      {
+        auto& slot = slots[i & (RECORDS - 1)];
+        for (size_t w = 0; w < TRACE_RECORD_WORDS; w++)
+          words[i & (RECORDS - 1)][w] =
+            slot.words[w].load(stl::memory_order_relaxed);
+      }
+
+      // Any record the owner has started to overwrite since is not valid.
+      stl::atomic_thread_fence(stl::memory_order_acquire);
+      uint64_t now = head.load(stl::memory_order_relaxed) + 1;
+      start = bits::max(start, now - bits::min(now, RECORDS));
+      start = bits::min(start, end);
+
+      TraceRingHeader ring;
+      ring.owner = owner;
+      ring.records = end - start;
+      ring.dropped = start - flushed;
+      flushed = end;
+
+      write(&ring, sizeof(ring));
+      for (uint64_t i = start; i < end; i++)
+        write(words[i & (RECORDS - 1)], sizeof(words[0]));
+    }
+
+  public:
+    constexpr EventTrace() = default;
+
+    /**
+     * Register the ring of the allocator `id`, so that flushes include it.
+     * Called once, when the allocator is initialised.
+     */
+    void init(uint64_t id)
+    {
+      owner = id;
+      EventTrace* first = rings.load(stl::memory_order_relaxed);
+      do
+      {
+        next_ring = first;
+      } while (!rings.compare_exchange_weak(
+        first, this, stl::memory_order_release, stl::memory_order_relaxed));
+    }
+
+    void refill(smallsizeclass_t sizeclass, size_t slab_bytes)
+    {
+      record(TraceEvent::Refill, sizeclass, 0, slab_bytes, 0);
+    }
+
+    void slab_release(smallsizeclass_t sizeclass, size_t slab_bytes)
+    {
+      record(TraceEvent::SlabRelease, sizeclass, 0, slab_bytes, 0);
+    }
+
+    void alloc_chunk(sizeclass_t sizeclass, size_t bytes)
+    {
+      record(TraceEvent::AllocChunk, sizeclass.raw(), 0, bytes, 0);
+    }
+
+    void chunk_release(size_t bytes)
+    {
+      record(TraceEvent::ChunkRelease, 0, 0, bytes, 0);
+    }
+
+    void post(address_t target)
+    {
+      record(TraceEvent::Post, 0, 0, 0, target);
+    }
+
+    void queue_full(address_t target)
+    {
+      record(TraceEvent::QueueFull, 0, 0, 0, target);
+    }
+
+    void queue_busy(address_t target)
+    {
+      record(TraceEvent::QueueBusy, 0, 0, 0, target);
+    }
+
+    void drain(size_t messages, size_t bytes)
+    {
+      record(TraceEvent::Drain, 0, messages, bytes, 0);
+    }
+
+    /**
+     * Write the events recorded since the last flush, from every allocator,
+     * by calls to `write(const void*, size_t)`.  `write` may allocate.
+     */
+    template<typename Pal, typename Write>
+    static void flush(Write&& write)
+    {
+      with(flush_lock, [&]() {
+        TraceFlushHeader header;
+        header.tick = Aal::tick();
+        if constexpr (pal_supports<Time, Pal>)
+          header.time_ms = Pal::time_in_ms();
+
+        // Rings registered after this are left for the next flush.
+        EventTrace* first = rings.load(stl::memory_order_acquire);
+        for (auto* r = first; r != nullptr; r = r->next_ring)
+          header.rings++;
+
+        write(&header, sizeof(header));
+        for (auto* r = first; r != nullptr; r = r->next_ring)
+          r->flush_ring(write);
+      });
+    }
+  };
+
+  template<>
+  class EventTrace<false>
+  {
+  public:
+    constexpr EventTrace() = default;
+
+    void init(uint64_t) {}
+
+    void refill(smallsizeclass_t, size_t) {}
+
+    void slab_release(smallsizeclass_t, size_t) {}
+
+    void alloc_chunk(sizeclass_t, size_t) {}
+
+    void chunk_release(size_t) {}
+
+    void post(address_t) {}
+
+    void queue_full(address_t) {}
+
+    void queue_busy(address_t) {}
+
+    void drain(size_t, size_t) {}
+
+    template<typename Pal, typename Write>
+    static void flush(Write&&)
+    {}
+  };
+} // namespace snmalloc
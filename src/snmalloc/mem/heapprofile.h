@@ -0,0 +1,415 @@
+#pragma once
+
+#include "../ds/ds.h"
+#include "entropy.h"
+#include "pool.h"
+#include "snmalloc/stl/new.h"
+
+#if defined(SNMALLOC_BACKTRACE_HEADER)
+#  include SNMALLOC_BACKTRACE_HEADER
+#endif
+
+namespace snmalloc
+{
+  /**
+   * A sampled allocation: the size that was requested and the stack that
+   * requested it.  Samples are pooled; a sample is live while it is in use.
+   */
+  class HeapSample : public Pooled<HeapSample>
+  {
+  public:
+    static constexpr size_t MAX_FRAMES = 64;
+
+    size_t size = 0;
+    size_t depth = 0;
+    void* frames[MAX_FRAMES];
+
+    HeapSample(Range<capptr::bounds::Alloc>&) {}
+  };
+
+  /**
+   * Samples are allocated as metadata from the backend, so that taking a
+   * sample never re-enters the allocator that is taking it.
+   */
+  template<typename Config>
+  class ConstructHeapSample
+  {
+  public:
+    static capptr::Alloc<HeapSample> make()
+    {
+      size_t round_sizeof = Aal::capptr_size_round(sizeof(HeapSample));
+      size_t request_size = bits::next_pow2(round_sizeof);
+
+      auto raw = Config::Backend::template alloc_meta_data<HeapSample>(
+        nullptr, request_size);
+
+      if (raw == nullptr)
+      {
+        Config::Pal::error("Failed to allocate a heap profile sample.");
+      }
+
+      Range<capptr::bounds::Alloc> r{
+        pointer_offset(raw, round_sizeof), request_size - round_sizeof};
+
+      return capptr::Alloc<HeapSample>::unsafe_from(
+        new (raw.unsafe_ptr(), placement_token) HeapSample(r));
+    }
+  };
+
+  /**
+   * Default mean number of bytes allocated between samples, as jemalloc's
+   * default `lg_prof_sample` of 19.
+   */
+  static constexpr size_t HEAP_PROFILE_DEFAULT_INTERVAL = bits::one_at_bit(19);
+
+  /**
+   * Sampling heap profiler.
+   *
+   * Each allocator counts down the bytes it hands out.  When the count
+   * crosses zero the allocation is sampled and a new count is drawn from an
+   * exponential distribution, so that samples are a Poisson process over
+   * bytes allocated.  This is what pprof assumes of `heap_v2` profiles when
+   * it scales samples back up to estimate the whole heap.
+   *
+   * The allocator gives each sampled object a chunk of its own, whose slab
+   * metadata points at the sample.  Freeing a chunk already takes the slow
+   * path, which is where the sample is released, so the deallocation fast
+   * path is unchanged.
+   *
+   * The per-allocator state is the countdown.  Everything else is global.
+   * The disabled specialisation below is empty and the countdown compiles
+   * away.
+   */
+  template<typename Config, bool Enabled = HEAP_PROFILE_ENABLED>
+  class HeapProfiler
+  {
+    using SamplePool = Pool<HeapSample, ConstructHeapSample<Config>>;
+
+    /**
+     * Bytes to recheck after while profiling is stopped.
+     */
+    static constexpr int64_t STOPPED_RECHECK = bits::one_at_bit(20);
+
+    /**
+     * Largest mean interval, which keeps `next_interval` from overflowing.
+     */
+    static constexpr size_t MAX_INTERVAL = bits::one_at_bit(40);
+
+    /**
+     * Bytes this allocator may hand out before the next sample.
+     */
+    int64_t bytes_until_sample = 0;
+
+    /**
+     * Whether `bytes_until_sample` was drawn while profiling.  If not, the
+     * allocation that exhausts it is not a sample point.
+     */
+    bool armed = false;
+
+    static inline stl::Atomic<bool> active{false};
+    static inline stl::Atomic<size_t> mean_interval{
+      HEAP_PROFILE_DEFAULT_INTERVAL};
+
+    /**
+     * Held to acquire and release samples, and to read them for a dump.
+     */
+    static inline FlagWord lock{};
+
+    /**
+     * Draw a countdown from the exponential distribution with mean `mean`,
+     * that is -ln(u) * mean for u uniform in (0, 1].
+     *
+     * To keep floating point out of the allocator, -log2(u) is computed in
+     * 16.16 fixed point from the position of the top bit, with a quadratic
+     * for the remaining fraction.  This is accurate to within 1%, which is
+     * ample for choosing sample points.
+     */
+    static int64_t next_interval(size_t mean, LocalEntropy& entropy)
+    {
+      constexpr size_t U_BITS = 26;
+      constexpr size_t ONE = bits::one_at_bit(16);
+      // ln(2) in 16.16 fixed point.
+      constexpr size_t LN2 = 45426;
+
+      size_t r = (entropy.get_next() & bits::mask_bits(U_BITS)) + 1;
+      size_t e = bits::BITS - 1 - bits::clz(r);
+      size_t t = ((r << 16) >> e) - ONE;
+      // log2(1 + t) ~= t * (1.3465 - 0.3465 * t)
+      size_t log2_fraction = (t * (88245 - ((22709 * t) >> 16))) >> 16;
+      size_t neg_log2 = ((U_BITS - e) << 16) - log2_fraction;
+      size_t neg_ln = (neg_log2 * LN2) >> 16;
+
+      size_t interval =
+        (mean >> 16) * neg_ln + (((mean & (ONE - 1)) * neg_ln) >> 16);
+      return static_cast<int64_t>(interval) + 1;
+    }
+
+    /**
+     * Fill `frames` with the calling stack, returning its depth.  Without a
+     * backtrace library only the immediate caller is recorded.
+     */
+    SNMALLOC_SLOW_PATH static size_t capture(void** frames)
+    {
+#if defined(SNMALLOC_BACKTRACE_HEADER) && !defined(__CHERI_PURE_CAPABILITY__)
+      int depth = backtrace(frames, static_cast<int>(HeapSample::MAX_FRAMES));
+      return depth < 0 ? 0 : static_cast<size_t>(depth);
+#elif defined(__GNUC__)
+      frames[0] = __builtin_return_address(0);
+      return 1;
+#else
+      UNUSED(frames);
+      return 0;
+#endif
+    }
+
+    template<typename Write, size_t N>
+    static void write_string(Write& write, const char (&s)[N])
+    {
+      write(s, N - 1);
+    }
+
+    template<typename Write>
+    static void write_number(Write& write, size_t n, size_t base = 10)
+    {
+      char buffer[24];
+      size_t i = sizeof(buffer);
+      do
+      {
+        buffer[--i] = "0123456789abcdef"[n % base];
+        n /= base;
+      } while (n != 0);
+      write(&buffer[i], sizeof(buffer) - i);
+    }
+
+    /**
+     * Write `objects: bytes [objects: bytes]`, the in-use and allocated
+     * counts of a profile line.  Only live samples are kept, so the two
+     * agree.
+     */
+    template<typename Write>
+    static void write_counts(Write& write, size_t objects, size_t bytes)
+    {
+      write_number(write, objects);
+      write_string(write, ": ");
+      write_number(write, bytes);
+      write_string(write, " [");
+      write_number(write, objects);
+      write_string(write, ": ");
+      write_number(write, bytes);
+      write_string(write, "]");
+    }
+
+  public:
+    constexpr HeapProfiler() = default;
+
+    /**
+     * Count an allocation of `size` bytes.  Returns true if the countdown is
+     * exhausted, in which case the caller should ask `should_sample`.
+     */
+    SNMALLOC_FAST_PATH bool count(size_t size)
+    {
+      bytes_until_sample -= static_cast<int64_t>(size);
+      return bytes_until_sample < 0;
+    }
+
+    /**
+     * Called once `count` returns true.  Starts the next countdown, and
+     * returns whether the allocation that ended the last one is a sample.
+     */
+    bool should_sample(LocalEntropy& entropy)
+    {
+      if (!active.load(stl::memory_order_relaxed))
+      {
+        armed = false;
+        bytes_until_sample = STOPPED_RECHECK;
+        return false;
+      }
+
+      bool result = armed;
+      armed = true;
+      bytes_until_sample = next_interval(
+        mean_interval.load(stl::memory_order_relaxed), entropy);
+      return result;
+    }
+
+    /**
+     * Record a sample of `size` bytes allocated by the calling stack.  The
+     * result is passed to `release` when the object is freed.
+     */
+    static HeapSample* record(size_t size)
+    {
+      void* frames[HeapSample::MAX_FRAMES];
+      size_t depth = capture(frames);
+
+      HeapSample* sample = nullptr;
+      with(lock, [&]() {
+        sample = SamplePool::acquire();
+        sample->size = size;
+        sample->depth = depth;
+        for (size_t i = 0; i < depth; i++)
+          sample->frames[i] = frames[i];
+      });
+      return sample;
+    }
+
+    static void release(HeapSample* sample)
+    {
+      with(lock, [&]() { SamplePool::release(sample); });
+    }
+
+    /**
+     * Start sampling, on average once every `interval` bytes.  Allocators
+     * notice within `STOPPED_RECHECK` bytes of their next allocation.
+     */
+    static void start(size_t interval)
+    {
+      // The first backtrace may allocate, as it loads the unwinder; do that
+      // now rather than while taking a sample.
+      void* frames[HeapSample::MAX_FRAMES];
+      capture(frames);
+
+      set_interval(interval);
+      active.store(true, stl::memory_order_relaxed);
+    }
+
+    /**
+     * Set the mean interval between samples, whether or not profiling.
+     * Countdowns already drawn are not redrawn.
+     */
+    static void set_interval(size_t interval)
+    {
+      mean_interval.store(
+        bits::min(bits::max<size_t>(interval, 1), MAX_INTERVAL),
+        stl::memory_order_relaxed);
+    }
+
+    /**
+     * Stop taking samples.  Samples of objects still live are kept.
+     */
+    static void stop()
+    {
+      active.store(false, stl::memory_order_relaxed);
+    }
+
+    static bool is_active()
+    {
+      return active.load(stl::memory_order_relaxed);
+    }
+
+    static size_t interval()
+    {
+      return mean_interval.load(stl::memory_order_relaxed);
+    }
+
+    /**
+     * Write the live samples as a legacy pprof heap profile, by calls to
+     * `write(const char*, size_t)`.  The lock is not held across calls to
+     * `write`, so it may allocate.
+     *
+     * pprof symbolises the addresses using the mappings that follow a
+     * `MAPPED_LIBRARIES:` line, which the caller should append.
+     */
+    template<typename Write>
+    static void dump(Write&& write)
+    {
+      size_t objects = 0;
+      size_t bytes = 0;
+      with(lock, [&]() {
+        for (auto* s = SamplePool::iterate(); s != nullptr;
+             s = SamplePool::iterate(s))
+        {
+          if (s->in_use.load(stl::memory_order_relaxed))
+          {
+            objects++;
+            bytes += s->size;
+          }
+        }
+      });
+
+      write_string(write, "heap profile: ");
+      write_counts(write, objects, bytes);
+      write_string(write, " @ heap_v2/");
+      write_number(write, interval());
+      write_string(write, "\n");
+
+      // Samples are never freed, so the list can be walked a step at a time,
+      // copying each one out under the lock.
+      size_t size = 0;
+      size_t depth = 0;
+      void* frames[HeapSample::MAX_FRAMES];
+      HeapSample* next = nullptr;
+      with(lock, [&]() { next = SamplePool::iterate(); });
+      while (next != nullptr)
+      {
+        bool live = false;
+        with(lock, [&]() {
+          live = next->in_use.load(stl::memory_order_relaxed);
+          if (live)
+          {
+            size = next->size;
+            depth = next->depth;
+            for (size_t i = 0; i < depth; i++)
+              frames[i] = next->frames[i];
+          }
+          next = SamplePool::iterate(next);
+        });
+
+        if (!live)
+          continue;
+
+        write_counts(write, 1, size);
+        write_string(write, " @");
+        for (size_t i = 0; i < depth; i++)
+        {
+          write_string(write, " 0x");
+          write_number(write, address_cast(frames[i]), 16);
+        }
+        write_string(write, "\n");
+      }
+    }
+  };
+
+  template<typename Config>
+  class HeapProfiler<Config, false>
+  {
+  public:
+    constexpr HeapProfiler() = default;
+
+    SNMALLOC_FAST_PATH bool count(size_t)
+    {
+      return false;
+    }
+
+    bool should_sample(LocalEntropy&)
+    {
+      return false;
+    }
+
+    static HeapSample* record(size_t)
+    {
+      return nullptr;
+    }
+
+    static void release(HeapSample*) {}
+
+    static void start(size_t) {}
+
+    static void set_interval(size_t) {}
+
+    static void stop() {}
+
+    static bool is_active()
+    {
+      return false;
+    }
+
+    static size_t interval()
+    {
+      return HEAP_PROFILE_DEFAULT_INTERVAL;
+    }
+
+    template<typename Write>
+    static void dump(Write&&)
+    {}
+  };
+} // namespace snmalloc
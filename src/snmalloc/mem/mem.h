@@ -1,10 +1,13 @@
+#include "allocstats.h"
 #include "backend_concept.h"
 #include "backend_wrappers.h"
 #include "bbq.h"
 #include "check_init.h"
 #include "corealloc.h"
 #include "entropy.h"
+#include "eventtrace.h"
 #include "freelist.h"
+#include "heapprofile.h"
 #include "message_bbq.h"
 #include "metadata.h"
 #include "pool.h"
@@ -7,6 +7,7 @@
 #define _BATCHED_BBQ_
 #include "bbq.h"
 #include "freelist.h"
+#include "freelist_queue.h"
 
 #include <iostream>
 
@@ -131,6 +132,7 @@ namespace snmalloc
               blk.payload[cursor.meta.ptr].load(stl::memory_order_acquire);
             consumed_current = domesticate_head(list_head);
           }
+          bool stop = false;
           while (consumed_current != nullptr)
           {
             freelist::HeadPtr next_ptr = consumed_current->atomic_read_next(
@@ -147,6 +149,7 @@ namespace snmalloc
               }
               else
               {
+                stop = true;
                 break;
               }
             }
@@ -155,7 +158,7 @@ namespace snmalloc
           list_head = nullptr;
 #if defined(RETRY_NEW)
           blk.consumed.fetch_add(1);
-          if constexpr (IsSingleList)
+          if (IsSingleList || stop)
           {
             return Queuestatus::OK;
           }
@@ -225,12 +228,15 @@ namespace snmalloc
      * it'll introduce extra memory access overhead*/
     bool is_empty()
     {
+      // A list that the consumer stopped part way through.
+      if (list_head != nullptr)
+        return false;
+
       MetaHead head = this->chead;
       Block& blk = this->blocks_[head.meta.ptr];
       MetaCursor committed = blk.committed.load();
-      if (
-        committed.meta.ptr < block_size &&
-        committed.meta.ptr != committed.meta.ptr)
+      MetaCursor consumed = blk.consumed.load();
+      if (consumed.meta.ptr < committed.meta.ptr)
       {
         return false;
       }
@@ -424,4 +430,355 @@ namespace snmalloc
     //   delete;
   };
 
-} // namespace snmalloc
\ No newline at end of file
+  /**
+   * A batched BBQ (mpsc) whose storage is materialised lazily and grows and
+   * shrinks with remote-free pressure.
+   *
+   * The queue itself is only a handful of cursors.  Payload lives in
+   * `Segment`s, each a fixed-size `batchedBBQ_MPSC`, allocated from the
+   * backend meta-data range of the enqueuing thread on first use.  When the
+   * tail segment reports FULL, a producer links a fresh segment after it (up
+   * to `max_segments`) and moves the tail on.  The consumer drains segments
+   * from the head and returns fully drained, unreachable segments to its own
+   * meta-data range, so the chain shrinks back to a single segment once the
+   * pressure drops.
+   *
+   * Messages are not ordered across segments; the allocator does not require
+   * FIFO delivery of remote frees.
+   *
+   * A segment that is no longer the tail can still be reached by a producer
+   * that loaded the tail before it moved.  Producers therefore announce
+   * themselves in `producers` for the duration of an enqueue, and the
+   * consumer only retires a segment after observing, in order, that it is
+   * not the tail and that no producer is in flight.
+   *
+   * Enqueue never waits for the consumer.  Once `max_segments` are in use (or
+   * no meta-data can be allocated) lists are appended to an unbounded
+   * `FreeListMPSCQ`, linked through the same free list pointers, which the
+   * consumer drains ahead of the segments.  A stalled consumer therefore
+   * costs producers memory, never progress.  As with `FreeListMPSCQ` itself,
+   * the most recent overflowed message is only delivered once another
+   * arrives or the queue is destroyed.
+   *
+   * Producers bump `epoch` once their list is visible, and the consumer
+   * records the value it observed before a drain that came back EMPTY.  The
+   * two differ only if something may have arrived since, which gives the
+   * allocator fast path a single load to decide whether to look at the queue.
+   */
+  template<
+    uint32_t block_num,
+    uint32_t block_size,
+    FreeListKey* Key,
+    address_t Key_tweak = NO_KEY_TWEAK,
+    size_t max_segments = 16>
+  class alignas(REMOTE_MIN_ALIGN) lazyBBQ_MPSC final
+  {
+    using Queue = batchedBBQ_MPSC<block_num, block_size, Key, Key_tweak>;
+
+  public:
+    using Queuestatus = typename Queue::Queuestatus;
+
+  private:
+    struct Segment
+    {
+      Queue queue{};
+
+      alignas(CACHELINE_SIZE) stl::Atomic<Segment*> next{nullptr};
+    };
+
+    /**
+     * Producer side: the segment new messages are pushed to, the number of
+     * producers currently inside `emplace`, and the number of live segments.
+     */
+    alignas(CACHELINE_SIZE) stl::Atomic<Segment*> tail{nullptr};
+    stl::Atomic<size_t> producers{0};
+    stl::Atomic<size_t> segments{0};
+
+    /**
+     * Consumer side: the oldest segment that may still hold messages.  This
+     * is written by a producer exactly once, when the queue is materialised,
+     * and by the consumer thereafter.
+     */
+    alignas(CACHELINE_SIZE) stl::Atomic<Segment*> head{nullptr};
+
+    /**
+     * The value of `epoch` observed at the start of the last drain that found
+     * the queue empty.  Only accessed by the consumer.
+     */
+    size_t seen_epoch{0};
+
+    /**
+     * Number of completed enqueues.  This is read on every allocator slow
+     * path, so it is kept away from the producer cursors.
+     */
+    alignas(CACHELINE_SIZE) stl::Atomic<size_t> epoch{0};
+
+    /**
+     * Lists that did not fit in the segments, see the class commentary.
+     */
+    FreeListMPSCQ<*Key, Key_tweak> overflow{};
+
+    template<typename Config>
+    static Segment* alloc_segment(typename Config::LocalState* local_state)
+    {
+      auto raw = Config::Backend::template alloc_meta_data<Segment>(
+        local_state, sizeof(Segment));
+
+      if (raw == nullptr)
+        return nullptr;
+
+      return new (raw.unsafe_ptr(), placement_token) Segment();
+    }
+
+    template<typename Config>
+    static void
+    dealloc_segment(typename Config::LocalState* local_state, Segment* seg)
+    {
+      seg->~Segment();
+      Config::Backend::dealloc_meta_data(
+        *local_state, capptr::Alloc<void>::unsafe_from(seg), sizeof(Segment));
+    }
+
+    /**
+     * Install the first segment.  Returns the tail segment, or nullptr if no
+     * meta-data could be allocated.
+     */
+    template<typename Config>
+    SNMALLOC_SLOW_PATH Segment*
+    materialise(typename Config::LocalState* local_state)
+    {
+      Segment* seg = alloc_segment<Config>(local_state);
+      if (seg == nullptr)
+        return nullptr;
+
+      Segment* expected = nullptr;
+      if (tail.compare_exchange_strong(expected, seg))
+      {
+        segments.fetch_add(1, stl::memory_order_relaxed);
+        head.store(seg, stl::memory_order_release);
+        return seg;
+      }
+
+      // Lost the race, use the winner's segment.
+      dealloc_segment<Config>(local_state, seg);
+      return expected;
+    }
+
+    /**
+     * `seg` reported FULL.  Find or create its successor and try to move the
+     * tail on to it.  Returns nullptr if the queue may not grow any further.
+     */
+    template<typename Config>
+    SNMALLOC_SLOW_PATH Segment*
+    grow(typename Config::LocalState* local_state, Segment* seg)
+    {
+      Segment* next = seg->next.load(stl::memory_order_acquire);
+      if (next == nullptr)
+      {
+        if (segments.load(stl::memory_order_relaxed) >= max_segments)
+          return nullptr;
+
+        Segment* fresh = alloc_segment<Config>(local_state);
+        if (fresh == nullptr)
+          return nullptr;
+
+        if (seg->next.compare_exchange_strong(next, fresh))
+        {
+          segments.fetch_add(1, stl::memory_order_relaxed);
+          next = fresh;
+        }
+        else
+        {
+          dealloc_segment<Config>(local_state, fresh);
+        }
+      }
+
+      tail.compare_exchange_strong(seg, next);
+      return next;
+    }
+
+  public:
+    constexpr lazyBBQ_MPSC() = default;
+
+    SNMALLOC_FAST_PATH void invariant()
+    {
+      SNMALLOC_ASSERT(pointer_align_up(this, REMOTE_MIN_ALIGN) == this);
+    }
+
+    /**
+     * Push the list from head to end.  Segments are allocated from the
+     * meta-data range of `local_state`.  When the queue is at `max_segments`,
+     * or meta-data allocation fails, the list goes to the overflow queue.
+     *
+     * Returns OK if the list went into the tail segment at the first
+     * attempt, and otherwise what that attempt met, FULL or BUSY.
+     */
+    template<typename Config, class Domesticator_head>
+    Queuestatus emplace(
+      freelist::HeadPtr first,
+      freelist::HeadPtr end,
+      Domesticator_head domesticate_head,
+      typename Config::LocalState* local_state)
+    {
+      invariant();
+      producers.fetch_add(1);
+
+      Segment* seg = tail.load();
+      if (SNMALLOC_UNLIKELY(seg == nullptr))
+        seg = materialise<Config>(local_state);
+
+      Queuestatus result = Queuestatus::OK;
+      while (true)
+      {
+        if (SNMALLOC_UNLIKELY(seg == nullptr))
+        {
+          overflow.enqueue(first, end, domesticate_head);
+          break;
+        }
+
+        Queuestatus st = seg->queue.emplace(first, end, domesticate_head);
+        if (SNMALLOC_LIKELY(st == Queuestatus::OK))
+          break;
+
+        if (result == Queuestatus::OK)
+          result = st;
+        seg = grow<Config>(local_state, seg);
+      }
+
+      epoch.fetch_add(1, stl::memory_order_release);
+      producers.fetch_sub(1, stl::memory_order_release);
+      return result;
+    }
+
+    /**
+     * Drain messages, see `batchedBBQ_MPSC::front`.  Drained segments that
+     * no producer can reach any more are returned to the meta-data range of
+     * `local_state`.
+     */
+    template<
+      typename Config,
+      class Domesticator_head,
+      class Domesticator_queue,
+      class CB,
+      bool IsSingleList = false>
+    Queuestatus front(
+      Domesticator_head domesticate_head,
+      Domesticator_queue domesticate_queue,
+      CB cb,
+      typename Config::LocalState* local_state)
+    {
+      invariant();
+
+      // Anything counted here is visible to the drain below.
+      size_t observed = epoch.load(stl::memory_order_acquire);
+
+      if (SNMALLOC_UNLIKELY(overflow.can_dequeue()))
+      {
+        bool more = true;
+        overflow.dequeue(
+          domesticate_head,
+          domesticate_queue,
+          [&more, &cb](freelist::HeadPtr p) SNMALLOC_FAST_PATH_LAMBDA {
+            more = cb(p);
+            return more;
+          });
+        if (!more)
+          return Queuestatus::OK;
+      }
+
+      Segment* seg = head.load(stl::memory_order_acquire);
+      bool at_head = true;
+      while (seg != nullptr)
+      {
+        Segment* next = seg->next.load(stl::memory_order_acquire);
+
+        // Sampled before draining: if nothing can reach `seg` now, an EMPTY
+        // result below means it stays empty.
+        bool quiescent = at_head && (next != nullptr) && (tail.load() != seg) &&
+          (producers.load() == 0);
+
+        Queuestatus st = seg->queue.template front<
+          Domesticator_head,
+          Domesticator_queue,
+          CB,
+          IsSingleList>(domesticate_head, domesticate_queue, cb);
+        if (st != Queuestatus::EMPTY)
+          return st;
+
+        if (quiescent)
+        {
+          head.store(next, stl::memory_order_release);
+          segments.fetch_sub(1, stl::memory_order_relaxed);
+          dealloc_segment<Config>(local_state, seg);
+        }
+        else
+        {
+          at_head = false;
+          next = seg->next.load(stl::memory_order_acquire);
+        }
+        seg = next;
+      }
+
+      seen_epoch = observed;
+      return Queuestatus::EMPTY;
+    }
+
+    /**
+     * Drain every message, including the last overflowed one, ignoring the
+     * callback's result.  Must not race with producers.
+     */
+    template<typename Config, class Domesticator_queue, class CB>
+    void destroy_and_iterate(
+      Domesticator_queue domesticate,
+      CB cb,
+      typename Config::LocalState* local_state)
+    {
+      auto cbwrap = [&cb](freelist::HeadPtr p) SNMALLOC_FAST_PATH_LAMBDA {
+        cb(p);
+        return true;
+      };
+      while (front<Config>(domesticate, domesticate, cbwrap, local_state) !=
+             Queuestatus::EMPTY)
+      {
+      }
+      overflow.destroy_and_iterate(domesticate, cb);
+    }
+
+    /**
+     * Cheap check for the consumer: false only if nothing has been enqueued
+     * since a drain last came back EMPTY.  May report work that has already
+     * been consumed, so a true result may lead to an empty drain.
+     */
+    SNMALLOC_FAST_PATH bool has_work()
+    {
+      return epoch.load(stl::memory_order_relaxed) != seen_epoch;
+    }
+
+    /**
+     * Emptiness check, see `batchedBBQ_MPSC::is_empty`.  This walks every
+     * segment; prefer `has_work` on fast paths.
+     */
+    bool is_empty()
+    {
+      if (overflow.can_dequeue())
+        return false;
+
+      for (Segment* seg = head.load(stl::memory_order_acquire); seg != nullptr;
+           seg = seg->next.load(stl::memory_order_acquire))
+      {
+        if (!seg->queue.is_empty())
+          return false;
+      }
+      return true;
+    }
+
+    /**
+     * Number of segments currently backing this queue.
+     */
+    size_t segment_count()
+    {
+      return segments.load(stl::memory_order_relaxed);
+    }
+  };
+
+} // namespace snmalloc
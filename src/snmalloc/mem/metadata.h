@@ -8,6 +8,7 @@
 namespace snmalloc
 {
   struct RemoteAllocator;
+  class HeapSample;
 
   /**
    * Remotes need to be aligned enough that the bottom bits have enough room for
@@ -440,6 +441,26 @@ namespace snmalloc
      */
     bool large_ = false;
 
+    /**
+     * With lazy slab carving, the objects of this slab that have not yet been
+     * threaded onto the free queue.  They are counted as free by `needed()`.
+     * Always zero otherwise.
+     */
+    uint16_t uncarved_ = 0;
+
+    /**
+     * With lazy slab carving, the first of the uncarved objects.
+     */
+    SNMALLOC_NO_UNIQUE_ADDRESS
+    stl::conditional_t<LAZY_SLAB_ENABLED, capptr::Chunk<void>, Empty> bump_{};
+
+    /**
+     * The heap profile sample of a large allocation, if it was sampled.  See
+     * mem/heapprofile.h.
+     */
+    SNMALLOC_NO_UNIQUE_ADDRESS
+    stl::conditional_t<HEAP_PROFILE_ENABLED, HeapSample*, Empty> heap_sample_{};
+
     /**
      * Stores client meta-data for this slab. This must be last element in the
      * slab. The meta data will actually allocate multiple elements after this
@@ -457,6 +478,21 @@ namespace snmalloc
       return sleeping_;
     }
 
+    auto& heap_sample()
+    {
+      return heap_sample_;
+    }
+
+    uint16_t& uncarved()
+    {
+      return uncarved_;
+    }
+
+    auto& bump()
+    {
+      return bump_;
+    }
+
     /**
      * Initialise FrontendSlabMetadata for a slab.
      */
@@ -475,6 +511,9 @@ namespace snmalloc
       set_sleeping(sizeclass, 0);
 
       large_ = false;
+      uncarved_ = 0;
+      bump_ = {};
+      heap_sample_ = {};
 
       new (&client_meta_, placement_token)
         typename ClientMeta::StorageType[get_client_storage_count(sizeclass)];
@@ -492,6 +531,9 @@ namespace snmalloc
 
       // Flag to detect that it is a large alloc on the slow path
       large_ = true;
+      uncarved_ = 0;
+      bump_ = {};
+      heap_sample_ = {};
 
       // Jump to slow path on first deallocation.
       needed() = 1;
@@ -654,8 +696,10 @@ namespace snmalloc
       // This marks the slab as sleeping, and sets a wakeup
       // when sufficient deallocations have occurred to this slab.
       // Takes how many deallocations were not grabbed on this call
-      // This will be zero if there is no randomisation.
-      auto sleeping = meta->set_sleeping(sizeclass, remaining);
+      // This will be zero if there is no randomisation, apart from the
+      // objects not yet carved from the slab.
+      auto sleeping = meta->set_sleeping(
+        sizeclass, static_cast<uint16_t>(remaining + meta->uncarved()));
 
       return {p, !sleeping};
     }
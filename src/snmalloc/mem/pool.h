@@ -80,7 +80,7 @@ namespace snmalloc
    *
    * The third template argument is a method to retrieve the actual PoolState.
    *
-   * For the pool of allocators, refer to the AllocPool alias defined in
+   * For the pool of allocators, refer to the AllocPool class defined in
    * corealloc.h.
    *
    * For a pool of another type, it is recommended to leave the
@@ -1,11 +1,8 @@
 #pragma once
 #include "snmalloc/mem/backend_concept.h"
 #include "snmalloc/stl/atomic.h"
-#ifdef __SNMALLOC_USE_BBQ__
-#  include "message_bbq.h"
-#else
-#  include "freelist_queue.h"
-#endif
+#include "freelist_queue.h"
+#include "message_bbq.h"
 #include "snmalloc/stl/new.h"
 
 namespace snmalloc
@@ -287,15 +284,13 @@ namespace snmalloc
   static_assert(sizeof(RemoteMessage) <= MIN_ALLOC_SIZE);
 
   /**
-   * A RemoteAllocator is the message queue of freed objects.  It builds on the
-   * FreeListMPSCQ but encapsulates knowledge that the objects are actually
-   * RemoteMessage-s and not just any freelist::object::T<>s.
-   *
-   * RemoteAllocator-s may be exposed to client tampering.  As a result,
-   * pointer domestication may be necessary.  See the documentation for
-   * FreeListMPSCQ for details.
+   * A RemoteAllocator is the message queue of freed objects.  This base holds
+   * what is independent of the transport: the key used for all remote lists
+   * and the allocator's identity, which is the address of this object.  It is
+   * all that the pagemap and the remote deallocation cache need to route a
+   * message; the queue itself lives in `RemoteAllocatorT`, which is
+   * parameterised on the transport chosen by `Config::RemoteQueue`.
    */
-
   struct RemoteAllocator
   {
     /**
@@ -308,69 +303,276 @@ namespace snmalloc
      */
     inline static FreeListKey key_global{0xdeadbeef, 0xbeefdead, 0xdeadbeef};
 
-#if defined(__SNMALLOC_USE_BBQ__)
-    inline const static size_t block_num = 8;
-    inline const static size_t block_size = 4096;
-    batchedBBQ_MPSC<block_num, block_size, &key_global> message_queue{};
-    using BBQstatus =
-      typename batchedBBQ_MPSC<block_num, block_size, &key_global>::Queuestatus;
-#else
-    FreeListMPSCQ<key_global> list{};
-#endif
-
     using alloc_id_t = address_t;
 
     constexpr RemoteAllocator() = default;
 
+    alloc_id_t trunc_id()
+    {
+      return address_cast(this);
+    }
+  };
+
+  /**
+   * Remote message transports.  A transport is the queue embedded in each
+   * `RemoteAllocatorT` and must provide
+   *
+   *  - `invariant()` and `init()`,
+   *  - `enqueue<Config>(first, last, domesticate_head, local_state)`, which
+   *    pushes a list of messages linked through their next pointers and
+   *    returns an `EnqueueResult`,
+   *  - `dequeue<Config>(domesticate_head, domesticate_queue, cb,
+   *    local_state)`, which feeds messages to `cb` until it returns false or
+   *    the queue runs dry,
+   *  - `destroy_and_iterate<Config>(domesticate, cb, local_state)`, which
+   *    feeds every message to `cb` and may not race with producers, and
+   *  - `can_dequeue()`, a cheap hint for the receiving thread.
+   *
+   * `local_state` is the backend state of the calling thread, for transports
+   * that allocate their own storage.  A configuration chooses its transport
+   * with `Config::RemoteQueue`; see `CommonConfig`.  All configurations
+   * sharing a pagemap must use the same transport, as the pagemap records
+   * only the `RemoteAllocator` to send to.
+   */
+
+  /**
+   * What a transport's `enqueue` met on the way in.  This is only reported,
+   * in the event trace; the messages have been pushed whatever the result.
+   */
+  enum class EnqueueResult : uint8_t
+  {
+    Uncontended,
+
+    /**
+     * The queue had no room where the messages were first offered.
+     */
+    Full,
+
+    /**
+     * Another producer held the place the messages were first offered.
+     */
+    Busy,
+  };
+
+  /**
+   * The intrusive MPSC list: two pointers, no storage of its own, and the
+   * last message is only delivered once another arrives.
+   */
+  class alignas(REMOTE_MIN_ALIGN) FreeListRemoteQueue
+  {
+    FreeListMPSCQ<RemoteAllocator::key_global> list{};
+
+  public:
+    constexpr FreeListRemoteQueue() = default;
+
     void invariant()
     {
-#if defined(__SNMALLOC_USE_BBQ__)
-      message_queue
-#else
-      list
-#endif
-        .invariant();
+      list.invariant();
     }
-#if !defined(__SNMALLOC_USE_BBQ__)
+
     void init()
     {
       list.init();
     }
-#endif
 
-#if !defined(__SNMALLOC_USE_BBQ__)
-    template<typename Domesticator_queue, typename Cb>
-    void destroy_and_iterate(Domesticator_queue domesticate, Cb cb)
+    template<typename Config, typename Domesticator_head>
+    EnqueueResult enqueue(
+      freelist::HeadPtr first,
+      freelist::HeadPtr last,
+      Domesticator_head domesticate_head,
+      typename Config::LocalState*)
     {
-      auto cbwrap = [cb](freelist::HeadPtr p) SNMALLOC_FAST_PATH_LAMBDA {
-        cb(RemoteMessage::from_message_link(p));
-      };
+      list.enqueue(first, last, domesticate_head);
+      return EnqueueResult::Uncontended;
+    }
+
+    template<
+      typename Config,
+      typename Domesticator_head,
+      typename Domesticator_queue,
+      typename Cb>
+    void dequeue(
+      Domesticator_head domesticate_head,
+      Domesticator_queue domesticate_queue,
+      Cb cb,
+      typename Config::LocalState*)
+    {
+      list.dequeue(domesticate_head, domesticate_queue, cb);
+    }
 
-      return list.destroy_and_iterate(domesticate, cbwrap);
+    template<typename Config, typename Domesticator_queue, typename Cb>
+    void destroy_and_iterate(
+      Domesticator_queue domesticate, Cb cb, typename Config::LocalState*)
+    {
+      list.destroy_and_iterate(domesticate, cb);
     }
 
     inline bool can_dequeue()
     {
       return list.can_dequeue();
     }
+  };
+
+  /**
+   * The batched BBQ.  The queue is materialised on the first remote free and
+   * grows by whole segments of block_num * block_size slots, allocated from
+   * the sender's meta-data range, so an allocator that never receives a
+   * remote free only pays for the cursors.  Drained segments are returned to
+   * the receiver's meta-data range.
+   */
+  template<
+    uint32_t block_num = 8,
+    uint32_t block_size = 256,
+    size_t max_segments = 16>
+  class alignas(REMOTE_MIN_ALIGN) BBQRemoteQueue
+  {
+    using MessageQueue = lazyBBQ_MPSC<
+      block_num,
+      block_size,
+      &RemoteAllocator::key_global,
+      NO_KEY_TWEAK,
+      max_segments>;
+
+    MessageQueue message_queue{};
+
+  public:
+    constexpr BBQRemoteQueue() = default;
+
+    void invariant()
+    {
+      message_queue.invariant();
+    }
+
+    void init() {}
+
+    template<typename Config, typename Domesticator_head>
+    EnqueueResult enqueue(
+      freelist::HeadPtr first,
+      freelist::HeadPtr last,
+      Domesticator_head domesticate_head,
+      typename Config::LocalState* local_state)
+    {
+      using Queuestatus = typename MessageQueue::Queuestatus;
+      switch (message_queue.template emplace<Config>(
+        first, last, domesticate_head, local_state))
+      {
+        case Queuestatus::FULL:
+          return EnqueueResult::Full;
+        case Queuestatus::BUSY:
+          return EnqueueResult::Busy;
+        default:
+          return EnqueueResult::Uncontended;
+      }
+    }
+
+    template<
+      typename Config,
+      typename Domesticator_head,
+      typename Domesticator_queue,
+      typename Cb>
+    void dequeue(
+      Domesticator_head domesticate_head,
+      Domesticator_queue domesticate_queue,
+      Cb cb,
+      typename Config::LocalState* local_state)
+    {
+      message_queue.template front<
+        Config,
+        Domesticator_head,
+        Domesticator_queue,
+        Cb,
+        false>(domesticate_head, domesticate_queue, cb, local_state);
+    }
+
+    template<typename Config, typename Domesticator_queue, typename Cb>
+    void destroy_and_iterate(
+      Domesticator_queue domesticate,
+      Cb cb,
+      typename Config::LocalState* local_state)
+    {
+      message_queue.template destroy_and_iterate<Config>(
+        domesticate, cb, local_state);
+    }
+
+    /**
+     * Only meaningful on the receiving thread; see `lazyBBQ_MPSC::has_work`.
+     */
+    inline bool can_dequeue()
+    {
+      return message_queue.has_work();
+    }
 
-#else
     /*to preserve API completeness, see commentary in batchedbbq */
     inline bool is_empty()
     {
       return message_queue.is_empty();
     }
-#endif
+  };
 
+  /**
+   * The transport used by configurations that do not choose one.  This is
+   * the BBQ if snmalloc was built with SNMALLOC_USE_BBQ.
+   */
 #if defined(__SNMALLOC_USE_BBQ__)
-    /* get dequeue status, we need it for alloc(core) to know the dequeue status
-     * of last turn
+  using DefaultRemoteQueue = BBQRemoteQueue<>;
+#else
+  using DefaultRemoteQueue = FreeListRemoteQueue;
+#endif
+
+  /**
+   * A RemoteAllocator together with its message queue.  This encapsulates
+   * knowledge that the objects on the queue are actually RemoteMessage-s and
+   * not just any freelist::object::T<>s.
+   *
+   * RemoteAllocator-s may be exposed to client tampering.  As a result,
+   * pointer domestication may be necessary.  See the documentation for
+   * FreeListMPSCQ for details.
+   */
+  template<typename Queue>
+  struct RemoteAllocatorT : public RemoteAllocator
+  {
+    Queue queue{};
 
-     * it is atomic due to lazy-initialization of allocators, otherwise, TSAN
-        will complain
+    constexpr RemoteAllocatorT() = default;
+
+    /**
+     * Recover the full type of a remote found in the pagemap.  The caller
+     * must use the transport of the configuration that owns the pagemap.
      */
-    stl::Atomic<BBQstatus> status{BBQstatus::BUSY};
-#endif
+    static RemoteAllocatorT* from(RemoteAllocator* remote)
+    {
+      return static_cast<RemoteAllocatorT*>(remote);
+    }
+
+    void invariant()
+    {
+      queue.invariant();
+    }
+
+    void init()
+    {
+      queue.init();
+    }
+
+    template<typename Config, typename Domesticator_queue, typename Cb>
+    void destroy_and_iterate(
+      Domesticator_queue domesticate,
+      Cb cb,
+      typename Config::LocalState* local_state)
+    {
+      auto cbwrap = [cb](freelist::HeadPtr p) SNMALLOC_FAST_PATH_LAMBDA {
+        cb(RemoteMessage::from_message_link(p));
+      };
+
+      queue.template destroy_and_iterate<Config>(
+        domesticate, cbwrap, local_state);
+    }
+
+    inline bool can_dequeue()
+    {
+      return queue.can_dequeue();
+    }
+
     /**
      * Pushes a list of messages to the queue. Each message from first to
      * last should be linked together through their next pointers.
@@ -378,25 +580,18 @@ namespace snmalloc
      * The Domesticator here is used only on pointers read from the head.  See
      * the commentary on the class.
      */
-    template<typename Domesticator_head>
-#if defined(__SNMALLOC_USE_BBQ__)
-    BBQstatus
-#else
-    void
-#endif
-    enqueue(
+    template<typename Config, typename Domesticator_head>
+    EnqueueResult enqueue(
       capptr::Alloc<RemoteMessage> first,
       capptr::Alloc<RemoteMessage> last,
-      Domesticator_head domesticate_head)
+      Domesticator_head domesticate_head,
+      typename Config::LocalState* local_state)
     {
-#if defined(__SNMALLOC_USE_BBQ__)
-      return message_queue.emplace
-#else
-      list.enqueue
-#endif
-        (RemoteMessage::to_message_link(first),
-         RemoteMessage::to_message_link(last),
-         domesticate_head);
+      return queue.template enqueue<Config>(
+        RemoteMessage::to_message_link(first),
+        RemoteMessage::to_message_link(last),
+        domesticate_head,
+        local_state);
     }
 
     /**
@@ -408,50 +603,21 @@ namespace snmalloc
      * "pointers read from queue".  See the commentary on the class.
      */
     template<
+      typename Config,
       typename Domesticator_head,
       typename Domesticator_queue,
       typename Cb>
-#if defined(__SNMALLOC_USE_BBQ__)
-    BBQstatus
-#else
-    void
-#endif
-    dequeue(
+    void dequeue(
       Domesticator_head domesticate_head,
       Domesticator_queue domesticate_queue,
-      Cb cb)
+      Cb cb,
+      typename Config::LocalState* local_state)
     {
       auto cbwrap = [cb](freelist::HeadPtr p) SNMALLOC_FAST_PATH_LAMBDA {
         return cb(RemoteMessage::from_message_link(p));
       };
-#if defined(__SNMALLOC_USE_BBQ__)
-      status.store(
-        message_queue.template front<
-          Domesticator_head,
-          Domesticator_queue,
-          decltype(cbwrap),
-          false>
-#else
-      list.dequeue
-#endif
-        (domesticate_head, domesticate_queue, cbwrap)
-
-#if defined(__SNMALLOC_USE_BBQ__)
-          ,
-        stl::memory_order_release);
-      return status.load(stl::memory_order_acquire);
-#else
-        ;
-#endif
-    }
-
-    alloc_id_t trunc_id()
-    {
-      return address_cast(this);
+      queue.template dequeue<Config>(
+        domesticate_head, domesticate_queue, cbwrap, local_state);
     }
   };
-
-#if defined(__SNMALLOC_USE_BBQ__)
-  using MessageQueueStatus = typename RemoteAllocator::BBQstatus;
-#endif
 } // namespace snmalloc
@@ -273,9 +273,15 @@ namespace snmalloc
         });
     }
 
-    template<size_t allocator_size>
+    /**
+     * Send every cached message to its allocator, recording each send in
+     * `trace`.
+     */
+    template<size_t allocator_size, typename Trace>
     bool post(
-      typename Config::LocalState* local_state, RemoteAllocator::alloc_id_t id)
+      typename Config::LocalState* local_state,
+      RemoteAllocator::alloc_id_t id,
+      Trace& trace)
     {
       // Use same key as the remote allocator, so segments can be
       // posted to a remote allocator without reencoding.
@@ -310,7 +316,9 @@ namespace snmalloc
             auto last = RemoteMessage::from_message_link(last_);
             const auto& entry =
               Config::Backend::get_metaentry(address_cast(first_));
-            auto remote = entry.get_remote();
+            auto remote =
+              RemoteAllocatorT<typename Config::RemoteQueue>::from(
+                entry.get_remote());
             // If the allocator is not correctly aligned, then the bit that is
             // set implies this is used by the backend, and we should not be
             // deallocating memory here.
@@ -318,57 +326,28 @@ namespace snmalloc
               mitigations(sanity_checks),
               !entry.is_backend_owned(),
               "Delayed detection of attempt to free internal structure.");
+            EnqueueResult result;
             if constexpr (Config::Options.QueueHeadsAreTame)
             {
               auto domesticate_nop = [](freelist::QueuePtr p) {
                 return freelist::HeadPtr::unsafe_from(p.unsafe_ptr());
               };
 
-#if defined(__SNMALLOC_USE_BBQ__)
-              MessageQueueStatus st{};
-              while (
-                (st =
-#endif
-                   remote->enqueue(first, last, domesticate_nop)
-
-#if defined(__SNMALLOC_USE_BBQ__)
-                   ))
-              {
-                if (SNMALLOC_UNLIKELY(st == MessageQueueStatus::FULL))
-                {
-#  ifdef SNMALLOC_TRACING
-                  message<1024>(
-                    "message_queue(bbq) is full now, waiting for dequeue...");
-#  endif
-                }
-              };
-#endif
-              ;
+              result = remote->template enqueue<Config>(
+                first, last, domesticate_nop, local_state);
             }
             else
             {
-#if defined(__SNMALLOC_USE_BBQ__)
-              MessageQueueStatus st{};
-              while (
-                (st =
-#endif
-                   remote->enqueue(first, last, domesticate)
-
-#if defined(__SNMALLOC_USE_BBQ__)
-                   ))
-              {
-                if (SNMALLOC_UNLIKELY(st == MessageQueueStatus::FULL))
-                {
-#  ifdef SNMALLOC_TRACING
-                  message<1024>(
-                    "message_queue(bbq) is full now, waiting for dequeue...");
-#  endif
-                }
-              };
-#endif
-              ;
+              result = remote->template enqueue<Config>(
+                first, last, domesticate, local_state);
             }
             sent_something = true;
+
+            trace.post(remote->trunc_id());
+            if (SNMALLOC_UNLIKELY(result == EnqueueResult::Full))
+              trace.queue_full(remote->trunc_id());
+            else if (SNMALLOC_UNLIKELY(result == EnqueueResult::Busy))
+              trace.queue_busy(remote->trunc_id());
           }
         }
 
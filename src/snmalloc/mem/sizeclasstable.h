@@ -539,6 +539,12 @@ namespace snmalloc
     return bits::one_at_bit(bits::ctz(rsize));
   }
 
+  /// Returns the size to allocate for `size` bytes aligned to `alignment`.
+  /// Every object in a slab must be aligned, so the stride is a multiple of
+  /// the alignment, and rounding this to a sizeclass gives the smallest
+  /// sizeclass with that property (checked by the sizeclass test).  Below
+  /// the alignment, the rest of each object cannot be used by a slab laid
+  /// out at a uniform stride.
   constexpr SNMALLOC_FAST_PATH static size_t
   aligned_size(size_t alignment, size_t size)
   {
@@ -14,6 +14,10 @@ namespace snmalloc
    *
    * The aim is to reduce the time spent querying the time as this might be
    * an expensive operation if time has been virtualised.
+   *
+   * Callers can pass a hook that is run, with the current time, each time
+   * the clock is queried.  This allows periodic work to be piggy-backed on
+   * the tick without adding to the fast path.
    */
   template<typename PAL>
   class Ticker
@@ -40,10 +44,11 @@ namespace snmalloc
      * Slow path that actually queries clock and sets up
      * how many calls for the next time we hit the slow path.
      */
-    template<typename T = void*>
-    SNMALLOC_SLOW_PATH T check_tick_slow(T p = nullptr) noexcept
+    template<typename T, typename F>
+    SNMALLOC_SLOW_PATH T check_tick_slow(T p, F& on_tick) noexcept
     {
       uint64_t now_ms = PAL::time_in_ms();
+      on_tick(now_ms);
 
       // Set up clock.
       if (last_query_ms == 0)
@@ -82,6 +87,12 @@ namespace snmalloc
   public:
     template<typename T = void*>
     SNMALLOC_FAST_PATH T check_tick(T p = nullptr)
+    {
+      return check_tick(p, [](uint64_t) {});
+    }
+
+    template<typename T, typename F>
+    SNMALLOC_FAST_PATH T check_tick(T p, F on_tick)
     {
       if constexpr (pal_supports<Time, PAL>)
       {
@@ -91,9 +102,13 @@ namespace snmalloc
         // heart beat.
         if (--count_down == 0)
         {
-          return check_tick_slow(p);
+          return check_tick_slow(p, on_tick);
         }
       }
+      else
+      {
+        UNUSED(on_tick);
+      }
       return p;
     }
   };
@@ -3,6 +3,9 @@
 #include <errno.h>
 #include <limits.h>
 #include <string.h>
+#ifdef SNMALLOC_HEAP_PROFILE
+#  include <stdio.h>
+#endif
 
 using namespace snmalloc;
 
@@ -47,7 +50,7 @@ namespace
 
     /**
      * Jemalloc's *allocm APIs use bit 7 to indicate whether reallocation may
-     * move.  This is ignored by the `*allocx` functions.
+     * move.  `rallocx` honours it too, returning null rather than moving.
      */
     constexpr bool may_not_move()
     {
@@ -80,6 +83,595 @@ namespace
      */
     allocm_err_not_moved = 2
   };
+
+  /**
+   * jemalloc's `arena.<i>` and `stats.arenas.<i>` index for all arenas.
+   * snmalloc has a single arena, 0, so the two are equivalent.
+   */
+  constexpr size_t MALLCTL_ARENAS_ALL = 4096;
+
+  /**
+   * Longest MIB in the `mallctl` namespace below.
+   */
+  constexpr size_t CTL_MAX_DEPTH = 6;
+
+  /**
+   * Statistics as of the last write to `epoch`, as jemalloc's `stats.*` are.
+   */
+  FlagWord ctl_stats_lock{};
+  AllocStatsSnapshot ctl_stats_snapshot{};
+  uint64_t ctl_epoch = 0;
+
+  void ctl_refresh()
+  {
+    AllocStatsSnapshot fresh;
+    get_stats(fresh);
+    with(ctl_stats_lock, [&]() {
+      ctl_stats_snapshot = fresh;
+      ctl_epoch++;
+    });
+  }
+
+  AllocStatsSnapshot ctl_snapshot()
+  {
+    AllocStatsSnapshot result;
+    bool stale = false;
+    with(ctl_stats_lock, [&]() {
+      result = ctl_stats_snapshot;
+      stale = ctl_epoch == 0;
+    });
+    if (stale)
+    {
+      ctl_refresh();
+      return ctl_snapshot();
+    }
+    return result;
+  }
+
+  /**
+   * The arguments to a `mallctl` call, with the name resolved to a MIB.
+   */
+  struct CtlArgs
+  {
+    const size_t* mib;
+    void* oldp;
+    size_t* oldlenp;
+    void* newp;
+    size_t newlen;
+
+    /**
+     * Copy out the value of a read-only entry.  As in jemalloc, a length
+     * mismatch copies as much as fits and fails.
+     */
+    template<typename T>
+    int read(T value) const
+    {
+      if (newp != nullptr)
+        return EPERM;
+      if (oldp != nullptr && oldlenp != nullptr)
+      {
+        if (*oldlenp != sizeof(T))
+        {
+          size_t len = bits::min(*oldlenp, sizeof(T));
+          memcpy(oldp, &value, len);
+          *oldlenp = len;
+          return EINVAL;
+        }
+        memcpy(oldp, &value, sizeof(T));
+      }
+      return 0;
+    }
+
+    /**
+     * Fetch the new value of a writeable entry, returning false if there is
+     * none.  Sets `err` if the value has the wrong size.
+     */
+    template<typename T>
+    bool write(T& value, int& err) const
+    {
+      if (newp == nullptr)
+        return false;
+      if (newlen != sizeof(T))
+      {
+        err = EINVAL;
+        return false;
+      }
+      memcpy(&value, newp, sizeof(T));
+      return true;
+    }
+
+    /**
+     * Read a statistic.  Counters that only exist when built with
+     * SNMALLOC_STATS are reported as missing otherwise.
+     */
+    template<typename T, typename Get>
+    int stat(bool counted, Get get) const
+    {
+      if (counted && !STATS_ENABLED)
+        return ENOENT;
+      return read(static_cast<T>(get(ctl_snapshot())));
+    }
+  };
+
+  using CtlHandler = int (*)(const CtlArgs&);
+
+  /**
+   * A node in the `mallctl` namespace.  A name is a dot-separated path from
+   * the root; its MIB replaces each named component with the index of the
+   * node among its siblings and keeps numeric components as they are.
+   */
+  struct CtlNode
+  {
+    /**
+     * The component name, or nullptr for a numeric component.
+     */
+    const char* name;
+    const CtlNode* children;
+    size_t nchildren;
+    CtlHandler handler;
+    /**
+     * Numeric components must be below this, or be MALLCTL_ARENAS_ALL for
+     * arena indices.
+     */
+    size_t limit;
+    bool arena;
+
+    bool accepts(size_t index) const
+    {
+      return index < limit || (arena && index == MALLCTL_ARENAS_ALL);
+    }
+  };
+
+  constexpr CtlNode ctl_leaf(const char* name, CtlHandler handler)
+  {
+    return {name, nullptr, 0, handler, 0, false};
+  }
+
+  template<size_t N>
+  constexpr CtlNode ctl_node(const char* name, const CtlNode (&children)[N])
+  {
+    return {name, children, N, nullptr, 0, false};
+  }
+
+  template<size_t N>
+  constexpr CtlNode ctl_index(size_t limit, const CtlNode (&children)[N])
+  {
+    return {nullptr, children, N, nullptr, limit, false};
+  }
+
+  template<size_t N>
+  constexpr CtlNode ctl_arena(const CtlNode (&children)[N])
+  {
+    return {nullptr, children, N, nullptr, 1, true};
+  }
+
+  /**
+   * Return this thread's cached objects and remote frees, and then those of
+   * every idle allocator.
+   */
+  int ctl_purge(const CtlArgs&)
+  {
+    auto purge = [](Alloc& a) {
+      a.flush();
+      a.release_cached_memory();
+    };
+    ThreadAlloc::CheckInit::check_init(
+      [purge]() { ThreadAlloc::with(purge); },
+      [purge](Alloc* a) { purge(*a); });
+    cleanup_unused();
+    return 0;
+  }
+
+  // arenas.bin.<i>.*
+  constexpr CtlNode ctl_arenas_bin[] = {
+    ctl_leaf(
+      "size",
+      [](const CtlArgs& a) {
+        return a.read<size_t>(sizeclass_to_size(a.mib[2]));
+      }),
+    ctl_leaf(
+      "nregs",
+      [](const CtlArgs& a) {
+        return a.read<uint32_t>(sizeclass_to_slab_object_count(a.mib[2]));
+      }),
+    ctl_leaf(
+      "slab_size",
+      [](const CtlArgs& a) {
+        return a.read<size_t>(sizeclass_to_slab_size(a.mib[2]));
+      }),
+  };
+
+  constexpr CtlNode ctl_arenas_bins[] = {
+    ctl_index(NUM_SMALL_SIZECLASSES, ctl_arenas_bin)};
+
+  constexpr CtlNode ctl_arenas[] = {
+    ctl_leaf("narenas", [](const CtlArgs& a) { return a.read<unsigned>(1); }),
+    ctl_leaf(
+      "nbins",
+      [](const CtlArgs& a) {
+        return a.read<unsigned>(static_cast<unsigned>(NUM_SMALL_SIZECLASSES));
+      }),
+    ctl_leaf(
+      "page", [](const CtlArgs& a) { return a.read<size_t>(OS_PAGE_SIZE); }),
+    ctl_leaf(
+      "quantum",
+      [](const CtlArgs& a) { return a.read<size_t>(MIN_ALLOC_STEP_SIZE); }),
+    ctl_node("bin", ctl_arenas_bins),
+  };
+
+  // arena.<i>.*
+  constexpr CtlNode ctl_arena_ops[] = {
+    ctl_leaf("purge", ctl_purge),
+    ctl_leaf("decay", ctl_purge),
+  };
+
+  constexpr CtlNode ctl_arena_index[] = {ctl_arena(ctl_arena_ops)};
+
+  // stats.arenas.<i>.bins.<j>.*
+  constexpr CtlNode ctl_stats_bin[] = {
+    ctl_leaf(
+      "nmalloc",
+      [](const CtlArgs& a) {
+        return a.stat<uint64_t>(true, [&a](const AllocStatsSnapshot& s) {
+          return s.small[a.mib[4]].allocs;
+        });
+      }),
+    ctl_leaf(
+      "ndalloc",
+      [](const CtlArgs& a) {
+        return a.stat<uint64_t>(true, [&a](const AllocStatsSnapshot& s) {
+          return s.small[a.mib[4]].deallocs;
+        });
+      }),
+    ctl_leaf(
+      "curregs",
+      [](const CtlArgs& a) {
+        return a.stat<size_t>(true, [&a](const AllocStatsSnapshot& s) {
+          return s.live_objects(a.mib[4]);
+        });
+      }),
+    ctl_leaf(
+      "nslabs",
+      [](const CtlArgs& a) {
+        return a.stat<uint64_t>(true, [&a](const AllocStatsSnapshot& s) {
+          return s.small[a.mib[4]].slabs_allocated;
+        });
+      }),
+    ctl_leaf(
+      "curslabs",
+      [](const CtlArgs& a) {
+        return a.stat<size_t>(true, [&a](const AllocStatsSnapshot& s) {
+          return s.live_slabs(a.mib[4]);
+        });
+      }),
+  };
+
+  constexpr CtlNode ctl_stats_bins[] = {
+    ctl_index(NUM_SMALL_SIZECLASSES, ctl_stats_bin)};
+
+  // stats.arenas.<i>.large.*
+  constexpr CtlNode ctl_stats_large[] = {
+    ctl_leaf(
+      "allocated",
+      [](const CtlArgs& a) {
+        return a.stat<size_t>(
+          true, [](const AllocStatsSnapshot& s) { return s.large_bytes(); });
+      }),
+    ctl_leaf(
+      "nmalloc",
+      [](const CtlArgs& a) {
+        return a.stat<uint64_t>(
+          true, [](const AllocStatsSnapshot& s) { return s.large_allocs; });
+      }),
+    ctl_leaf(
+      "ndalloc",
+      [](const CtlArgs& a) {
+        return a.stat<uint64_t>(
+          true, [](const AllocStatsSnapshot& s) { return s.large_deallocs; });
+      }),
+  };
+
+  constexpr CtlNode ctl_stats_arena[] = {
+    ctl_node("bins", ctl_stats_bins),
+    ctl_node("large", ctl_stats_large),
+  };
+
+  constexpr CtlNode ctl_stats_arenas[] = {ctl_arena(ctl_stats_arena)};
+
+  constexpr CtlNode ctl_stats[] = {
+    ctl_leaf(
+      "allocated",
+      [](const CtlArgs& a) {
+        return a.stat<size_t>(true, [](const AllocStatsSnapshot& s) {
+          return s.small_bytes_allocated() + s.large_bytes();
+        });
+      }),
+    ctl_leaf(
+      "active",
+      [](const CtlArgs& a) {
+        return a.stat<size_t>(true, [](const AllocStatsSnapshot& s) {
+          return s.slab_bytes() + s.large_bytes();
+        });
+      }),
+    ctl_leaf(
+      "resident",
+      [](const CtlArgs& a) {
+        return a.stat<size_t>(
+          false, [](const AllocStatsSnapshot& s) { return s.committed_bytes; });
+      }),
+    ctl_leaf(
+      "mapped",
+      [](const CtlArgs& a) {
+        return a.stat<size_t>(
+          false, [](const AllocStatsSnapshot& s) { return s.committed_bytes; });
+      }),
+    ctl_leaf(
+      "retained",
+      [](const CtlArgs& a) {
+        return a.stat<size_t>(
+          true, [](const AllocStatsSnapshot& s) { return s.retained_bytes(); });
+      }),
+    ctl_node("arenas", ctl_stats_arenas),
+  };
+
+  constexpr CtlNode ctl_tcache[] = {
+    ctl_leaf("flush", [](const CtlArgs&) {
+      ThreadAlloc::CheckInit::check_init(
+        []() { ThreadAlloc::with([](Alloc& a) { a.flush(); }); },
+        [](Alloc* a) { a->flush(); });
+      return 0;
+    }),
+  };
+
+  constexpr CtlNode ctl_thread[] = {ctl_node("tcache", ctl_tcache)};
+
+  /**
+   * Write the heap profile to `filename`, followed by this process's
+   * mappings so that pprof can symbolise it.
+   */
+  int ctl_prof_dump(const char* filename)
+  {
+#ifdef SNMALLOC_HEAP_PROFILE
+    FILE* f = fopen(filename, "w");
+    if (f == nullptr)
+      return EFAULT;
+
+    heap_profile_dump(
+      [f](const char* data, size_t len) { fwrite(data, 1, len, f); });
+
+    fputs("\nMAPPED_LIBRARIES:\n", f);
+    FILE* maps = fopen("/proc/self/maps", "r");
+    if (maps != nullptr)
+    {
+      char buffer[4096];
+      size_t len;
+      while ((len = fread(buffer, 1, sizeof(buffer), maps)) != 0)
+        fwrite(buffer, 1, len, f);
+      fclose(maps);
+    }
+
+    return fclose(f) == 0 ? 0 : EFAULT;
+#else
+    UNUSED(filename);
+    return ENOENT;
+#endif
+  }
+
+  using Profiler = HeapProfiler<Alloc::Config>;
+
+  // prof.*, which as in jemalloc are missing unless built for profiling.
+  constexpr CtlNode ctl_prof[] = {
+    ctl_leaf(
+      "active",
+      [](const CtlArgs& a) {
+        if (!HEAP_PROFILE_ENABLED)
+          return ENOENT;
+        bool old = Profiler::is_active();
+        bool active = false;
+        int err = 0;
+        if (a.write(active, err))
+        {
+          if (active)
+            heap_profile_start(Profiler::interval());
+          else
+            heap_profile_stop();
+        }
+        if (err != 0)
+          return err;
+        return CtlArgs{a.mib, a.oldp, a.oldlenp, nullptr, 0}.read(old);
+      }),
+    ctl_leaf(
+      "dump",
+      [](const CtlArgs& a) {
+        if (!HEAP_PROFILE_ENABLED)
+          return ENOENT;
+        const char* filename = nullptr;
+        int err = 0;
+        if (!a.write(filename, err) || filename == nullptr)
+          return err != 0 ? err : EINVAL;
+        return ctl_prof_dump(filename);
+      }),
+    ctl_leaf(
+      "lg_sample",
+      [](const CtlArgs& a) {
+        if (!HEAP_PROFILE_ENABLED)
+          return ENOENT;
+        return a.read<size_t>(bits::next_pow2_bits(Profiler::interval()));
+      }),
+    // Sets the sample interval.  Unlike jemalloc, samples of live objects
+    // are kept.
+    ctl_leaf(
+      "reset",
+      [](const CtlArgs& a) {
+        if (!HEAP_PROFILE_ENABLED)
+          return ENOENT;
+        size_t lg_sample = 0;
+        int err = 0;
+        if (a.write(lg_sample, err))
+        {
+          if (lg_sample >= bits::BITS)
+            return EINVAL;
+          Profiler::set_interval(bits::one_at_bit(lg_sample));
+        }
+        return err;
+      }),
+  };
+
+  constexpr CtlNode ctl_config[] = {
+    ctl_leaf(
+      "prof",
+      [](const CtlArgs& a) { return a.read<bool>(HEAP_PROFILE_ENABLED); }),
+    ctl_leaf(
+      "stats", [](const CtlArgs& a) { return a.read<bool>(STATS_ENABLED); }),
+  };
+
+  constexpr CtlNode ctl_root_children[] = {
+    ctl_leaf(
+      "version",
+      [](const CtlArgs& a) {
+        return a.read<const char*>("5.3.0-0-snmalloc");
+      }),
+    ctl_leaf(
+      "epoch",
+      [](const CtlArgs& a) {
+        uint64_t ignored;
+        int err = 0;
+        if (a.write(ignored, err))
+          ctl_refresh();
+        if (err != 0)
+          return err;
+        uint64_t epoch = 0;
+        with(ctl_stats_lock, [&]() { epoch = ctl_epoch; });
+        return CtlArgs{a.mib, a.oldp, a.oldlenp, nullptr, 0}.read(epoch);
+      }),
+    ctl_node("config", ctl_config),
+    ctl_node("thread", ctl_thread),
+    ctl_node("arena", ctl_arena_index),
+    ctl_node("arenas", ctl_arenas),
+    ctl_node("stats", ctl_stats),
+    ctl_node("prof", ctl_prof),
+  };
+
+  constexpr CtlNode ctl_root = ctl_node("", ctl_root_children);
+
+  /**
+   * Find the child of `node` named by `component`, which is `len` bytes long,
+   * and its MIB index.
+   */
+  const CtlNode* ctl_child(
+    const CtlNode* node, const char* component, size_t len, size_t& index)
+  {
+    for (size_t i = 0; i < node->nchildren; i++)
+    {
+      const CtlNode* child = &node->children[i];
+      if (child->name == nullptr)
+      {
+        if (len == 0)
+          return nullptr;
+        size_t value = 0;
+        for (size_t j = 0; j < len; j++)
+        {
+          if (component[j] < '0' || component[j] > '9')
+            return nullptr;
+          value = value * 10 + static_cast<size_t>(component[j] - '0');
+          if (value > MALLCTL_ARENAS_ALL)
+            return nullptr;
+        }
+        if (!child->accepts(value))
+          return nullptr;
+        index = value;
+        return child;
+      }
+      if (
+        strncmp(child->name, component, len) == 0 && child->name[len] == '\0')
+      {
+        index = i;
+        return child;
+      }
+    }
+    return nullptr;
+  }
+
+  int ctl_name_to_mib(const char* name, size_t* mibp, size_t* miblenp)
+  {
+    if (name == nullptr || mibp == nullptr || miblenp == nullptr)
+      return EINVAL;
+
+    const CtlNode* node = &ctl_root;
+    size_t depth = 0;
+    while (true)
+    {
+      const char* end = strchr(name, '.');
+      size_t len =
+        end == nullptr ? strlen(name) : static_cast<size_t>(end - name);
+      if (depth == *miblenp)
+        return ENOENT;
+      node = ctl_child(node, name, len, mibp[depth]);
+      if (node == nullptr)
+        return ENOENT;
+      depth++;
+      if (end == nullptr)
+        break;
+      name = end + 1;
+    }
+    *miblenp = depth;
+    return 0;
+  }
+
+  int ctl_by_mib(
+    const size_t* mib,
+    size_t miblen,
+    void* oldp,
+    size_t* oldlenp,
+    void* newp,
+    size_t newlen)
+  {
+    if (mib == nullptr || miblen == 0 || miblen > CTL_MAX_DEPTH)
+      return ENOENT;
+
+    const CtlNode* node = &ctl_root;
+    for (size_t depth = 0; depth < miblen; depth++)
+    {
+      if (node->nchildren == 0)
+        return ENOENT;
+      const CtlNode* first = &node->children[0];
+      if (first->name == nullptr)
+      {
+        if (!first->accepts(mib[depth]))
+          return ENOENT;
+        node = first;
+      }
+      else
+      {
+        if (mib[depth] >= node->nchildren)
+          return ENOENT;
+        node = &node->children[mib[depth]];
+      }
+    }
+
+    if (node->handler == nullptr)
+      return ENOENT;
+    return node->handler({mib, oldp, oldlenp, newp, newlen});
+  }
+
+  /**
+   * Resize the large allocation at `ptr` to `size` bytes without moving it,
+   * zeroing any part that is added if `zero` is set.  Returns false, leaving
+   * the allocation unchanged, if this is not possible.
+   */
+  inline bool try_resize_in_place(void* ptr, size_t size, bool zero)
+  {
+    size_t old_size = alloc_size(ptr);
+    if (
+      (old_size <= MAX_SMALL_SIZECLASS_SIZE) ||
+      (size <= MAX_SMALL_SIZECLASS_SIZE) || !resize_in_place(ptr, size))
+      return false;
+
+    size_t new_size = alloc_size(ptr);
+    if (zero && (new_size > old_size))
+      Config::Pal::zero(pointer_offset(ptr, old_size), new_size - old_size);
+    return true;
+  }
 } // namespace
 
 extern "C"
@@ -98,31 +690,57 @@ extern "C"
 
   /**
    * Jemalloc API provides a way of avoiding name lookup when calling
-   * `mallctl`.  For now, always return an error.
+   * `mallctl`.  Translates `name` into a MIB for `mallctlbymib`; on entry
+   * `*miblenp` is the capacity of `mibp` and on return the MIB's length.
    */
-  int SNMALLOC_NAME_MANGLE(mallctlnametomib)(const char*, size_t*, size_t*)
+  int SNMALLOC_NAME_MANGLE(mallctlnametomib)(
+    const char* name, size_t* mibp, size_t* miblenp)
   {
-    return ENOENT;
+    return ctl_name_to_mib(name, mibp, miblenp);
   }
 
   /**
-   * Jemalloc API provides a generic entry point for various functions.  For
-   * now, this is always implemented to return an error.
+   * Jemalloc API provides a generic entry point for various functions.  This
+   * is `mallctl` with the name already resolved by `mallctlnametomib`.
    */
   int SNMALLOC_NAME_MANGLE(mallctlbymib)(
-    const size_t*, size_t, void*, size_t*, void*, size_t)
+    const size_t* mib,
+    size_t miblen,
+    void* oldp,
+    size_t* oldlenp,
+    void* newp,
+    size_t newlen)
   {
-    return ENOENT;
+    return ctl_by_mib(mib, miblen, oldp, oldlenp, newp, newlen);
   }
 
   /**
-   * Jemalloc API provides a generic entry point for various functions.  For
-   * now, this is always implemented to return an error.
+   * Jemalloc API provides a generic entry point for various functions.  The
+   * supported subset of jemalloc's namespace is:
+   *
+   *  - `version`, `epoch`, `config.stats`
+   *  - `thread.tcache.flush`: flush the calling thread's allocator.
+   *  - `arena.<i>.purge`, `arena.<i>.decay`: flush the calling thread's
+   *    allocator and every idle one, returning empty slabs to the backend
+   *    and decommitting the memory the backend caches for them.
+   *  - `arenas.narenas`, `arenas.nbins`, `arenas.page`, `arenas.quantum`,
+   *    `arenas.bin.<i>.{size,nregs,slab_size}`
+   *  - `stats.{allocated,active,resident,mapped,retained}`
+   *  - `stats.arenas.<i>.bins.<j>.{nmalloc,ndalloc,curregs,nslabs,curslabs}`
+   *  - `stats.arenas.<i>.large.{allocated,nmalloc,ndalloc}`
+   *
+   * There is a single arena, 0, which is also MALLCTL_ARENAS_ALL.  Counters
+   * other than `stats.resident` and `stats.mapped` need SNMALLOC_STATS.
    */
-  SNMALLOC_EXPORT int
-  SNMALLOC_NAME_MANGLE(mallctl)(const char*, void*, size_t*, void*, size_t)
+  SNMALLOC_EXPORT int SNMALLOC_NAME_MANGLE(mallctl)(
+    const char* name, void* oldp, size_t* oldlenp, void* newp, size_t newlen)
   {
-    return ENOENT;
+    size_t mib[CTL_MAX_DEPTH];
+    size_t miblen = CTL_MAX_DEPTH;
+    int err = ctl_name_to_mib(name, mib, &miblen);
+    if (err != 0)
+      return err;
+    return ctl_by_mib(mib, miblen, oldp, oldlenp, newp, newlen);
   }
 
 #ifdef SNMALLOC_JEMALLOC3_EXPERIMENTAL
@@ -177,16 +795,30 @@ extern "C"
       return allocm_success;
     }
 
-    if (f.may_not_move())
+    size_t esize = asize;
+    if (SIZE_MAX - size > extra)
     {
-      return allocm_err_not_moved;
+      esize = f.aligned_size(size + extra);
     }
 
-    if (SIZE_MAX - size > extra)
+    if (
+      try_resize_in_place(*ptr, esize, f.should_zero()) ||
+      try_resize_in_place(*ptr, asize, f.should_zero()))
     {
-      asize = f.aligned_size(size + extra);
+      if (rsize != nullptr)
+      {
+        *rsize = alloc_size(*ptr);
+      }
+      return allocm_success;
     }
 
+    if (f.may_not_move())
+    {
+      return allocm_err_not_moved;
+    }
+
+    asize = esize;
+
     void* p = f.should_zero() ? alloc<Zero>(asize) : alloc(asize);
     if (SNMALLOC_LIKELY(p != nullptr))
     {
@@ -195,7 +827,7 @@ extern "C"
       // otherwise.
       if (sz != 0)
       {
-        memcpy(p, *ptr, sz);
+        libc::realloc_copy(p, *ptr, sz);
       }
       dealloc(*ptr);
       *ptr = p;
@@ -263,8 +895,10 @@ extern "C"
   /**
    * Jemalloc non-standard function that is similar to `realloc`.  This can
    * request zeroed memory for any newly allocated memory, though only if the
-   * object grows (which, for snmalloc, means if it's copied).  The flags
-   * controlling the thread cache and arena are ignored.
+   * object grows.  Large objects are resized in place where possible.  If
+   * the no-move bit is set and that is not possible, this returns null and
+   * leaves the allocation alone.  The flags controlling the thread cache and
+   * arena are ignored.
    */
   SNMALLOC_EXPORT void*
   SNMALLOC_NAME_MANGLE(rallocx)(void* ptr, size_t size, int flags)
@@ -284,6 +918,16 @@ extern "C"
       return nullptr;
     }
 
+    if (try_resize_in_place(ptr, size, f.should_zero()))
+    {
+      return ptr;
+    }
+
+    if (f.may_not_move())
+    {
+      return nullptr;
+    }
+
     // We have a choice here of either asking for zeroed memory, or trying to
     // zero the remainder.  The former is *probably* faster for large
     // allocations, because we get zeroed memory from the PAL and don't zero it
@@ -296,7 +940,7 @@ extern "C"
       // Guard memcpy as GCC is assuming not nullptr for ptr after the memcpy
       // otherwise.
       if (sz != 0)
-        memcpy(p, ptr, sz);
+        libc::realloc_copy(p, ptr, sz);
       dealloc(ptr);
     }
     return p;
@@ -304,12 +948,31 @@ extern "C"
 
   /**
    * Jemalloc non-standard API that performs a `realloc` only if it can do so
-   * without copying and returns the size of the underlying object.  With
-   * snmalloc, this simply returns the size of the sizeclass backing the
-   * object.
+   * without copying and returns the size of the underlying object.  The
+   * object is resized to hold at least `size` bytes, and `size` + `extra` if
+   * that is also possible.  Only large objects change size.
    */
-  size_t SNMALLOC_NAME_MANGLE(xallocx)(void* ptr, size_t, size_t, int)
+  size_t
+  SNMALLOC_NAME_MANGLE(xallocx)(void* ptr, size_t size, size_t extra, int flags)
   {
+    auto f = JEMallocFlags(flags);
+    size_t min_size = f.aligned_size(size);
+    size_t max_size = min_size;
+    if (SIZE_MAX - size > extra)
+    {
+      max_size = f.aligned_size(size + extra);
+    }
+
+    size_t current = alloc_size(ptr);
+    if ((current < round_size(min_size)) || (current > round_size(max_size)))
+    {
+      if (!try_resize_in_place(ptr, max_size, f.should_zero()))
+        try_resize_in_place(ptr, min_size, f.should_zero());
+    }
+    else if (current < round_size(max_size))
+    {
+      try_resize_in_place(ptr, max_size, f.should_zero());
+    }
     return alloc_size(ptr);
   }
 
@@ -1,4 +1,5 @@
 #include "override.h"
+#include "record.h"
 
 using namespace snmalloc;
 
@@ -15,22 +16,47 @@ extern "C"
 
   SNMALLOC_EXPORT void* SNMALLOC_NAME_MANGLE(malloc)(size_t size)
   {
-    return snmalloc::libc::malloc(size);
+    return record::alloc(snmalloc::libc::malloc(size), size);
+  }
+
+  /**
+   * Allocates `n` objects of `size` bytes into `out` and returns how many
+   * were allocated.  Fewer than `n` means memory ran out, with errno set.
+   */
+  SNMALLOC_EXPORT size_t
+  SNMALLOC_NAME_MANGLE(malloc_batch)(size_t size, size_t n, void** out)
+  {
+    size_t count = snmalloc::alloc_batch(size, n, out);
+    for (size_t i = 0; i < count; i++)
+      record::alloc(out[i], size);
+    return count;
   }
 
   SNMALLOC_EXPORT void SNMALLOC_NAME_MANGLE(free)(void* ptr)
   {
+    record::free(ptr);
     snmalloc::libc::free(ptr);
   }
 
+  /**
+   * Frees the `n` objects in `ptrs`.
+   */
+  SNMALLOC_EXPORT void SNMALLOC_NAME_MANGLE(free_batch)(void** ptrs, size_t n)
+  {
+    for (size_t i = 0; i < n; i++)
+      record::free(ptrs[i]);
+    snmalloc::dealloc_batch(ptrs, n);
+  }
+
   SNMALLOC_EXPORT void SNMALLOC_NAME_MANGLE(cfree)(void* ptr)
   {
+    record::free(ptr);
     snmalloc::libc::free(ptr);
   }
 
   SNMALLOC_EXPORT void* SNMALLOC_NAME_MANGLE(calloc)(size_t nmemb, size_t size)
   {
-    return snmalloc::libc::calloc(nmemb, size);
+    return record::alloc(snmalloc::libc::calloc(nmemb, size), nmemb * size);
   }
 
   SNMALLOC_EXPORT
@@ -56,14 +82,22 @@ extern "C"
 
   SNMALLOC_EXPORT void* SNMALLOC_NAME_MANGLE(realloc)(void* ptr, size_t size)
   {
-    return snmalloc::libc::realloc(ptr, size);
+    // Realloc may free ptr, so takes its place in the trace before any other
+    // thread can be given the same address.
+    auto ticket = record::begin();
+    return record::realloc(
+      ticket, ptr, size, snmalloc::libc::realloc(ptr, size));
   }
 
 #if !defined(SNMALLOC_NO_REALLOCARRAY)
   SNMALLOC_EXPORT void*
   SNMALLOC_NAME_MANGLE(reallocarray)(void* ptr, size_t nmemb, size_t size)
   {
-    return snmalloc::libc::reallocarray(ptr, nmemb, size);
+    bool overflow = false;
+    size_t bytes = bits::umul(size, nmemb, overflow);
+    auto ticket = overflow ? record::NO_TICKET : record::begin();
+    return record::realloc(
+      ticket, ptr, bytes, snmalloc::libc::reallocarray(ptr, nmemb, size));
   }
 #endif
 
@@ -71,39 +105,55 @@ extern "C"
   SNMALLOC_EXPORT int
   SNMALLOC_NAME_MANGLE(reallocarr)(void* ptr, size_t nmemb, size_t size)
   {
-    return snmalloc::libc::reallocarr(ptr, nmemb, size);
+    // A zero size leaves the object alone rather than freeing it.
+    bool overflow = false;
+    size_t bytes = bits::umul(size, nmemb, overflow);
+    void* old = *static_cast<void**>(ptr);
+    auto ticket =
+      (overflow || bytes == 0) ? record::NO_TICKET : record::begin();
+    int result = snmalloc::libc::reallocarr(ptr, nmemb, size);
+    record::realloc(
+      ticket, old, bytes, result == 0 ? *static_cast<void**>(ptr) : nullptr);
+    return result;
   }
 #endif
 
   SNMALLOC_EXPORT void*
   SNMALLOC_NAME_MANGLE(memalign)(size_t alignment, size_t size)
   {
-    return snmalloc::libc::memalign(alignment, size);
+    return record::alloc_aligned(
+      snmalloc::libc::memalign(alignment, size), alignment, size);
   }
 
   SNMALLOC_EXPORT void*
   SNMALLOC_NAME_MANGLE(aligned_alloc)(size_t alignment, size_t size)
   {
-    return snmalloc::libc::aligned_alloc(alignment, size);
+    return record::alloc_aligned(
+      snmalloc::libc::aligned_alloc(alignment, size), alignment, size);
   }
 
   SNMALLOC_EXPORT int SNMALLOC_NAME_MANGLE(posix_memalign)(
     void** memptr, size_t alignment, size_t size)
   {
-    return snmalloc::libc::posix_memalign(memptr, alignment, size);
+    int result = snmalloc::libc::posix_memalign(memptr, alignment, size);
+    if (result == 0)
+      record::alloc_aligned(*memptr, alignment, size);
+    return result;
   }
 
 #if !defined(__FreeBSD__) && !defined(__OpenBSD__)
   SNMALLOC_EXPORT void* SNMALLOC_NAME_MANGLE(valloc)(size_t size)
   {
-    return snmalloc::libc::memalign(OS_PAGE_SIZE, size);
+    return record::alloc_aligned(
+      snmalloc::libc::memalign(OS_PAGE_SIZE, size), OS_PAGE_SIZE, size);
   }
 #endif
 
   SNMALLOC_EXPORT void* SNMALLOC_NAME_MANGLE(pvalloc)(size_t size)
   {
-    return snmalloc::libc::memalign(
-      OS_PAGE_SIZE, (size + OS_PAGE_SIZE - 1) & ~(OS_PAGE_SIZE - 1));
+    size = (size + OS_PAGE_SIZE - 1) & ~(OS_PAGE_SIZE - 1);
+    return record::alloc_aligned(
+      snmalloc::libc::memalign(OS_PAGE_SIZE, size), OS_PAGE_SIZE, size);
   }
 
 #if __has_include(<features.h>)
@@ -10,4 +10,30 @@ extern "C"
   {
     return snmalloc::memcpy<true>(dst, src, len);
   }
+
+  /**
+   * Snmalloc checked memmove.
+   */
+  SNMALLOC_EXPORT void*
+  SNMALLOC_NAME_MANGLE(memmove)(void* dst, const void* src, size_t len)
+  {
+    return snmalloc::memmove<true>(dst, src, len);
+  }
+
+  /**
+   * Snmalloc checked memset.
+   */
+  SNMALLOC_EXPORT void*
+  SNMALLOC_NAME_MANGLE(memset)(void* dst, int c, size_t len)
+  {
+    return snmalloc::memset<true>(dst, c, len);
+  }
+
+  /**
+   * Snmalloc checked bzero.
+   */
+  SNMALLOC_EXPORT void SNMALLOC_NAME_MANGLE(bzero)(void* dst, size_t len)
+  {
+    snmalloc::memset<true>(dst, 0, len);
+  }
 }
@@ -0,0 +1,364 @@
+#pragma once
+
+#include "snmalloc/snmalloc.h"
+
+#ifdef SNMALLOC_RECORD_ALLOCS
+#  include <fcntl.h>
+#  include <pthread.h>
+#  include <stdlib.h>
+#  include <unistd.h>
+#endif
+
+/**
+ * Allocation trace recording for the malloc entry points, in shims built
+ * with SNMALLOC_RECORD_ALLOCS.  When the SNMALLOC_RECORD_FILE environment
+ * variable names a file, every call is written to it in the format of
+ * `global/allocrecord.h`, for `perf/replay` to play back.  Otherwise, and in
+ * other shims, these calls do nothing.
+ */
+namespace snmalloc::record
+{
+  /**
+   * A call's place in the trace.  Taken before the call runs for calls that
+   * must be ordered before they return, and after it otherwise.
+   */
+  using Ticket = uint64_t;
+  static constexpr Ticket NO_TICKET = ~Ticket(0);
+
+#ifdef SNMALLOC_RECORD_ALLOCS
+  static constexpr size_t RECORD_CHUNK = 4096;
+
+  /**
+   * One thread's entries not yet written out.  Only the owning thread
+   * writes entries.  `filled` is also the claim on them: the owner and
+   * `Recorder::finish` each move it from a count to `FLUSHING` or `CLOSED`
+   * before writing the entries out, so they are written once.
+   */
+  struct RecordBuffer
+  {
+    static constexpr size_t FLUSHING = RECORD_CHUNK + 1;
+    static constexpr size_t CLOSED = RECORD_CHUNK + 2;
+
+    RecordBuffer* next_buffer{nullptr};
+    stl::Atomic<bool> in_use{true};
+    stl::Atomic<size_t> filled{0};
+    AllocRecordEntry entries[RECORD_CHUNK];
+  };
+
+  /**
+   * Each thread records into a buffer of its own, and appends it to the file
+   * when it is full or the thread exits, reserving its place in the file
+   * once per chunk.  No thread waits for another.  Calls are ordered by a
+   * shared sequence number, one relaxed fetch-add per call: a free and the
+   * allocation that reuses its address on another thread are ordered by the
+   * allocator, and so are their sequence numbers, which a clock such as the
+   * TSC does not guarantee across cores.  The replay sorts by sequence.
+   * Buffers come from the PAL, so recording cannot re-enter the allocator,
+   * and are handed on to new threads rather than freed.
+   *
+   * A forked child stops recording, as it would otherwise write to the
+   * parent's file.
+   */
+  class Recorder
+  {
+    static constexpr size_t CHUNK = RECORD_CHUNK;
+
+    enum State : int
+    {
+      Unopened,
+      Recording,
+      Off,
+    };
+
+    static inline stl::Atomic<RecordBuffer*> buffers{nullptr};
+    static inline stl::Atomic<uint64_t> sequence{0};
+    static inline stl::Atomic<size_t> file_entries{0};
+    static inline stl::Atomic<int> state{Unopened};
+    static inline stl::Atomic<uint32_t> threads{0};
+    static inline FlagWord open_lock{};
+    static inline int fd = -1;
+    static inline pthread_key_t thread_key;
+
+    static RecordBuffer*& current()
+    {
+      static thread_local RecordBuffer* buffer = nullptr;
+      return buffer;
+    }
+
+    static uint32_t thread_id()
+    {
+      static thread_local uint32_t id = 0;
+      if (SNMALLOC_UNLIKELY(id == 0))
+        id = threads.fetch_add(1, stl::memory_order_relaxed) + 1;
+      return id;
+    }
+
+    static void write_at(const void* data, size_t size, size_t offset)
+    {
+      auto* p = static_cast<const char*>(data);
+      while (size != 0)
+      {
+        auto written = ::pwrite(fd, p, size, static_cast<off_t>(offset));
+        if (written <= 0)
+          return;
+        p += written;
+        offset += static_cast<size_t>(written);
+        size -= static_cast<size_t>(written);
+      }
+    }
+
+    /**
+     * Append the first `count` entries of `buffer` to the file.
+     */
+    static void write_entries(RecordBuffer* buffer, size_t count)
+    {
+      size_t index = file_entries.fetch_add(count, stl::memory_order_relaxed);
+      write_at(
+        buffer->entries,
+        count * sizeof(AllocRecordEntry),
+        sizeof(AllocRecordHeader) + index * sizeof(AllocRecordEntry));
+    }
+
+    /**
+     * Called by the owner: write out the `count` entries of `buffer` and
+     * empty it, unless `finish` has claimed them.
+     */
+    static void flush(RecordBuffer* buffer, size_t count)
+    {
+      if (
+        count == 0 || count > CHUNK ||
+        !buffer->filled.compare_exchange_strong(
+          count, RecordBuffer::FLUSHING, stl::memory_order_acquire))
+        return;
+      write_entries(buffer, count);
+      buffer->filled.store(0, stl::memory_order_release);
+    }
+
+    /**
+     * Thread exit: write out this thread's entries and hand its buffer on.
+     */
+    static void release(void* p)
+    {
+      auto* buffer = static_cast<RecordBuffer*>(p);
+      current() = nullptr;
+      if (state.load(stl::memory_order_acquire) == Recording)
+        flush(buffer, buffer->filled.load(stl::memory_order_relaxed));
+      buffer->in_use.store(false, stl::memory_order_release);
+    }
+
+    SNMALLOC_SLOW_PATH static RecordBuffer* acquire()
+    {
+      RecordBuffer* buffer = nullptr;
+      for (auto* b = buffers.load(stl::memory_order_acquire); b != nullptr;
+           b = b->next_buffer)
+      {
+        if (
+          !b->in_use.load(stl::memory_order_relaxed) &&
+          !b->in_use.exchange(true, stl::memory_order_acquire))
+        {
+          buffer = b;
+          break;
+        }
+      }
+
+      if (buffer == nullptr)
+      {
+        size_t size =
+          bits::align_up(sizeof(RecordBuffer), DefaultPal::page_size);
+        void* p = DefaultPal::reserve(size);
+        if (p == nullptr)
+          return nullptr;
+        DefaultPal::notify_using<NoZero>(p, size);
+        buffer = new (p, placement_token) RecordBuffer();
+        auto* head = buffers.load(stl::memory_order_relaxed);
+        do
+          buffer->next_buffer = head;
+        while (!buffers.compare_exchange_weak(
+          head, buffer, stl::memory_order_release, stl::memory_order_relaxed));
+      }
+
+      // Set before registering for thread exit, which may allocate.
+      current() = buffer;
+      pthread_setspecific(thread_key, buffer);
+      return buffer;
+    }
+
+    static void after_fork_child()
+    {
+      state.store(Off, stl::memory_order_release);
+      ::close(fd);
+      fd = -1;
+    }
+
+    SNMALLOC_SLOW_PATH static bool open()
+    {
+      with(open_lock, [&]() {
+        if (state.load(stl::memory_order_relaxed) != Unopened)
+          return;
+
+        const char* path = ::getenv("SNMALLOC_RECORD_FILE");
+        if (path != nullptr)
+          fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0 || pthread_key_create(&thread_key, &release) != 0)
+        {
+          state.store(Off, stl::memory_order_release);
+          return;
+        }
+
+        AllocRecordHeader header;
+        header.entry_size = sizeof(AllocRecordEntry);
+        write_at(&header, sizeof(header), 0);
+        state.store(Recording, stl::memory_order_release);
+      });
+
+      // Registered outside the lock, as it may allocate and so record.
+      static stl::Atomic<bool> fork_handler{false};
+      if (
+        state.load(stl::memory_order_acquire) == Recording &&
+        !fork_handler.exchange(true))
+        pthread_atfork(nullptr, nullptr, &after_fork_child);
+      return state.load(stl::memory_order_acquire) == Recording;
+    }
+
+  public:
+    static Ticket begin()
+    {
+      if (SNMALLOC_UNLIKELY(
+            state.load(stl::memory_order_acquire) != Recording))
+      {
+        if (state.load(stl::memory_order_relaxed) == Off || !open())
+          return NO_TICKET;
+      }
+      return sequence.fetch_add(1, stl::memory_order_relaxed);
+    }
+
+    static void write(
+      Ticket ticket,
+      AllocOp op,
+      size_t size,
+      void* result,
+      void* old,
+      size_t alignment = 0)
+    {
+      if (ticket == NO_TICKET)
+        return;
+
+      auto* buffer = current();
+      if (SNMALLOC_UNLIKELY(buffer == nullptr))
+      {
+        buffer = acquire();
+        if (buffer == nullptr)
+          return;
+      }
+
+      size_t index = buffer->filled.load(stl::memory_order_relaxed);
+      if (index >= CHUNK)
+        return;
+      auto& entry = buffer->entries[index];
+      entry.thread = thread_id();
+      entry.size = size;
+      entry.result = address_cast(result);
+      entry.old = address_cast(old);
+      entry.sequence = ticket;
+      entry.align_bits = static_cast<uint8_t>(
+        alignment == 0 ? 0 : bits::next_pow2_bits(alignment));
+      entry.op = op;
+
+      // Fails only if `finish` has claimed the buffer.
+      if (!buffer->filled.compare_exchange_strong(
+            index, index + 1, stl::memory_order_release))
+        return;
+
+      if (index + 1 == CHUNK)
+        flush(buffer, CHUNK);
+    }
+
+    /**
+     * Write out every thread's remaining entries, and stop recording.  Each
+     * buffer is claimed first, after any flush its owner has under way.
+     * Calls still under way on other threads may be lost.
+     */
+    static void finish()
+    {
+      if (state.exchange(Off) != Recording)
+        return;
+
+      for (auto* b = buffers.load(stl::memory_order_acquire); b != nullptr;
+           b = b->next_buffer)
+      {
+        size_t count = b->filled.load(stl::memory_order_acquire);
+        while (count == RecordBuffer::FLUSHING ||
+               !b->filled.compare_exchange_weak(
+                 count, RecordBuffer::CLOSED, stl::memory_order_acquire))
+        {
+          if (count == RecordBuffer::FLUSHING)
+          {
+            Aal::pause();
+            count = b->filled.load(stl::memory_order_acquire);
+          }
+        }
+        if (count != 0 && count != RecordBuffer::CLOSED)
+          write_entries(b, count);
+      }
+      ::close(fd);
+    }
+  };
+
+  __attribute__((destructor)) inline void finish_recording()
+  {
+    Recorder::finish();
+  }
+
+  inline Ticket begin()
+  {
+    return Recorder::begin();
+  }
+
+  inline void* alloc(void* p, size_t size)
+  {
+    Recorder::write(Recorder::begin(), AllocOp::Malloc, size, p, nullptr);
+    return p;
+  }
+
+  inline void* alloc_aligned(void* p, size_t alignment, size_t size)
+  {
+    Recorder::write(
+      Recorder::begin(), AllocOp::Memalign, size, p, nullptr, alignment);
+    return p;
+  }
+
+  inline void free(void* p)
+  {
+    if (p != nullptr)
+      Recorder::write(Recorder::begin(), AllocOp::Free, 0, nullptr, p);
+  }
+
+  inline void* realloc(Ticket ticket, void* old, size_t size, void* p)
+  {
+    Recorder::write(ticket, AllocOp::Realloc, size, p, old);
+    return p;
+  }
+#else
+  inline Ticket begin()
+  {
+    return NO_TICKET;
+  }
+
+  inline void* alloc(void* p, size_t)
+  {
+    return p;
+  }
+
+  inline void* alloc_aligned(void* p, size_t, size_t)
+  {
+    return p;
+  }
+
+  inline void free(void*) {}
+
+  inline void* realloc(Ticket, void*, size_t, void* p)
+  {
+    return p;
+  }
+#endif
+} // namespace snmalloc::record
@@ -42,10 +42,15 @@ extern "C" SNMALLOC_EXPORT void* SNMALLOC_NAME_MANGLE(rust_realloc)(
     size_to_sizeclass_full(aligned_old_size).raw() ==
     size_to_sizeclass_full(aligned_new_size).raw())
     return ptr;
+  if (
+    (aligned_old_size > MAX_SMALL_SIZECLASS_SIZE) &&
+    (aligned_new_size > MAX_SMALL_SIZECLASS_SIZE) &&
+    resize_in_place(ptr, aligned_new_size))
+    return ptr;
   void* p = alloc(aligned_new_size);
   if (p)
   {
-    memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    libc::realloc_copy(p, ptr, old_size < new_size ? old_size : new_size);
     dealloc(ptr, aligned_old_size);
   }
   return p;
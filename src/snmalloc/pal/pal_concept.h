@@ -102,6 +102,51 @@ namespace snmalloc
                                      } -> ConceptSame<void>;
                                  };
 
+  /**
+   * Some PALs can move pages between address ranges.
+   */
+  template<typename PAL>
+  concept IsPAL_remap = requires(void* vp, size_t sz) {
+                          {
+                            PAL::remap(vp, vp, sz)
+                            } noexcept -> ConceptSame<bool>;
+                        };
+
+  /**
+   * Some PALs back memory with huge pages, and can be asked not to.
+   */
+  template<typename PAL>
+  concept IsPAL_huge_pages =
+    requires(void* vp, size_t sz) {
+      typename stl::integral_constant<size_t, PAL::huge_page_size>;
+      {
+        PAL::notify_no_huge_pages(vp, sz)
+        } noexcept -> ConceptSame<void>;
+    };
+
+  /**
+   * Some PALs can place memory on a particular NUMA node.
+   */
+  template<typename PAL>
+  concept IsPAL_numa = requires(void* vp, size_t sz) {
+                         {
+                           PAL::numa_node()
+                           } noexcept -> ConceptSame<size_t>;
+                         {
+                           PAL::numa_bind(vp, sz, sz)
+                           } noexcept -> ConceptSame<void>;
+                       };
+
+  /**
+   * Some PALs report the CPU the calling thread is running on.
+   */
+  template<typename PAL>
+  concept IsPAL_current_cpu = requires() {
+                                {
+                                  PAL::current_cpu()
+                                  } noexcept -> ConceptSame<size_t>;
+                              };
+
   template<typename PAL>
   concept IsPAL_get_entropy64 = requires() {
                                   {
@@ -124,6 +169,10 @@ namespace snmalloc
     IsPAL_memops<PAL> &&
     (!pal_supports<Entropy, PAL> || IsPAL_get_entropy64<PAL>) &&
     (!pal_supports<LowMemoryNotification, PAL> || IsPAL_mem_low_notify<PAL>) &&
+    (!pal_supports<RemapPages, PAL> || IsPAL_remap<PAL>) &&
+    (!pal_supports<HugePages, PAL> || IsPAL_huge_pages<PAL>) &&
+    (!pal_supports<NumaAware, PAL> || IsPAL_numa<PAL>) &&
+    (!pal_supports<CurrentCpu, PAL> || IsPAL_current_cpu<PAL>) &&
     (pal_supports<NoAllocation, PAL> ||
       ((!pal_supports<AlignedAllocation, PAL> || IsPAL_reserve_aligned<PAL>) &&
         IsPAL_reserve<PAL>));
@@ -64,6 +64,36 @@ namespace snmalloc
      * This Pal provides a way for parking threads at a specific address.
      */
     WaitOnAddress = (1 << 7),
+
+    /**
+     * This Pal can move pages from one committed range to another without
+     * copying them.  A PAL that supports this must expose a `remap()` method
+     * that takes a destination, a source and a size, all page aligned, and
+     * returns a `bool` indicating whether the pages were moved.
+     */
+    RemapPages = (1 << 8),
+
+    /**
+     * This Pal backs the memory it reserves with huge pages.  A PAL that
+     * supports this must expose a `huge_page_size` and a
+     * `notify_no_huge_pages()` method that takes a pointer and size and asks
+     * for that range to use normal pages instead.
+     */
+    HugePages = (1 << 9),
+
+    /**
+     * This Pal knows the NUMA topology.  A PAL that supports this must expose
+     * a `numa_node()` method that returns the node the calling thread is
+     * running on, and a `numa_bind()` method that takes a pointer, size and
+     * node and asks for that range to be placed on the node.
+     */
+    NumaAware = (1 << 10),
+
+    /**
+     * This Pal can cheaply report the CPU the calling thread is running on,
+     * through a `current_cpu()` method.
+     */
+    CurrentCpu = (1 << 11),
   };
 
   /**
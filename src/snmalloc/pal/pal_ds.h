@@ -61,7 +61,8 @@ namespace snmalloc
 
     void (*pal_notify)(PalNotificationObject* self);
 
-    PalNotificationObject(void (*pal_notify)(PalNotificationObject* self))
+    constexpr PalNotificationObject(
+      void (*pal_notify)(PalNotificationObject* self))
     : pal_notify(pal_notify)
     {}
   };
@@ -103,7 +104,7 @@ namespace snmalloc
     template<typename T>
     friend class PalList;
 
-    stl::Atomic<PalTimerObject*> pal_next;
+    stl::Atomic<PalTimerObject*> pal_next{nullptr};
 
     void (*pal_notify)(PalTimerObject* self);
 
@@ -111,7 +112,8 @@ namespace snmalloc
     uint64_t repeat;
 
   public:
-    PalTimerObject(void (*pal_notify)(PalTimerObject* self), uint64_t repeat)
+    constexpr PalTimerObject(
+      void (*pal_notify)(PalTimerObject* self), uint64_t repeat)
     : pal_notify(pal_notify), repeat(repeat)
     {}
   };
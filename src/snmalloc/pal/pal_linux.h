@@ -5,6 +5,7 @@
 #  include "pal_posix.h"
 #  include "snmalloc/stl/array.h"
 
+#  include <sched.h>
 #  include <string.h>
 #  include <sys/mman.h>
 #  include <sys/prctl.h>
@@ -19,29 +20,421 @@
 #    include <linux/futex.h>
 #  endif
 
+#  if defined(SNMALLOC_HAS_RSEQ)
+#    include <sys/rseq.h>
+#  endif
+
+#  ifndef MREMAP_DONTUNMAP
+#    define MREMAP_DONTUNMAP 4
+#  endif
+
 #  include <stdio.h>
 
 namespace snmalloc
 {
   class PALLinux : public PALPOSIX<PALLinux>
   {
+    /**
+     * List of callbacks for low-memory notification
+     */
+    static inline PalNotifier low_memory_callbacks;
+
+    /**
+     * Set once the memory pressure timer has been registered.
+     */
+    static inline stl::AtomicBool registered_for_notifications{false};
+
+    /**
+     * Directory of this process's cgroup v2 hierarchy, or empty if the
+     * process is not in a cgroup v2 hierarchy.
+     */
+    static inline char cgroup_dir[256]{};
+
+    /**
+     * Files that the pressure timer polls, or -1 for those that do not exist.
+     * They are opened once and re-read from the start with `pread`, so each
+     * read is one system call.  Pressure stall information comes from the
+     * cgroup's `memory.pressure`, so that stalls in a neighbouring container
+     * do not count, and from the system-wide file only if the process is in
+     * the root cgroup or the kernel has no per-cgroup pressure.
+     */
+    static inline int pressure_fd = -1;
+    static inline int events_fd = -1;
+    static inline int current_fd = -1;
+    static inline int high_fd = -1;
+    static inline int max_fd = -1;
+
+    /**
+     * The lower of `memory.high` and `memory.max` when they were last read,
+     * or UINT64_MAX if there is no limit.
+     */
+    static inline uint64_t memory_limit = UINT64_MAX;
+
+    /**
+     * Time at which the limits were last read.
+     */
+    static inline uint64_t memory_limit_ms = 0;
+
+    /**
+     * Sum of the `high` and `max` counters in `memory.events` when the
+     * timer last ran.
+     */
+    static inline uint64_t last_memory_events = 0;
+
+    /**
+     * Whether memory was short when the timer last ran.
+     */
+    static inline bool was_short = false;
+
+    /**
+     * Time of the last notification.
+     */
+    static inline uint64_t last_notify_ms = 0;
+
+    /**
+     * Notify if the PSI `some avg10` value, in hundredths of a percent, is at
+     * least this.  That is, if some task was stalled on memory for 10% of the
+     * last ten seconds.
+     */
+    static constexpr uint64_t psi_threshold = 1000;
+
+    /**
+     * How often, in milliseconds, to check for memory pressure.  The check is
+     * run from `time_in_ms`, so only while some thread is allocating, and in
+     * that thread.  Each check reads `memory.events` and the pressure stall
+     * information, and `memory.current` if there is a limit and no stall:
+     * at most three `pread` calls.  The limits are re-read, with two more,
+     * every `memory_limit_refresh_ms`.
+     */
+    static constexpr uint64_t pressure_check_ms = 100;
+
+    /**
+     * How often, in milliseconds, to re-read the cgroup's memory limits.
+     */
+    static constexpr uint64_t memory_limit_refresh_ms = 10000;
+
+    /**
+     * Minimum time, in milliseconds, between notifications.  Each one has
+     * every allocator flush its caches, so a burst of them would only
+     * thrash.
+     */
+    static constexpr uint64_t min_notify_interval_ms = 1000;
+
+    /**
+     * Read a small text file into `buffer` and null terminate it.  This is
+     * used on paths that cannot allocate, so avoids stdio.  Returns false if
+     * the file cannot be read.
+     */
+    template<size_t N>
+    static bool read_text_file(const char* path, char (&buffer)[N])
+    {
+      KeepErrno k;
+      auto fd = open(path, O_RDONLY | O_CLOEXEC);
+      if (fd < 0)
+        return false;
+      auto length = read(fd, buffer, N - 1);
+      close(fd);
+      if (length < 0)
+        return false;
+      buffer[length] = '\0';
+      return true;
+    }
+
+    /**
+     * Re-read one of the polled files into `buffer` and null terminate it.
+     * If the read fails, or the contents do not start with `expected` (or
+     * with a number or `max` if that is null), the application may have
+     * closed the descriptor and reused its number, so stop polling it
+     * without closing it.
+     */
+    template<size_t N>
+    static bool
+    read_polled(int& fd, char (&buffer)[N], const char* expected = nullptr)
+    {
+      if (fd < 0)
+        return false;
+
+      KeepErrno k;
+      auto length = pread(fd, buffer, N - 1, 0);
+      if (length >= 0)
+      {
+        buffer[length] = '\0';
+        bool valid = expected != nullptr ?
+          strncmp(buffer, expected, strlen(expected)) == 0 :
+          (buffer[0] >= '0' && buffer[0] <= '9') ||
+            strncmp(buffer, "max", 3) == 0;
+        if (valid)
+          return true;
+      }
+      fd = -1;
+      return false;
+    }
+
+    /**
+     * Open `file` in the cgroup directory, or return -1.
+     */
+    static int open_cgroup_file(const char* file)
+    {
+      if (cgroup_dir[0] == '\0')
+        return -1;
+
+      char path[sizeof(cgroup_dir) + 32];
+      size_t dir_length = strlen(cgroup_dir);
+      size_t file_length = strlen(file);
+      if (dir_length + file_length + 2 > sizeof(path))
+        return -1;
+      memcpy(path, cgroup_dir, dir_length);
+      path[dir_length] = '/';
+      memcpy(path + dir_length + 1, file, file_length + 1);
+      KeepErrno k;
+      return open(path, O_RDONLY | O_CLOEXEC);
+    }
+
+    /**
+     * Parse a decimal number at the start of `text`.  The cgroup files use
+     * `max` for an unlimited value, which is returned as UINT64_MAX.
+     */
+    static uint64_t parse_number(const char* text, const char** end = nullptr)
+    {
+      if (strncmp(text, "max", 3) == 0)
+      {
+        if (end != nullptr)
+          *end = text + 3;
+        return UINT64_MAX;
+      }
+
+      uint64_t result = 0;
+      while (*text >= '0' && *text <= '9')
+        result = (result * 10) + static_cast<uint64_t>(*text++ - '0');
+      if (end != nullptr)
+        *end = text;
+      return result;
+    }
+
+    /**
+     * Find the line of `text` starting with `key` and parse the number that
+     * follows it.  Returns 0 if there is no such line.
+     */
+    static uint64_t find_number(const char* text, const char* key)
+    {
+      size_t key_length = strlen(key);
+      for (const char* line = text; *line != '\0';)
+      {
+        if (strncmp(line, key, key_length) == 0)
+          return parse_number(line + key_length);
+        line = strchr(line, '\n');
+        if (line == nullptr)
+          break;
+        line++;
+      }
+      return 0;
+    }
+
+    /**
+     * Number of times this cgroup has been throttled or hit its limit.
+     */
+    static uint64_t memory_events()
+    {
+      char buffer[256];
+      if (!read_polled(events_fd, buffer, "low "))
+        return 0;
+      return find_number(buffer, "high ") + find_number(buffer, "max ");
+    }
+
+    /**
+     * Re-read the cgroup's memory limits.
+     */
+    static void read_memory_limit(uint64_t now)
+    {
+      char buffer[32];
+      memory_limit = UINT64_MAX;
+      if (read_polled(high_fd, buffer))
+        memory_limit = bits::min(memory_limit, parse_number(buffer));
+      if (read_polled(max_fd, buffer))
+        memory_limit = bits::min(memory_limit, parse_number(buffer));
+      memory_limit_ms = now;
+    }
+
+    /**
+     * Whether tasks are stalling on memory, or this cgroup is within 1/16th
+     * of the limits as last read.
+     */
+    static bool memory_short()
+    {
+      char buffer[256];
+      if (read_polled(pressure_fd, buffer, "some avg10="))
+      {
+        const char* end;
+        uint64_t stall = parse_number(buffer + 11, &end) * 100;
+        if (*end == '.')
+          stall += parse_number(end + 1) % 100;
+        if (stall >= psi_threshold)
+          return true;
+      }
+
+      if (memory_limit == UINT64_MAX || !read_polled(current_fd, buffer))
+        return false;
+
+      return parse_number(buffer) > memory_limit - (memory_limit / 16);
+    }
+
+    /**
+     * Find the cgroup v2 directory from the `0::/path` line of
+     * `/proc/self/cgroup`.
+     */
+    static void find_cgroup_dir()
+    {
+      static constexpr char prefix[] = "/sys/fs/cgroup";
+      char buffer[sizeof(cgroup_dir)];
+      cgroup_dir[0] = '\0';
+      if (!read_text_file("/proc/self/cgroup", buffer))
+        return;
+
+      for (const char* line = buffer; line != nullptr;)
+      {
+        if (strncmp(line, "0::", 3) == 0)
+        {
+          const char* path = line + 3;
+          size_t length = strcspn(path, "\n");
+          if (sizeof(prefix) + length > sizeof(cgroup_dir))
+            return;
+          memcpy(cgroup_dir, prefix, sizeof(prefix) - 1);
+          memcpy(cgroup_dir + sizeof(prefix) - 1, path, length);
+          cgroup_dir[sizeof(prefix) - 1 + length] = '\0';
+          return;
+        }
+        line = strchr(line, '\n');
+        if (line != nullptr)
+          line++;
+      }
+    }
+
+    /**
+     * (Re)open the polled files for the current `cgroup_dir`, and take the
+     * current state as the one to notify changes from.
+     */
+    static void open_pressure_sources()
+    {
+      int* fds[] = {&pressure_fd, &events_fd, &current_fd, &high_fd, &max_fd};
+      for (auto fd : fds)
+      {
+        if (*fd >= 0)
+          close(*fd);
+      }
+
+      pressure_fd = open_cgroup_file("memory.pressure");
+      if (pressure_fd < 0)
+      {
+        KeepErrno k;
+        pressure_fd = open("/proc/pressure/memory", O_RDONLY | O_CLOEXEC);
+      }
+      events_fd = open_cgroup_file("memory.events");
+      current_fd = open_cgroup_file("memory.current");
+      high_fd = open_cgroup_file("memory.high");
+      max_fd = open_cgroup_file("memory.max");
+
+      read_memory_limit(internal_time_in_ms());
+      last_memory_events = memory_events();
+      was_short = false;
+    }
+
+    /**
+     * Timer callback: notify if the cgroup has hit a limit since the last
+     * check, or if memory has become short.  Memory staying short does not
+     * notify again, as `avg10` stays high for seconds after a single stall.
+     * A notification due within `min_notify_interval_ms` of the last one is
+     * held back, and sent by a later check if it is still due.
+     */
+    static void check_memory_pressure(PalTimerObject*)
+    {
+      uint64_t now = internal_time_in_ms();
+      if (now - memory_limit_ms >= memory_limit_refresh_ms)
+        read_memory_limit(now);
+
+      auto events = memory_events();
+      bool is_short = memory_short();
+      bool due = (events > last_memory_events) || (is_short && !was_short);
+      if (due && (now - last_notify_ms) < min_notify_interval_ms)
+        return;
+
+      last_memory_events = events;
+      was_short = is_short;
+      if (due)
+      {
+        last_notify_ms = now;
+        low_memory_callbacks.notify_all();
+      }
+    }
+
+    static inline PalTimerObject pressure_timer{
+      &check_memory_pressure, pressure_check_ms};
+
+    /**
+     * Reserve `size` bytes aligned to a huge page and ask for them to be
+     * backed by huge pages.  The kernel only uses a huge page for a naturally
+     * aligned range, so over-reserve and trim the ends.
+     */
+    static void* reserve_huge(size_t size) noexcept
+    {
+      if (size > SIZE_MAX - huge_page_size)
+        return nullptr;
+
+      size_t padded = size + huge_page_size - page_size;
+      void* raw = PALPOSIX<PALLinux>::reserve(padded);
+      if (raw == nullptr)
+        return nullptr;
+
+      void* p = pointer_align_up<huge_page_size>(raw);
+      size_t head = pointer_diff(raw, p);
+      if (head != 0)
+        munmap(raw, head);
+      size_t tail = padded - head - size;
+      if (tail != 0)
+        munmap(pointer_offset(p, size), tail);
+
+      KeepErrno k;
+#  ifdef MADV_HUGEPAGE
+      madvise(p, size, MADV_HUGEPAGE);
+#  endif
+      return p;
+    }
+
   public:
     /**
      * Bitmap of PalFeatures flags indicating the optional features that this
      * PAL supports.
      *
-     * We always make sure that linux has entropy support.
+     * We always make sure that linux has entropy support.  Low-memory
+     * notifications are derived from pressure stall information and cgroup
+     * v2 memory accounting.  Pages are moved with `mremap`, and the current
+     * CPU is read from the thread's restartable sequence area.
+     *
+     * Building with SNMALLOC_HUGE_PAGES backs reservations with transparent
+     * huge pages, and building with SNMALLOC_NUMA places memory on the NUMA
+     * node of the thread using it.
      */
     static constexpr uint64_t pal_features = PALPOSIX::pal_features | Entropy |
-      CoreDump
+      CoreDump | LowMemoryNotification | RemapPages | CurrentCpu
 #  ifdef SNMALLOC_HAS_LINUX_FUTEX_H
       | WaitOnAddress
+#  endif
+#  if defined(SNMALLOC_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+      | HugePages
+#  endif
+#  if defined(SNMALLOC_NUMA) && defined(SYS_mbind) && defined(SYS_getcpu)
+      | NumaAware
 #  endif
       ;
 
     static constexpr size_t page_size =
       Aal::aal_name == PowerPC ? 0x10000 : PALPOSIX::page_size;
 
+    /**
+     * Size of a transparent huge page: one page table's worth of pages.
+     */
+    static constexpr size_t huge_page_size =
+      Aal::aal_name == PowerPC ? bits::one_at_bit(24) : bits::one_at_bit(21);
+
     /**
      * Linux requires an explicit no-reserve flag in `mmap` to guarantee lazy
      * commit if /proc/sys/vm/overcommit_memory is set to `heuristic` (0).
@@ -63,9 +456,59 @@ namespace snmalloc
 #  endif
       ;
 
+    /**
+     * Check whether memory is currently short: either tasks are stalling on
+     * memory, or this cgroup is within 1/16th of its `memory.high` or
+     * `memory.max` limit.  This re-reads the limits as well as the polled
+     * files, so should not be on any fast paths.
+     */
+    static bool expensive_low_memory_check()
+    {
+      read_memory_limit(internal_time_in_ms());
+      return memory_short();
+    }
+
+    /**
+     * Register callback object for low-memory notifications.
+     * Client is responsible for allocation, and ensuring the object is live
+     * for the duration of the program.
+     *
+     * Linux has no asynchronous notification that does not require a thread
+     * to wait on it, so pressure is polled from a PAL timer instead.
+     */
+    static void
+    register_for_low_memory_callback(PalNotificationObject* callback)
+    {
+      if (!registered_for_notifications.exchange(true))
+      {
+        find_cgroup_dir();
+        open_pressure_sources();
+        register_timer(&pressure_timer);
+      }
+
+      low_memory_callbacks.register_notification(callback);
+    }
+
+    /**
+     * Override the cgroup directory that memory pressure is read from, the
+     * one containing `memory.pressure`, `memory.events` and friends.  Used
+     * for testing.
+     */
+    static void set_memory_pressure_source(const char* cgroup)
+    {
+      size_t length = bits::min(strlen(cgroup), sizeof(cgroup_dir) - 1);
+      memcpy(cgroup_dir, cgroup, length);
+      cgroup_dir[length] = '\0';
+      open_pressure_sources();
+    }
+
     static void* reserve(size_t size) noexcept
     {
-      void* p = PALPOSIX<PALLinux>::reserve(size);
+      void* p;
+      if constexpr (pal_supports<HugePages, PALLinux>)
+        p = reserve_huge(size);
+      else
+        p = PALPOSIX<PALLinux>::reserve(size);
       if (p)
       {
 #  ifdef SNMALLOC_PAGEID
@@ -143,6 +586,98 @@ namespace snmalloc
       }
     }
 
+    /**
+     * Move the pages backing `size` bytes at `src` to `dst`, replacing the
+     * pages there.  The source stays mapped and reads as zero afterwards, so
+     * the address space remains reserved for the allocator.
+     *
+     * This needs `MREMAP_DONTUNMAP` (Linux 5.7).  Returns false if the pages
+     * could not be moved, in which case neither range has changed and the
+     * caller should copy instead.
+     */
+    static bool remap(void* dst, void* src, size_t size) noexcept
+    {
+      KeepErrno k;
+      SNMALLOC_ASSERT(is_aligned_block<page_size>(dst, size));
+      SNMALLOC_ASSERT(is_aligned_block<page_size>(src, size));
+
+      void* result = mremap(
+        src, size, size, MREMAP_MAYMOVE | MREMAP_FIXED | MREMAP_DONTUNMAP, dst);
+      return result == dst;
+    }
+
+    /**
+     * The CPU the calling thread is running on.  libc registers a restartable
+     * sequence area for each thread (glibc 2.35), which the kernel keeps up
+     * to date with the current CPU, so reading it needs no system call.
+     */
+    static size_t current_cpu() noexcept
+    {
+#  if defined(SNMALLOC_HAS_RSEQ)
+      if (__rseq_size != 0)
+      {
+        auto rs = pointer_offset_signed<volatile struct rseq>(
+          __builtin_thread_pointer(), __rseq_offset);
+        // Negative if registration failed.
+        auto cpu = static_cast<int32_t>(rs->cpu_id);
+        if (cpu >= 0)
+          return static_cast<size_t>(cpu);
+      }
+#  endif
+      KeepErrno k;
+      int cpu = sched_getcpu();
+      return cpu < 0 ? 0 : static_cast<size_t>(cpu);
+    }
+
+#  if defined(SYS_mbind) && defined(SYS_getcpu)
+    /**
+     * The NUMA node of the CPU the calling thread is running on.
+     */
+    static size_t numa_node() noexcept
+    {
+      KeepErrno k;
+      unsigned cpu = 0;
+      unsigned node = 0;
+      if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+        return 0;
+      return node;
+    }
+
+    /**
+     * Prefer `node` for the pages of this range faulted in from now on.  Pages
+     * already present are not moved.  Preferred rather than bound, so that
+     * a full node falls back to the others rather than failing.
+     */
+    static void numa_bind(void* p, size_t size, size_t node) noexcept
+    {
+      KeepErrno k;
+      SNMALLOC_ASSERT(is_aligned_block<page_size>(p, size));
+      if (node >= bits::BITS)
+        return;
+
+      // MPOL_PREFERRED from linux/mempolicy.h.
+      static constexpr int mpol_preferred = 1;
+      unsigned long mask = 1UL << node;
+      // The kernel reads one bit fewer than `maxnode`.
+      syscall(SYS_mbind, p, size, mpol_preferred, &mask, bits::BITS + 1, 0);
+    }
+#  endif
+
+    /**
+     * Back this range with normal pages, even if it was reserved for huge
+     * pages.
+     */
+    static void notify_no_huge_pages(void* p, size_t size) noexcept
+    {
+      KeepErrno k;
+      SNMALLOC_ASSERT(is_aligned_block<page_size>(p, size));
+#  ifdef MADV_NOHUGEPAGE
+      madvise(p, size, MADV_NOHUGEPAGE);
+#  else
+      UNUSED(p, size);
+#  endif
+    }
+
     /**
      * Notify platform that these pages should be included in a core dump.
      */
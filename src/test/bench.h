@@ -0,0 +1,411 @@
+#pragma once
+
+/**
+ * Common harness for the performance tests.
+ *
+ * A benchmark makes one `bench::Harness` from its command line and runs each
+ * of its cases through `Harness::run`, which repeats the case, after some
+ * unmeasured warmup runs, and reports per-operation latency percentiles and
+ * throughput.  The options every benchmark accepts are
+ *
+ *   --warmup N         unmeasured runs of each case before the measured ones
+ *   --repetitions N    measured runs of each case
+ *   --pin CPU          pin the benchmark to CPU, and its workers to the CPUs
+ *                      after it, see `Harness::pin_worker`
+ *   --json FILE        write the results as JSON
+ *   --csv FILE         write the results as CSV
+ *
+ * The defaults keep each benchmark as quick as it was before, for CI; pass
+ * larger counts when measuring.  `snmalloc-bench-compare` compares the
+ * results files of two runs and flags regressions.
+ */
+
+#include "opt.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#  include <sched.h>
+#endif
+
+namespace bench
+{
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Passed to each run of a case.  By default the whole run is timed;
+   * `start` and `stop` narrow that down, and may be used more than once, to
+   * leave out setup and teardown.  A `stop` with no `start` before it times
+   * from the beginning of the run.
+   */
+  class Timer
+  {
+    friend class Harness;
+
+    Clock::time_point started{};
+    Clock::duration total{0};
+    bool used = false;
+    std::mutex lock;
+    std::vector<double> latencies;
+
+  public:
+    void start()
+    {
+      started = Clock::now();
+    }
+
+    void stop()
+    {
+      used = true;
+      total += Clock::now() - started;
+    }
+
+    /**
+     * Replace the measured time with one taken by the benchmark.
+     */
+    void set(Clock::duration time)
+    {
+      used = true;
+      total = time;
+    }
+
+    /**
+     * Record the latency of a single operation.  When a case records these
+     * its percentiles are over them, rather than over the runs' average
+     * per-operation times.  May be called from any thread.
+     */
+    void latency(Clock::duration time)
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      latencies.push_back(
+        static_cast<double>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(time).count()));
+    }
+  };
+
+  struct Result
+  {
+    std::string name;
+    size_t ops = 0;
+    size_t repetitions = 0;
+    double mean_ns = 0;
+    double min_ns = 0;
+    double p50_ns = 0;
+    double p90_ns = 0;
+    double p99_ns = 0;
+    double max_ns = 0;
+    double ops_per_sec = 0;
+  };
+
+  class Harness
+  {
+    std::string benchmark;
+    size_t warmup;
+    size_t reps;
+    long pin_cpu;
+    const char* json_path;
+    const char* csv_path;
+    std::vector<Result> results;
+
+    /**
+     * Nearest-rank percentile of a non-empty sorted sample.
+     */
+    static double percentile(const std::vector<double>& sorted, double p)
+    {
+      auto rank =
+        static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+      return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    static bool pin(long cpu)
+    {
+#ifdef __linux__
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(static_cast<int>(cpu), &set);
+      return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+      (void)cpu;
+      return false;
+#endif
+    }
+
+    void write_json()
+    {
+      FILE* f = fopen(json_path, "w");
+      if (f == nullptr)
+      {
+        perror(json_path);
+        return;
+      }
+
+      fprintf(f, "{\n  \"benchmark\": \"%s\",\n", benchmark.c_str());
+      fprintf(
+        f, "  \"timestamp\": %lld,\n", static_cast<long long>(time(nullptr)));
+      fprintf(
+        f,
+        "  \"config\": {\"check_client\": %s, \"bbq\": %s, \"warmup\": %zu, "
+        "\"repetitions\": %zu, \"pin\": %ld},\n",
+#ifdef SNMALLOC_CHECK_CLIENT
+        "true",
+#else
+        "false",
+#endif
+#ifdef __SNMALLOC_USE_BBQ__
+        "true",
+#else
+        "false",
+#endif
+        warmup,
+        reps,
+        pin_cpu);
+      fprintf(f, "  \"results\": [\n");
+      for (size_t i = 0; i < results.size(); i++)
+      {
+        auto& r = results[i];
+        fprintf(
+          f,
+          "    {\"name\": \"%s\", \"ops\": %zu, \"repetitions\": %zu, "
+          "\"mean_ns\": %.3f, \"min_ns\": %.3f, \"p50_ns\": %.3f, "
+          "\"p90_ns\": %.3f, \"p99_ns\": %.3f, \"max_ns\": %.3f, "
+          "\"ops_per_sec\": %.3f}%s\n",
+          r.name.c_str(),
+          r.ops,
+          r.repetitions,
+          r.mean_ns,
+          r.min_ns,
+          r.p50_ns,
+          r.p90_ns,
+          r.p99_ns,
+          r.max_ns,
+          r.ops_per_sec,
+          i + 1 == results.size() ? "" : ",");
+      }
+      fprintf(f, "  ]\n}\n");
+      fclose(f);
+    }
+
+    void write_csv()
+    {
+      FILE* f = fopen(csv_path, "w");
+      if (f == nullptr)
+      {
+        perror(csv_path);
+        return;
+      }
+
+      fprintf(
+        f,
+        "benchmark,name,ops,repetitions,mean_ns,min_ns,p50_ns,p90_ns,p99_ns,"
+        "max_ns,ops_per_sec\n");
+      for (auto& r : results)
+        fprintf(
+          f,
+          "%s,%s,%zu,%zu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+          benchmark.c_str(),
+          r.name.c_str(),
+          r.ops,
+          r.repetitions,
+          r.mean_ns,
+          r.min_ns,
+          r.p50_ns,
+          r.p90_ns,
+          r.p99_ns,
+          r.max_ns,
+          r.ops_per_sec);
+      fclose(f);
+    }
+
+    /**
+     * Time `runs` runs of a case and report them.
+     */
+    template<typename F>
+    const Result&
+    measure(const std::string& name, size_t ops, size_t runs, F& f)
+    {
+      ops = std::max<size_t>(ops, 1);
+
+      std::vector<double> per_op;
+      std::vector<double> latencies;
+      double total_ns = 0;
+      for (size_t i = 0; i < runs; i++)
+      {
+        Timer t;
+        t.started = Clock::now();
+        f(t);
+        if (!t.used)
+          t.total = Clock::now() - t.started;
+
+        auto ns = static_cast<double>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(t.total)
+            .count());
+        total_ns += ns;
+        per_op.push_back(ns / static_cast<double>(ops));
+        latencies.insert(
+          latencies.end(), t.latencies.begin(), t.latencies.end());
+      }
+
+      auto& samples = latencies.empty() ? per_op : latencies;
+      std::sort(samples.begin(), samples.end());
+
+      Result r;
+      r.name = name;
+      r.ops = ops;
+      r.repetitions = runs;
+      r.mean_ns = total_ns / static_cast<double>(ops * runs);
+      if (!latencies.empty())
+      {
+        double sum = 0;
+        for (auto l : latencies)
+          sum += l;
+        r.mean_ns = sum / static_cast<double>(latencies.size());
+      }
+      r.min_ns = samples.front();
+      r.p50_ns = percentile(samples, 0.5);
+      r.p90_ns = percentile(samples, 0.9);
+      r.p99_ns = percentile(samples, 0.99);
+      r.max_ns = samples.back();
+      r.ops_per_sec = total_ns == 0 ?
+        0 :
+        static_cast<double>(ops * runs) * 1e9 / total_ns;
+      results.push_back(r);
+
+      std::cout << benchmark << "/" << name << ": p50 " << std::setprecision(4)
+                << r.p50_ns << " ns/op, p99 " << r.p99_ns << " ns/op, "
+                << r.ops_per_sec << " op/s" << std::endl;
+      return results.back();
+    }
+
+  public:
+    /**
+     * `default_repetitions` is the number of measured runs of each case
+     * without `--repetitions`.
+     */
+    Harness(
+      const char* benchmark,
+      int argc,
+      const char* const* argv,
+      size_t default_repetitions = 1)
+    : benchmark(benchmark)
+    {
+      opt::Opt opt(argc, argv);
+      warmup = opt.is<size_t>("--warmup", 0);
+      reps = std::max<size_t>(
+        opt.is<size_t>("--repetitions", default_repetitions), 1);
+      pin_cpu = opt.is<long>("--pin", -1);
+      json_path = opt.is("--json", static_cast<const char*>(nullptr));
+      csv_path = opt.is("--csv", static_cast<const char*>(nullptr));
+
+      if (pin_cpu >= 0 && !pin(pin_cpu))
+        std::cerr << "Could not pin to CPU " << pin_cpu << std::endl;
+    }
+
+    ~Harness()
+    {
+      if (json_path != nullptr)
+        write_json();
+      if (csv_path != nullptr)
+        write_csv();
+    }
+
+    Harness(const Harness&) = delete;
+    Harness& operator=(const Harness&) = delete;
+
+    size_t repetitions() const
+    {
+      return reps;
+    }
+
+    /**
+     * With `--pin`, pin the calling thread to the CPU `index` places after
+     * the benchmark's own.  Benchmarks call this at the start of each worker
+     * thread; without it workers share the benchmark's CPU.
+     */
+    void pin_worker(size_t index)
+    {
+      if (pin_cpu < 0)
+        return;
+      size_t cpus = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+      pin(static_cast<long>((static_cast<size_t>(pin_cpu) + index) % cpus));
+    }
+
+    /**
+     * Run the case `name`, which performs `ops` operations each time it is
+     * called with a `Timer&`, and report it.
+     */
+    template<typename F>
+    const Result& run(const std::string& name, size_t ops, F&& f)
+    {
+      for (size_t i = 0; i < warmup; i++)
+      {
+        Timer t;
+        f(t);
+      }
+      return measure(name, ops, reps, f);
+    }
+
+    /**
+     * Run the case `name` once, with no warmup, and report it.  A case whose
+     * first run leaves state behind for later runs to reuse calls this before
+     * `run`, so that the first run is reported apart from the others.
+     */
+    template<typename F>
+    const Result& run_once(const std::string& name, size_t ops, F&& f)
+    {
+      return measure(name, ops, 1, f);
+    }
+
+    /**
+     * Run `f(index)` on `threads` threads, pinned with `pin_worker`, and
+     * return the time from when they are all ready until the last finishes.
+     */
+    template<typename F>
+    Clock::duration parallel(size_t threads, F&& f)
+    {
+      std::mutex lock;
+      size_t ready = 0;
+      size_t done = 0;
+      Clock::time_point begin;
+      Clock::time_point end;
+      std::atomic<bool> go{false};
+
+      std::vector<std::thread> workers;
+      for (size_t i = 0; i < threads; i++)
+      {
+        workers.emplace_back([&, i]() {
+          pin_worker(i);
+          {
+            std::lock_guard<std::mutex> guard(lock);
+            if (++ready == threads)
+            {
+              begin = Clock::now();
+              go = true;
+            }
+          }
+          while (!go)
+            std::this_thread::yield();
+
+          f(i);
+
+          std::lock_guard<std::mutex> guard(lock);
+          if (++done == threads)
+            end = Clock::now();
+        });
+      }
+      for (auto& w : workers)
+        w.join();
+      return end - begin;
+    }
+  };
+} // namespace bench
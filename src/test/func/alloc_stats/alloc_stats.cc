@@ -0,0 +1,78 @@
+/**
+ * Checks the allocation statistics: per-sizeclass counts, large allocations,
+ * slabs, and remote frees flowing from one thread back to the owner.
+ */
+
+#ifndef SNMALLOC_STATS
+#  define SNMALLOC_STATS
+#endif
+// Remote frees need each thread to have an allocator of its own.
+#ifdef SNMALLOC_PER_CPU_ALLOC
+#  undef SNMALLOC_PER_CPU_ALLOC
+#endif
+
+#include <iostream>
+#include <snmalloc/snmalloc.h>
+#include <test/setup.h>
+#include <thread>
+#include <vector>
+
+using namespace snmalloc;
+
+static constexpr size_t small_size = 48;
+static constexpr size_t large_size = 4 * MAX_SMALL_SIZECLASS_SIZE;
+static constexpr size_t count = 1000;
+
+int main()
+{
+  setup();
+
+  smallsizeclass_t sc = size_to_sizeclass(small_size);
+
+  AllocStatsSnapshot before;
+  get_stats(before);
+
+  std::vector<void*> objects;
+  for (size_t i = 0; i < count; i++)
+    objects.push_back(snmalloc::alloc(small_size));
+  void* large = snmalloc::alloc(large_size);
+
+  AllocStatsSnapshot during;
+  get_stats(during);
+  SNMALLOC_CHECK(during.small[sc].allocs - before.small[sc].allocs == count);
+  SNMALLOC_CHECK(during.live_objects(sc) - before.live_objects(sc) == count);
+  SNMALLOC_CHECK(during.live_slabs(sc) > before.live_slabs(sc));
+  SNMALLOC_CHECK(during.large_allocs - before.large_allocs == 1);
+  SNMALLOC_CHECK(during.large_bytes() - before.large_bytes() >= large_size);
+  SNMALLOC_CHECK(during.committed_bytes >= during.slab_bytes());
+
+  // Free half locally and half from another thread.
+  for (size_t i = 0; i < count / 2; i++)
+    snmalloc::dealloc(objects[i]);
+  std::thread remote([&objects, large]() {
+    for (size_t i = count / 2; i < count; i++)
+      snmalloc::dealloc(objects[i]);
+    snmalloc::dealloc(large);
+  });
+  remote.join();
+
+  // Flushing processes the remote frees and returns the empty slabs.
+  snmalloc::debug_teardown();
+
+  AllocStatsSnapshot after;
+  get_stats(after);
+  SNMALLOC_CHECK(after.small[sc].deallocs - before.small[sc].deallocs == count);
+  SNMALLOC_CHECK(after.live_objects(sc) == before.live_objects(sc));
+  SNMALLOC_CHECK(after.large_deallocs - before.large_deallocs == 1);
+  SNMALLOC_CHECK(after.large_bytes() == before.large_bytes());
+  SNMALLOC_CHECK(
+    after.remote_deallocs - before.remote_deallocs == count - count / 2 + 1);
+  SNMALLOC_CHECK(after.remote_bytes_in_flight() == 0);
+  SNMALLOC_CHECK(after.live_slabs(sc) <= before.live_slabs(sc) + 1);
+
+  std::cout << "committed " << after.committed_bytes << " peak "
+            << after.peak_committed_bytes << " retained "
+            << after.retained_bytes() << std::endl;
+  std::cout << "alloc_stats passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,66 @@
+/**
+ * Checks that memory cached by an allocator stays committed while it is being
+ * reused, and is decommitted once it has gone unused for a decay period.
+ */
+
+// Consecutive calls must reach the same allocator and cache.
+#ifdef SNMALLOC_PER_CPU_ALLOC
+#  undef SNMALLOC_PER_CPU_ALLOC
+#endif
+
+#include <iostream>
+#include <snmalloc/snmalloc.h>
+#include <test/setup.h>
+
+using namespace snmalloc;
+
+static constexpr size_t size = bits::one_at_bit(19);
+static constexpr uint64_t period = 1000;
+
+static size_t usage()
+{
+  return Config::Backend::get_current_usage();
+}
+
+int main()
+{
+  setup();
+
+  void* kept = snmalloc::alloc(size);
+  void* freed[2] = {snmalloc::alloc(size), snmalloc::alloc(size)};
+  snmalloc::dealloc(freed[0]);
+  snmalloc::dealloc(freed[1]);
+
+  // Nothing below queries the clock, so only these calls decay the cache.
+  // Start well after any decay the allocations above may have triggered.
+  auto& state = ThreadAlloc::with(
+    [](auto& a) -> auto& { return a.get_backend_local_state(); });
+  uint64_t now = DefaultPal::time_in_ms() + 100 * period;
+  auto cached = usage();
+
+  // The first decay starts the cache ageing, but keeps it committed.
+  Config::Backend::decay_cached_memory(state, now, period);
+  SNMALLOC_CHECK(usage() == cached);
+  Config::Backend::decay_cached_memory(state, now + period / 2, period);
+  SNMALLOC_CHECK(usage() == cached);
+
+  // Reuse some of it, which must not commit more memory.
+  void* reused = snmalloc::alloc(size);
+  SNMALLOC_CHECK(usage() == cached);
+  snmalloc::dealloc(reused);
+
+  // The memory not reused is decommitted a period later.
+  Config::Backend::decay_cached_memory(state, now + period, period);
+  auto decayed = usage();
+  std::cout << "Decayed " << cached - decayed << " bytes" << std::endl;
+  SNMALLOC_CHECK(decayed + size <= cached);
+
+  // And the reused memory a period after that.
+  Config::Backend::decay_cached_memory(state, now + 2 * period, period);
+  std::cout << "Decayed " << decayed - usage() << " bytes" << std::endl;
+  SNMALLOC_CHECK(usage() + size <= decayed);
+
+  snmalloc::dealloc(kept);
+  std::cout << "decay passed" << std::endl;
+  return 0;
+}
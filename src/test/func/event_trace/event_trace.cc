@@ -0,0 +1,194 @@
+/**
+ * Checks the binary event trace: that the slow-path events of a workload
+ * that allocates on one thread and frees on another all appear, with posts
+ * naming the allocator that later drains them, and that events overwritten
+ * in a full ring are counted as dropped rather than lost silently.
+ */
+
+#ifndef SNMALLOC_EVENT_TRACE
+#  define SNMALLOC_EVENT_TRACE
+#endif
+#ifndef SNMALLOC_EVENT_TRACE_RECORDS
+#  define SNMALLOC_EVENT_TRACE_RECORDS 64
+#endif
+// Posts need each thread to have an allocator of its own.
+#ifdef SNMALLOC_PER_CPU_ALLOC
+#  undef SNMALLOC_PER_CPU_ALLOC
+#endif
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <snmalloc/snmalloc.h>
+#include <test/setup.h>
+#include <thread>
+#include <vector>
+
+using namespace snmalloc;
+
+static constexpr size_t small_size = 48;
+static constexpr size_t small_count = 10000;
+static constexpr size_t large_size = bits::one_at_bit(20);
+
+struct Trace
+{
+  size_t flushes = 0;
+  size_t counts[TRACE_EVENT_COUNT]{};
+  std::set<uint64_t> post_targets;
+  std::set<uint64_t> drained;
+  std::map<uint64_t, size_t> records;
+  std::map<uint64_t, size_t> dropped;
+  std::map<uint64_t, uint64_t> last_tick;
+
+  void flush(const TraceFlushHeader&)
+  {
+    flushes++;
+  }
+
+  void ring(const TraceRingHeader& h)
+  {
+    dropped[h.owner] += h.dropped;
+    records[h.owner] += h.records;
+  }
+
+  void record(const TraceRingHeader& h, const TraceRecord& r)
+  {
+    auto event = static_cast<size_t>(r.event);
+    SNMALLOC_CHECK(event != 0 && event < TRACE_EVENT_COUNT);
+    counts[event]++;
+
+    // Each ring is written by one thread, so its ticks do not go back.
+    SNMALLOC_CHECK(r.timestamp >= last_tick[h.owner]);
+    last_tick[h.owner] = r.timestamp;
+
+    switch (r.event)
+    {
+      case TraceEvent::Post:
+        post_targets.insert(r.target);
+        break;
+      case TraceEvent::Drain:
+        SNMALLOC_CHECK(r.count != 0);
+        drained.insert(h.owner);
+        break;
+      case TraceEvent::AllocChunk:
+      case TraceEvent::ChunkRelease:
+        SNMALLOC_CHECK(r.bytes >= large_size);
+        break;
+      default:
+        break;
+    }
+  }
+
+  size_t count(TraceEvent e)
+  {
+    return counts[static_cast<size_t>(e)];
+  }
+};
+
+/**
+ * Flush into a static buffer, so that flushing does not itself allocate and
+ * add events, and decode the result.
+ */
+static Trace flush()
+{
+  static char data[bits::one_at_bit(20)];
+  size_t size = 0;
+  trace_flush([&](const void* p, size_t len) {
+    SNMALLOC_CHECK(size + len <= sizeof(data));
+    memcpy(data + size, p, len);
+    size += len;
+  });
+
+  Trace trace;
+  SNMALLOC_CHECK(trace_decode(data, size, trace));
+  SNMALLOC_CHECK(trace.flushes == 1);
+  return trace;
+}
+
+static void test_remote()
+{
+  // Start from an empty trace.
+  flush();
+
+  std::vector<void*> objects;
+  objects.reserve(small_count);
+  for (size_t i = 0; i < small_count; i++)
+    objects.push_back(snmalloc::alloc(small_size));
+  void* large = snmalloc::alloc(large_size);
+
+  std::thread remote([&]() {
+    for (auto* p : objects)
+      snmalloc::dealloc(p);
+    snmalloc::dealloc(large);
+    ThreadAlloc::with([](Alloc& a) { a.flush(); });
+  });
+  remote.join();
+
+  // Allocate until the remote frees have been drained.
+  for (size_t i = 0; i < 100; i++)
+    snmalloc::dealloc(snmalloc::alloc(small_size));
+  ThreadAlloc::with([](Alloc& a) { a.flush(); });
+
+  Trace trace = flush();
+  for (size_t i = 1; i < TRACE_EVENT_COUNT; i++)
+    std::cout << trace_event_name(static_cast<TraceEvent>(i)) << ": "
+              << trace.counts[i] << std::endl;
+
+  SNMALLOC_CHECK(trace.count(TraceEvent::Refill) != 0);
+  SNMALLOC_CHECK(trace.count(TraceEvent::SlabRelease) != 0);
+  SNMALLOC_CHECK(trace.count(TraceEvent::AllocChunk) != 0);
+  SNMALLOC_CHECK(trace.count(TraceEvent::ChunkRelease) != 0);
+  SNMALLOC_CHECK(trace.count(TraceEvent::Post) != 0);
+  SNMALLOC_CHECK(trace.count(TraceEvent::Drain) != 0);
+
+  // The frees were posted to the allocator that drained them.
+  bool matched = false;
+  for (auto owner : trace.drained)
+    matched |= trace.post_targets.count(owner) != 0;
+  SNMALLOC_CHECK(matched);
+}
+
+static void test_dropped()
+{
+  flush();
+
+  // Two events for each large allocation, far more than a ring holds.
+  static constexpr size_t rounds = 500;
+  for (size_t i = 0; i < rounds; i++)
+    snmalloc::dealloc(snmalloc::alloc(large_size));
+
+  Trace trace = flush();
+  uint64_t busiest = 0;
+  size_t most = 0;
+  for (auto [owner, dropped] : trace.dropped)
+  {
+    if (dropped > most)
+    {
+      busiest = owner;
+      most = dropped;
+    }
+  }
+
+  size_t records = trace.records[busiest];
+  size_t dropped = trace.dropped[busiest];
+  std::cout << records << " events kept, " << dropped << " dropped"
+            << std::endl;
+  SNMALLOC_CHECK(records <= SNMALLOC_EVENT_TRACE_RECORDS);
+  SNMALLOC_CHECK(records + dropped >= 2 * rounds);
+
+  // Nothing happened since, so the next flush has nothing to report.
+  trace = flush();
+  SNMALLOC_CHECK(trace.records[busiest] == 0);
+  SNMALLOC_CHECK(trace.dropped[busiest] == 0);
+}
+
+int main()
+{
+  setup();
+
+  test_remote();
+  test_dropped();
+
+  std::cout << "event_trace passed" << std::endl;
+  return 0;
+}
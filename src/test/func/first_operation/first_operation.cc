@@ -5,6 +5,11 @@
  * operation.
  */
 
+// Per-CPU allocators are not initialised or torn down per thread.
+#ifdef SNMALLOC_PER_CPU_ALLOC
+#  undef SNMALLOC_PER_CPU_ALLOC
+#endif
+
 #include "test/setup.h"
 
 #include <iostream>
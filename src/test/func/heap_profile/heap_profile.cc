@@ -0,0 +1,150 @@
+/**
+ * Checks the sampling heap profiler: that the samples of live objects scale
+ * back up to roughly what was allocated, that large and small objects are
+ * sampled, and that freeing sampled objects, locally, remotely, sized or in a
+ * batch, removes their samples from the profile.
+ */
+
+// Remote frees must reach the allocator that this thread flushes.
+#ifdef SNMALLOC_PER_CPU_ALLOC
+#  undef SNMALLOC_PER_CPU_ALLOC
+#endif
+
+#ifndef SNMALLOC_HEAP_PROFILE
+#  define SNMALLOC_HEAP_PROFILE
+#endif
+
+#include <iostream>
+#include <snmalloc/snmalloc.h>
+#include <stdlib.h>
+#include <string>
+#include <test/setup.h>
+#include <thread>
+#include <vector>
+
+using namespace snmalloc;
+
+static constexpr size_t interval = 4096;
+static constexpr size_t small_size = 64;
+static constexpr size_t small_count = 20000;
+static constexpr size_t large_size = bits::one_at_bit(20);
+static constexpr size_t large_count = 50;
+
+struct Profile
+{
+  size_t objects = 0;
+  size_t bytes = 0;
+  size_t lines = 0;
+  size_t small_lines = 0;
+  size_t large_lines = 0;
+};
+
+static Profile dump()
+{
+  std::string text;
+  heap_profile_dump(
+    [&](const char* data, size_t len) { text.append(data, len); });
+
+  Profile result;
+  std::string header = "heap profile: ";
+  SNMALLOC_CHECK(text.compare(0, header.size(), header) == 0);
+  SNMALLOC_CHECK(
+    text.find("@ heap_v2/" + std::to_string(interval) + "\n") !=
+    std::string::npos);
+  const char* cursor = text.c_str() + header.size();
+  char* end;
+  result.objects = strtoull(cursor, &end, 10);
+  result.bytes = strtoull(end + 1, nullptr, 10);
+
+  size_t pos = text.find('\n') + 1;
+  while (pos < text.size())
+  {
+    size_t next = text.find('\n', pos);
+    std::string line = text.substr(pos, next - pos);
+    pos = next + 1;
+
+    SNMALLOC_CHECK(line.compare(0, 3, "1: ") == 0);
+    SNMALLOC_CHECK(line.find(" @ 0x") != std::string::npos);
+    size_t size = strtoull(line.c_str() + 3, nullptr, 10);
+    result.lines++;
+    if (size == small_size)
+      result.small_lines++;
+    if (size == large_size)
+      result.large_lines++;
+  }
+
+  SNMALLOC_CHECK(result.lines == result.objects);
+  return result;
+}
+
+SNMALLOC_SLOW_PATH static void allocate(std::vector<void*>& objects)
+{
+  for (size_t i = 0; i < small_count; i++)
+    objects.push_back(snmalloc::alloc(small_size));
+}
+
+int main()
+{
+  setup();
+
+  std::vector<void*> small;
+  std::vector<void*> large;
+  small.reserve(small_count);
+  large.reserve(large_count);
+
+  heap_profile_start(interval);
+  allocate(small);
+  for (size_t i = 0; i < large_count; i++)
+    large.push_back(snmalloc::alloc(large_size));
+  heap_profile_stop();
+
+  Profile profile = dump();
+  std::cout << profile.small_lines << " of " << small_count
+            << " small objects sampled" << std::endl;
+
+  // Each small object is sampled with probability about size / interval.
+  size_t expected = small_count * small_size / interval;
+  SNMALLOC_CHECK(profile.small_lines > expected / 2);
+  SNMALLOC_CHECK(profile.small_lines < expected * 2);
+
+  // Every large object spans many intervals.
+  SNMALLOC_CHECK(profile.large_lines == large_count);
+
+  // Sampled objects are usable as the size asked for.
+  for (auto* p : small)
+  {
+    SNMALLOC_CHECK(snmalloc::alloc_size(p) >= small_size);
+    memset(p, 0xa5, small_size);
+  }
+
+  // Free a quarter of the small objects on another thread, a quarter sized,
+  // and the rest in a batch.
+  size_t quarter = small_count / 4;
+  std::thread remote([&]() {
+    for (size_t i = 0; i < quarter; i++)
+      snmalloc::dealloc(small[i]);
+  });
+  remote.join();
+  for (size_t i = quarter; i < 2 * quarter; i++)
+    snmalloc::dealloc(small[i], small_size);
+  snmalloc::dealloc_batch(&small[2 * quarter], small_count - 2 * quarter);
+
+  // Remote frees are returned to this thread's allocator when it next
+  // handles its message queue.
+  for (size_t i = 0; i < 100; i++)
+    snmalloc::dealloc(snmalloc::alloc(small_size));
+  ThreadAlloc::with([](Alloc& a) { a.flush(); });
+
+  profile = dump();
+  SNMALLOC_CHECK(profile.small_lines == 0);
+  SNMALLOC_CHECK(profile.large_lines == large_count);
+
+  for (auto* p : large)
+    snmalloc::dealloc(p);
+  profile = dump();
+  SNMALLOC_CHECK(profile.objects == 0);
+
+  snmalloc::debug_check_empty();
+  std::cout << "heap_profile passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * Checks that reused slab metadata is not taken for sampled: a small slab
+ * that gets the metadata of a freed, sampled large allocation, after it has
+ * been used for and dirtied as other metadata, has no heap profile sample,
+ * and a sized deallocation with the wrong size is still reported.
+ */
+
+// Slab metadata must come back from the range it was freed to.
+#ifdef SNMALLOC_PER_CPU_ALLOC
+#  undef SNMALLOC_PER_CPU_ALLOC
+#endif
+
+#ifndef SNMALLOC_HEAP_PROFILE
+#  define SNMALLOC_HEAP_PROFILE
+#endif
+
+#include <iostream>
+#include <snmalloc/snmalloc.h>
+#include <string.h>
+#include <test/setup.h>
+#include <vector>
+
+#ifndef _WIN32
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+
+using namespace snmalloc;
+
+#ifndef _WIN32
+/**
+ * Whether `check_size(p, size)` reports an error.  A failed check traps or
+ * aborts, so it is made in a child process.
+ */
+static bool check_fires(void* p, size_t size)
+{
+  auto pid = fork();
+  if (pid == 0)
+  {
+    check_size(p, size);
+    _exit(0);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  return !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+#endif
+
+static auto* metadata(void* p)
+{
+  return Config::Backend::get_metaentry(address_cast(p)).get_slab_metadata();
+}
+
+int main()
+{
+  setup();
+
+  static constexpr size_t large_size = bits::one_at_bit(20);
+  static constexpr size_t small_size = MAX_SMALL_SIZECLASS_SIZE;
+
+  // Allocators notice profiling has started within a few allocations, and
+  // then sample every large allocation, as it spans many intervals.
+  heap_profile_start(4096);
+  std::vector<void*> unsampled;
+  void* large = nullptr;
+  for (size_t i = 0; i < 16 && large == nullptr; i++)
+  {
+    void* p = snmalloc::alloc(large_size);
+    if (metadata(p)->heap_sample() != nullptr)
+      large = p;
+    else
+      unsampled.push_back(p);
+  }
+  heap_profile_stop();
+  SNMALLOC_CHECK(large != nullptr);
+  for (auto* p : unsampled)
+    snmalloc::dealloc(p);
+  auto* meta = metadata(large);
+  snmalloc::dealloc(large);
+
+  // The metadata range also takes back other metadata, such as message
+  // queue segments, which leave their contents behind.  Reuse the freed
+  // slab metadata as such, dirty it, and give it back.
+  auto& local_state = ThreadAlloc::with(
+    [](auto& a) -> auto& { return a.get_backend_local_state(); });
+  size_t meta_size = bits::next_pow2(sizeof(*meta));
+  std::vector<capptr::Alloc<void>> segments;
+  bool dirtied = false;
+  for (size_t i = 0; i < 256 && !dirtied; i++)
+  {
+    auto segment =
+      Config::Backend::alloc_meta_data<void>(&local_state, meta_size);
+    memset(segment.unsafe_ptr(), 0xa5, meta_size);
+    dirtied = segment.unsafe_ptr() == meta;
+    segments.push_back(segment);
+  }
+  SNMALLOC_CHECK(dirtied);
+  for (auto segment : segments)
+    Config::Backend::dealloc_meta_data(local_state, segment, meta_size);
+
+  // New slabs take their metadata from where the large one went.
+  std::vector<void*> small;
+  void* reused = nullptr;
+  for (size_t i = 0; i < 10000 && reused == nullptr; i++)
+  {
+    void* p = snmalloc::alloc(small_size);
+    small.push_back(p);
+    if (metadata(p) == meta)
+      reused = p;
+  }
+  SNMALLOC_CHECK(reused != nullptr);
+
+  SNMALLOC_CHECK(metadata(reused)->heap_sample() == nullptr);
+  if constexpr (mitigations(sanity_checks))
+  {
+    check_size(reused, small_size);
+#ifndef _WIN32
+    SNMALLOC_CHECK(check_fires(reused, small_size / 4));
+#endif
+  }
+
+  for (auto* p : small)
+    snmalloc::dealloc(p);
+
+  snmalloc::debug_check_empty();
+  std::cout << "heap_profile_reuse passed" << std::endl;
+  return 0;
+}
@@ -1,3 +1,8 @@
+// Purging must reach the allocator that cached the memory.
+#ifdef SNMALLOC_PER_CPU_ALLOC
+#  undef SNMALLOC_PER_CPU_ALLOC
+#endif
+
 #include <functional>
 #include <limits.h>
 #include <stdio.h>
@@ -211,6 +216,32 @@ namespace
     test_sizes_and_alignments(test);
   }
 
+  /**
+   * Test that xallocx and rallocx resize large objects in place and that
+   * rallocx honours the no-move flag.
+   */
+  void test_resize_in_place()
+  {
+    START_TEST("xallocx and rallocx resize large objects in place.");
+    size_t large = 1024 * 1024;
+    char* ptr = static_cast<char*>(our_mallocx(large, 0));
+    size_t sz = our_xallocx(ptr, large / 4, 0, 0);
+    EXPECT(sz == large / 4, "xallocx shrank to {}, expected {}", sz, large / 4);
+    // The tail is now free next to the object, so it can grow back.
+    sz = our_xallocx(ptr, large / 2, large / 2, MALLOCX_ZERO);
+    EXPECT(sz == large, "xallocx grew to {}, expected {}", sz, large);
+    EXPECT(ptr[large - 1] == 0, "Grown memory not zero initialised");
+    void* p = our_rallocx(ptr, large / 2, ALLOCM_NO_MOVE);
+    EXPECT(p == ptr, "rallocx moved a shrinking object");
+
+    void* small = our_mallocx(16, 0);
+    EXPECT(
+      our_rallocx(small, 4096, ALLOCM_NO_MOVE) == nullptr,
+      "rallocx moved an object despite the no-move flag");
+    our_dallocx(small, 0);
+    our_dallocx(ptr, 0);
+  }
+
   template<
     int(Allocm)(void**, size_t*, size_t, int),
     int(Sallocm)(const void*, size_t*, int),
@@ -302,6 +333,141 @@ namespace
     test_nallocm_size<Allocm, Sallocm, Dallocm, Nallocm>();
     test_rallocm_nomove<Allocm, Rallocm, Dallocm>();
   }
+
+  void test_mallctl()
+  {
+    START_TEST("mallctl");
+    size_t len;
+
+    const char* version = nullptr;
+    len = sizeof(version);
+    EXPECT(
+      our_mallctl("version", &version, &len, nullptr, 0) == 0,
+      "Failed to read version");
+    EXPECT(version != nullptr, "No version string");
+
+    unsigned nbins = 0;
+    len = sizeof(nbins);
+    EXPECT(
+      our_mallctl("arenas.nbins", &nbins, &len, nullptr, 0) == 0,
+      "Failed to read arenas.nbins");
+    EXPECT(nbins == NUM_SMALL_SIZECLASSES, "Wrong bin count {}", nbins);
+
+    // Look the bin sizes up through a MIB, as jemalloc's examples do.
+    size_t mib[4];
+    size_t miblen = 4;
+    EXPECT(
+      our_mallctlnametomib("arenas.bin.0.size", mib, &miblen) == 0,
+      "Failed to translate arenas.bin.0.size");
+    EXPECT(miblen == 4, "Wrong MIB length {}", miblen);
+    for (size_t i = 0; i < nbins; i++)
+    {
+      size_t size = 0;
+      len = sizeof(size);
+      mib[2] = i;
+      EXPECT(
+        our_mallctlbymib(mib, miblen, &size, &len, nullptr, 0) == 0,
+        "Failed to read size of bin {}",
+        i);
+      EXPECT(size == sizeclass_to_size(i), "Wrong size for bin {}", i);
+    }
+    mib[2] = nbins;
+    EXPECT(
+      our_mallctlbymib(mib, miblen, nullptr, nullptr, nullptr, 0) == ENOENT,
+      "Read past the last bin");
+
+    // Refresh the statistics and read them back.
+    uint64_t epoch = 1;
+    len = sizeof(epoch);
+    EXPECT(
+      our_mallctl("epoch", &epoch, &len, &epoch, sizeof(epoch)) == 0,
+      "Failed to refresh epoch");
+    size_t resident = 0;
+    len = sizeof(resident);
+    EXPECT(
+      our_mallctl("stats.resident", &resident, &len, nullptr, 0) == 0,
+      "Failed to read stats.resident");
+    EXPECT(resident != 0, "Nothing resident");
+
+    bool stats = false;
+    len = sizeof(stats);
+    EXPECT(
+      our_mallctl("config.stats", &stats, &len, nullptr, 0) == 0,
+      "Failed to read config.stats");
+    size_t allocated = 0;
+    len = sizeof(allocated);
+    EXPECT(
+      our_mallctl("stats.allocated", &allocated, &len, nullptr, 0) ==
+        (stats ? 0 : ENOENT),
+      "Unexpected result reading stats.allocated");
+    uint64_t nmalloc = 0;
+    len = sizeof(nmalloc);
+    EXPECT(
+      our_mallctl(
+        "stats.arenas.4096.bins.0.nmalloc", &nmalloc, &len, nullptr, 0) ==
+        (stats ? 0 : ENOENT),
+      "Unexpected result reading bin statistics");
+
+    bool prof = false;
+    len = sizeof(prof);
+    EXPECT(
+      our_mallctl("config.prof", &prof, &len, nullptr, 0) == 0,
+      "Failed to read config.prof");
+    bool active = true;
+    len = sizeof(active);
+    EXPECT(
+      our_mallctl("prof.active", &active, &len, nullptr, 0) ==
+        (prof ? 0 : ENOENT),
+      "Unexpected result reading prof.active");
+    EXPECT(!prof || !active, "Profiling active without being started");
+    const char* filename = nullptr;
+    EXPECT(
+      our_mallctl(
+        "prof.dump", nullptr, nullptr, &filename, sizeof(filename)) ==
+        (prof ? EINVAL : ENOENT),
+      "Dumped a profile without a file name");
+
+    EXPECT(
+      our_mallctl("thread.tcache.flush", nullptr, nullptr, nullptr, 0) == 0,
+      "Failed to flush");
+    EXPECT(
+      our_mallctl("arena.0.purge", nullptr, nullptr, nullptr, 0) == 0,
+      "Failed to purge");
+
+    // Purging also decommits what the backend caches for this thread.
+    size_t cached = bits::one_at_bit(19);
+    void* kept = our_malloc(cached);
+    our_free(our_malloc(cached));
+    auto before = Config::Backend::get_current_usage();
+    EXPECT(
+      our_mallctl("arena.0.purge", nullptr, nullptr, nullptr, 0) == 0,
+      "Failed to purge");
+    auto after = Config::Backend::get_current_usage();
+    EXPECT(
+      before >= after + cached,
+      "Purge left {} bytes committed of {}",
+      after,
+      before);
+    our_free(kept);
+
+    // Errors.
+    EXPECT(
+      our_mallctl("arena.1.purge", nullptr, nullptr, nullptr, 0) == ENOENT,
+      "Purged a missing arena");
+    EXPECT(
+      our_mallctl("no.such.name", nullptr, nullptr, nullptr, 0) == ENOENT,
+      "Found a missing name");
+    EXPECT(
+      our_mallctl("stats", nullptr, nullptr, nullptr, 0) == ENOENT,
+      "Read an interior node");
+    len = 1;
+    EXPECT(
+      our_mallctl("arenas.page", &resident, &len, nullptr, 0) == EINVAL,
+      "Read with the wrong length");
+    EXPECT(
+      our_mallctl("arenas.page", nullptr, nullptr, &resident, len) == EPERM,
+      "Wrote a read-only value");
+  }
 }
 
 int main()
@@ -328,12 +494,14 @@ int main()
   test_size<our_mallocx, our_dallocx, our_sallocx, our_nallocx>();
   test_zeroing<our_mallocx, our_dallocx, our_rallocx>();
   test_xallocx<our_mallocx, our_dallocx, our_xallocx>();
+  test_resize_in_place();
   test_legacy_experimental_apis<
     our_allocm,
     our_rallocm,
     our_sallocm,
     our_dallocm,
     our_nallocm>();
+  test_mallctl();
 
 #ifndef __PIC__
   void* bootstrap = __je_bootstrap_malloc(42);
@@ -0,0 +1,125 @@
+/**
+ * Checks lazy slab carving: that objects handed out in batches from a slab's
+ * bump cursor are distinct and reusable in every small sizeclass, and that a
+ * slab that is barely used does not have all of its pages touched.
+ */
+
+#ifndef SNMALLOC_LAZY_SLAB
+#  define SNMALLOC_LAZY_SLAB
+#endif
+
+#include <algorithm>
+#include <iostream>
+#include <snmalloc/snmalloc.h>
+#include <stdio.h>
+#include <string.h>
+#if defined(__linux__)
+#  include <sys/mman.h>
+#endif
+#include <test/setup.h>
+#include <test/xoroshiro.h>
+#include <vector>
+
+using namespace snmalloc;
+
+static_assert(LAZY_SLAB_ENABLED);
+
+#if defined(__linux__)
+/**
+ * The number of pages of the slab holding `p` that are resident.
+ */
+static size_t resident_pages(void* p, size_t slab_size)
+{
+  size_t page_size = DefaultPal::page_size;
+  std::vector<unsigned char> pages(slab_size / page_size);
+  void* slab = pointer_align_down(p, slab_size);
+  SNMALLOC_CHECK(mincore(slab, slab_size, pages.data()) == 0);
+  return static_cast<size_t>(
+    std::count_if(pages.begin(), pages.end(), [](unsigned char c) {
+      return (c & 1) != 0;
+    }));
+}
+#endif
+
+/**
+ * One object from each of the sizeclasses with several objects to a page takes
+ * a fresh slab for each, but should only touch the first batch of each.
+ * Threading the whole slab would touch every page of it.
+ */
+void test_resident()
+{
+#if defined(__linux__)
+  size_t total = 0;
+  size_t resident = 0;
+  for (smallsizeclass_t sc = 0; sc < NUM_SMALL_SIZECLASSES; sc++)
+  {
+    size_t size = sizeclass_to_size(sc);
+    if (size > DefaultPal::page_size / 4)
+      break;
+
+    size_t slab_size = sizeclass_to_slab_size(sc);
+    auto p = snmalloc::alloc(size);
+    total += slab_size / DefaultPal::page_size;
+    resident += resident_pages(p, slab_size);
+    snmalloc::dealloc(p);
+  }
+
+  std::cout << resident << " of " << total << " slab pages resident"
+            << std::endl;
+  SNMALLOC_CHECK(resident < total / 2);
+#endif
+}
+
+/**
+ * Fills several slabs of each small sizeclass, so that every batch is carved,
+ * checks the objects do not overlap, and frees them in a random order before
+ * doing it again with the slabs the first round left behind.
+ */
+void test_sizeclasses()
+{
+  xoroshiro::p128r64 r;
+  std::vector<void*> objects;
+
+  for (smallsizeclass_t sc = 0; sc < NUM_SMALL_SIZECLASSES; sc++)
+  {
+    size_t size = sizeclass_to_size(sc);
+    size_t count = 3 * sizeclass_to_slab_object_count(sc) + 1;
+
+    for (size_t round = 0; round < 2; round++)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        auto p = snmalloc::alloc(size);
+        SNMALLOC_CHECK(p != nullptr);
+        SNMALLOC_CHECK(snmalloc::alloc_size(p) == size);
+        memset(p, static_cast<int>(i), size);
+        objects.push_back(p);
+      }
+
+      std::vector<void*> sorted = objects;
+      std::sort(sorted.begin(), sorted.end());
+      for (size_t i = 1; i < sorted.size(); i++)
+        SNMALLOC_CHECK(
+          pointer_offset(sorted[i - 1], size) <= sorted[i]);
+
+      for (size_t i = objects.size(); i > 1; i--)
+        std::swap(objects[i - 1], objects[r.next() % i]);
+      for (auto p : objects)
+        snmalloc::dealloc(p);
+      objects.clear();
+    }
+  }
+
+  snmalloc::debug_check_empty();
+}
+
+int main()
+{
+  setup();
+
+  test_resident();
+  test_sizeclasses();
+
+  std::cout << "Done" << std::endl;
+  return 0;
+}
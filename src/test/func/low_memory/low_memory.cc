@@ -0,0 +1,174 @@
+/**
+ * Checks the Linux low-memory notifications, driven from fake pressure stall
+ * and cgroup files, and that an allocator can give its cached memory back.
+ */
+
+// Releasing cached memory must reach the allocator that cached it.
+#ifdef SNMALLOC_PER_CPU_ALLOC
+#  undef SNMALLOC_PER_CPU_ALLOC
+#endif
+
+#include <iostream>
+#include <snmalloc/snmalloc.h>
+#include <test/setup.h>
+
+#ifdef __linux__
+#  include <chrono>
+#  include <stdio.h>
+#  include <stdlib.h>
+#  include <string>
+#  include <thread>
+
+using namespace snmalloc;
+
+static std::string dir;
+static size_t notifications = 0;
+
+static PalNotificationObject counter{
+  [](PalNotificationObject*) { notifications++; }};
+
+static void write_file(const char* name, const char* contents)
+{
+  auto path = dir + "/" + name;
+  FILE* f = fopen(path.c_str(), "w");
+  SNMALLOC_CHECK(f != nullptr);
+  fputs(contents, f);
+  fclose(f);
+}
+
+static void write_psi(const char* avg10)
+{
+  std::string contents = std::string("some avg10=") + avg10 +
+    " avg60=0.00 avg300=0.00 total=0\n"
+    "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n";
+  write_file("memory.pressure", contents.c_str());
+}
+
+static void write_events(const char* high)
+{
+  std::string contents =
+    std::string("low 0\nhigh ") + high + "\nmax 0\noom 0\noom_kill 0\n";
+  write_file("memory.events", contents.c_str());
+}
+
+/**
+ * Let the pressure timer run again.
+ */
+static void run_timer()
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  DefaultPal::time_in_ms();
+}
+
+/**
+ * Wait until another notification may be sent.
+ */
+static void wait_notify_interval()
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+}
+
+static void test_notifications()
+{
+  write_psi("0.00");
+  write_events("0");
+  write_file("memory.high", "max\n");
+  write_file("memory.max", "max\n");
+  write_file("memory.current", "1000\n");
+
+  // Initialising snmalloc registers the backend for notifications.
+  snmalloc::dealloc(snmalloc::alloc(16));
+  PALLinux::register_for_low_memory_callback(&counter);
+
+  PALLinux::set_memory_pressure_source(dir.c_str());
+
+  run_timer();
+  SNMALLOC_CHECK(notifications == 0);
+  SNMALLOC_CHECK(!PALLinux::expensive_low_memory_check());
+
+  // The cgroup hits its high limit once.
+  auto epoch = Config::Backend::low_memory_epoch();
+  write_events("1");
+  run_timer();
+  SNMALLOC_CHECK(notifications == 1);
+  SNMALLOC_CHECK(Config::Backend::low_memory_epoch() > epoch);
+  run_timer();
+  SNMALLOC_CHECK(notifications == 1);
+
+  // Stalls notify when they start, but not again while they last.
+  wait_notify_interval();
+  write_psi("25.50");
+  SNMALLOC_CHECK(PALLinux::expensive_low_memory_check());
+  run_timer();
+  SNMALLOC_CHECK(notifications == 2);
+  run_timer();
+  SNMALLOC_CHECK(notifications == 2);
+  write_psi("9.99");
+  SNMALLOC_CHECK(!PALLinux::expensive_low_memory_check());
+  run_timer();
+  SNMALLOC_CHECK(notifications == 2);
+
+  // Stalls starting again soon after are held back, then notified.
+  write_psi("30.00");
+  run_timer();
+  SNMALLOC_CHECK(notifications == 2);
+  wait_notify_interval();
+  run_timer();
+  SNMALLOC_CHECK(notifications == 3);
+  write_psi("0.00");
+
+  // Close to the cgroup limit.
+  write_file("memory.max", "1024\n");
+  SNMALLOC_CHECK(PALLinux::expensive_low_memory_check());
+  write_file("memory.current", "500\n");
+  SNMALLOC_CHECK(!PALLinux::expensive_low_memory_check());
+}
+
+static void test_release()
+{
+  // Leave some of a buddy block cached by this thread.
+  size_t size = bits::one_at_bit(19);
+  void* kept = snmalloc::alloc(size);
+  void* freed = snmalloc::alloc(size);
+  snmalloc::dealloc(freed);
+
+  auto before = Config::Backend::get_current_usage();
+  ThreadAlloc::with([](auto& a) { a.release_cached_memory(); });
+  auto after = Config::Backend::get_current_usage();
+  std::cout << "Released " << before - after << " bytes" << std::endl;
+  SNMALLOC_CHECK(before >= after + size);
+
+  snmalloc::dealloc(kept);
+}
+
+int main()
+{
+  setup();
+
+  char tmpl[] = "/tmp/snmalloc_low_memory_XXXXXX";
+  SNMALLOC_CHECK(mkdtemp(tmpl) != nullptr);
+  dir = tmpl;
+
+  test_notifications();
+  test_release();
+
+  for (auto name :
+       {"memory.pressure",
+        "memory.events",
+        "memory.high",
+        "memory.max",
+        "memory.current"})
+    remove((dir + "/" + name).c_str());
+  remove(dir.c_str());
+
+  std::cout << "low_memory passed" << std::endl;
+  return 0;
+}
+#else
+int main()
+{
+  std::cout << "Low-memory notification test only runs on Linux"
+            << std::endl;
+  return 0;
+}
+#endif
@@ -190,6 +190,42 @@ void test_reallocarr(
   our_free(p);
 }
 
+void test_malloc_batch(size_t size, size_t n)
+{
+  START_TEST("malloc_batch({}, {})", size, n);
+  void* ptrs[600];
+  errno = SUCCESS;
+  size_t got = our_malloc_batch(size, n, ptrs);
+  EXPECT(got == n, "malloc_batch returned {} of {}", got, n);
+  for (size_t i = 0; i < got; i++)
+  {
+    for (size_t j = 0; j < i; j++)
+      EXPECT(ptrs[i] != ptrs[j], "malloc_batch duplicate {}", ptrs[i]);
+  }
+  // Checks and frees each object.
+  for (size_t i = 0; i < got; i++)
+    check_result(size, 1, ptrs[i], SUCCESS, false);
+}
+
+void test_free_batch()
+{
+  START_TEST("free_batch");
+  // Runs from one slab, interleaved sizes, large objects and nullptr.
+  void* ptrs[300];
+  size_t n = 0;
+  for (size_t i = 0; i < 100; i++)
+    ptrs[n++] = our_malloc(32);
+  for (size_t i = 0; i < 100; i++)
+    ptrs[n++] = our_malloc(16 << (i % 8));
+  for (size_t i = 0; i < 4; i++)
+  {
+    ptrs[n++] = our_malloc(MAX_SMALL_SIZECLASS_SIZE * 2);
+    ptrs[n++] = nullptr;
+  }
+  our_free_batch(ptrs, n);
+  our_free_batch(nullptr, 0);
+}
+
 int main(int argc, char** argv)
 {
   UNUSED(argc);
@@ -362,6 +398,16 @@ int main(int argc, char** argv)
     }
   }
 
+  // Batches both within one slab and spanning several refills.
+  for (size_t n : {size_t(0), size_t(1), size_t(17), size_t(600)})
+  {
+    test_malloc_batch(0, n);
+    test_malloc_batch(48, n);
+    test_malloc_batch(MAX_SMALL_SIZECLASS_SIZE, n);
+  }
+  test_malloc_batch(MAX_SMALL_SIZECLASS_SIZE + 1, 3);
+  test_free_batch();
+
   EXPECT(
     our_malloc_usable_size(nullptr) == 0,
     "malloc_usable_size(nullptr) should be zero");
@@ -109,10 +109,108 @@ void check_size(size_t size)
   my_free(d);
 }
 
-void check_bounds(size_t size, size_t out_of_bounds)
+/**
+ * Check that moves work between overlapping buffers, with the destination
+ * below and above the source by various distances, for one `Arch`.  The
+ * result is compared with a copy made through a separate buffer.
+ */
+template<typename Arch>
+void check_move(size_t size)
+{
+  START_TEST("checking {}-byte memmove", size);
+  static constexpr size_t slack = 40;
+  size_t total = size + 2 * slack;
+  auto* buf = static_cast<unsigned char*>(my_malloc(total));
+  auto* expected = static_cast<unsigned char*>(my_malloc(total));
+  auto* tmp = static_cast<unsigned char*>(my_malloc(size + 1));
+  for (size_t shift : {0, 1, 7, 16, 33})
+  {
+    for (bool up : {false, true})
+    {
+      for (size_t i = 0; i < total; ++i)
+      {
+        buf[i] = static_cast<unsigned char>(i * 13);
+        expected[i] = buf[i];
+      }
+      unsigned char* src = buf + slack;
+      unsigned char* dst = up ? src + shift : src - shift;
+      for (size_t i = 0; i < size; ++i)
+      {
+        tmp[i] = src[i];
+      }
+      for (size_t i = 0; i < size; ++i)
+      {
+        expected[static_cast<size_t>(dst - buf) + i] = tmp[i];
+      }
+      void* ret = snmalloc::memmove<false, false, Arch>(dst, src, size);
+      EXPECT(ret == dst, "Return value should be {}, was {}", dst, ret);
+      EXPECT(
+        memcmp(buf, expected, total) == 0,
+        "memmove of {} bytes {} by {} is wrong",
+        size,
+        up ? "up" : "down",
+        shift);
+    }
+  }
+  my_free(buf);
+  my_free(expected);
+  my_free(tmp);
+}
+
+/**
+ * Check that sets write exactly the bytes asked for, at each misalignment,
+ * for one `Arch`.
+ */
+template<typename Arch>
+void check_set(size_t size)
+{
+  START_TEST("checking {}-byte memset", size);
+  static constexpr size_t slack = 64;
+  auto* buf = static_cast<unsigned char*>(my_malloc(size + 2 * slack));
+  for (size_t offset = 0; offset < slack; offset += 7)
+  {
+    for (size_t i = 0; i < size + 2 * slack; ++i)
+    {
+      buf[i] = 0;
+    }
+    void* ret = snmalloc::memset<false, Arch>(buf + offset, 0xa5, size);
+    EXPECT(ret == buf + offset, "Return value should be {}", buf + offset);
+    for (size_t i = 0; i < size + 2 * slack; ++i)
+    {
+      bool inside = (i >= offset) && (i < offset + size);
+      EXPECT(
+        buf[i] == (inside ? 0xa5 : 0),
+        "memset of {} bytes at offset {} wrote {} at {}",
+        size,
+        offset,
+        size_t(buf[i]),
+        i);
+    }
+  }
+  my_free(buf);
+}
+
+template<typename Arch>
+void check_move_and_set()
+{
+  for (size_t x = 0; x < 600; x++)
+  {
+    check_move<Arch>(x);
+    check_set<Arch>(x);
+  }
+  for (size_t x : {1000, 4096, 70000})
+  {
+    check_move<Arch>(x);
+    check_set<Arch>(x);
+  }
+}
+
+template<typename F>
+void check_bounds(
+  const char* name, size_t size, size_t out_of_bounds, F operation)
 {
   START_TEST(
-    "memcpy bounds, size {}, {} bytes out of bounds", size, out_of_bounds);
+    "{} bounds, size {}, {} bytes out of bounds", name, size, out_of_bounds);
   auto* s = static_cast<unsigned char*>(my_malloc(size));
   auto* d = static_cast<unsigned char*>(my_malloc(size));
   for (size_t i = 0; i < size; ++i)
@@ -127,7 +225,7 @@ void check_bounds(size_t size, size_t out_of_bounds)
   can_longjmp = true;
   if (setjmp(jmp) == 0)
   {
-    my_memcpy(d, s, size + out_of_bounds);
+    operation(d, s, size + out_of_bounds);
   }
   else
   {
@@ -143,6 +241,88 @@ void check_bounds(size_t size, size_t out_of_bounds)
   my_free(d);
 }
 
+#  if defined(__x86_64__)
+/**
+ * Check each of the large-copy kernels that this CPU supports, with and
+ * without non-temporal stores, at sizes that exercise their loop and tails
+ * and with sources and destinations misaligned from each other, and the
+ * matching set kernels at the same sizes and destination offsets.
+ */
+void check_kernels()
+{
+  using x86_copy::Kernel;
+  static constexpr size_t max_size = 70000;
+  auto* s = static_cast<unsigned char*>(my_malloc(max_size + 128));
+  auto* d = static_cast<unsigned char*>(my_malloc(max_size + 128));
+  for (size_t i = 0; i < max_size + 128; ++i)
+  {
+    s[i] = static_cast<unsigned char>(i * 7);
+  }
+
+  for (auto kernel : {Kernel::SSE2, Kernel::AVX2, Kernel::AVX512})
+  {
+    if (!x86_copy::supported(kernel))
+      continue;
+    START_TEST("checking copy kernel {}", static_cast<size_t>(kernel));
+    for (size_t size : {512, 513, 1000, 4095, 4096, 65537})
+    {
+      for (size_t src_offset : {0, 1, 31, 64})
+      {
+        for (size_t dst_offset : {0, 3, 32, 63})
+        {
+          for (bool non_temporal : {false, true})
+          {
+            memset(d, 0, max_size + 128);
+            if (non_temporal)
+              x86_copy::copy_vector<true>(
+                kernel, d + dst_offset, s + src_offset, size);
+            else
+              x86_copy::copy_vector(
+                kernel, d + dst_offset, s + src_offset, size);
+            EXPECT(
+              memcmp(d + dst_offset, s + src_offset, size) == 0,
+              "size {}, offsets {} and {}",
+              size,
+              src_offset,
+              dst_offset);
+            EXPECT(
+              (dst_offset == 0 || d[dst_offset - 1] == 0) &&
+                d[dst_offset + size] == 0,
+              "size {} copy wrote outside the destination",
+              size);
+          }
+        }
+      }
+      for (size_t dst_offset : {0, 3, 32, 63})
+      {
+        for (bool non_temporal : {false, true})
+        {
+          memset(d, 0, max_size + 128);
+          if (non_temporal)
+            x86_copy::set_vector<true>(kernel, d + dst_offset, 0x5a, size);
+          else
+            x86_copy::set_vector(kernel, d + dst_offset, 0x5a, size);
+          size_t wrong = 0;
+          for (size_t i = 0; i < max_size + 128; ++i)
+          {
+            bool inside = (i >= dst_offset) && (i < dst_offset + size);
+            wrong += (d[i] != (inside ? 0x5a : 0)) ? 1 : 0;
+          }
+          EXPECT(
+            wrong == 0,
+            "size {} set at offset {} got {} bytes wrong",
+            size,
+            dst_offset,
+            wrong);
+        }
+      }
+    }
+  }
+  my_free(s);
+  my_free(d);
+}
+#  endif
+
 int main()
 {
   // Some sizes to check for out-of-bounds access.  As we are only able to
@@ -156,18 +336,36 @@ int main()
   static_assert(
     MIN_ALLOC_SIZE < 1024,
     "Can't detect overflow except at sizeclass boundaries");
+  auto memcpy_op = [](void* d, const void* s, size_t len) {
+    my_memcpy(d, s, len);
+  };
+  auto memmove_op = [](void* d, const void* s, size_t len) {
+    my_memmove(d, s, len);
+  };
+  auto memset_op = [](void* d, const void*, size_t len) {
+    my_memset(d, 0, len);
+  };
+  auto bzero_op = [](void* d, const void*, size_t len) { my_bzero(d, len); };
   for (auto sz : sizes)
   {
-    // Check in bounds
-    check_bounds(sz, 0);
-    // Check one byte out
-    check_bounds(sz, 1);
-    // Check one object out of bounds
-    check_bounds(sz, sz);
+    for (size_t out_of_bounds : {size_t(0), size_t(1), sz})
+    {
+      // Check in bounds, one byte out and one object out of bounds.
+      check_bounds("memcpy", sz, out_of_bounds, memcpy_op);
+      check_bounds("memmove", sz, out_of_bounds, memmove_op);
+      check_bounds("memset", sz, out_of_bounds, memset_op);
+      check_bounds("bzero", sz, out_of_bounds, bzero_op);
+    }
   }
   for (size_t x = 0; x < 2048; x++)
   {
     check_size(x);
   }
+  check_move_and_set<DefaultArch>();
+  check_move_and_set<GenericArch>();
+  check_move_and_set<GenericStrictProvenance>();
+#  if defined(__x86_64__)
+  check_kernels();
+#  endif
 }
 #endif
\ No newline at end of file
@@ -435,6 +435,53 @@ void test_calloc_large_bug()
   snmalloc::dealloc(p1);
 }
 
+/**
+ * Large zeroed allocations are zeroed by the PAL, which on Linux drops their
+ * pages rather than writing to them, so memory that has not been used since
+ * it came from the OS, or was decommitted, is not committed by zeroing it.
+ */
+void test_calloc_lazy()
+{
+#if defined(__linux__) && !defined(SNMALLOC_QEMU_WORKAROUND)
+  const size_t size = 64 * 1024 * 1024;
+  const size_t page_size = DefaultPal::page_size;
+
+  auto resident = []() {
+    size_t pages = 0;
+    size_t resident_pages = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    SNMALLOC_CHECK(f != nullptr);
+    SNMALLOC_CHECK(fscanf(f, "%zu %zu", &pages, &resident_pages) == 2);
+    fclose(f);
+    return resident_pages * DefaultPal::page_size;
+  };
+
+  // Leave dirty pages behind for the zeroed allocation to reuse.
+  void* dirty = snmalloc::alloc(size);
+  memset(dirty, 0xFF, size);
+  snmalloc::dealloc(dirty);
+
+  size_t before = resident();
+  void* p = snmalloc::alloc<Zero>(size);
+  size_t after = resident();
+  if (p == dirty)
+  {
+    // The dirty pages were dropped rather than overwritten.
+    SNMALLOC_CHECK(after + size / 2 < before);
+  }
+  else
+  {
+    // Fresh pages were not committed.
+    SNMALLOC_CHECK(after < before + size / 4);
+  }
+
+  for (size_t i = 0; i < size; i += page_size)
+    SNMALLOC_CHECK(static_cast<char*>(p)[i + (i / page_size) % page_size] == 0);
+
+  snmalloc::dealloc(p);
+#endif
+}
+
 template<size_t asz, int dealloc = 2>
 void test_static_sized_alloc()
 {
@@ -569,6 +616,7 @@ int main(int, char**)
   TEST(test_remaining_bytes);
   TEST(test_static_sized_allocs);
   TEST(test_calloc_large_bug);
+  TEST(test_calloc_lazy);
   TEST(test_external_pointer_stack);
   TEST(test_external_pointer_dealloc_bug);
   TEST(test_external_pointer_large);
@@ -0,0 +1,221 @@
+/**
+ * Tests for the lazily materialised BBQ message queue used by
+ * RemoteAllocator: it must not allocate before the first message, grow while
+ * the consumer lags, overflow rather than block once it cannot grow, and
+ * shrink back once the consumer has caught up.
+ */
+
+#include <atomic>
+#include <iostream>
+#include <snmalloc/snmalloc.h>
+#include <test/setup.h>
+#include <thread>
+#include <vector>
+
+using namespace snmalloc;
+
+#if defined(__SNMALLOC_USE_BBQ__)
+
+static FreeListKey test_key{0x1234abcd, 0x5678ef01, 0x9abcdef0};
+
+using Config = Alloc::Config;
+
+// Two blocks of two slots, so each segment holds four lists.
+static constexpr size_t segment_capacity = 4;
+static constexpr size_t max_segments = 4;
+using TestQueue = lazyBBQ_MPSC<2, 2, &test_key, NO_KEY_TWEAK, max_segments>;
+using Status = TestQueue::Queuestatus;
+
+freelist::HeadPtr domesticate_nop(freelist::QueuePtr p)
+{
+  return freelist::HeadPtr::unsafe_from(p.unsafe_ptr());
+}
+
+void push_one(TestQueue& q, Config::LocalState& ls)
+{
+  auto o = capptr::Alloc<void>::unsafe_from(snmalloc::alloc(16))
+             .template as_reinterpret<freelist::Object::T<>>();
+  q.template emplace<Config>(o, o, domesticate_nop, &ls);
+}
+
+size_t drain(TestQueue& q, Config::LocalState& ls)
+{
+  size_t count = 0;
+  auto cb = [&count](freelist::HeadPtr o) {
+    snmalloc::dealloc(o.as_void().unsafe_ptr());
+    count++;
+    return true;
+  };
+  Status st;
+  while ((st = q.template front<Config>(
+            domesticate_nop, domesticate_nop, cb, &ls)) != Status::EMPTY)
+  {
+  }
+  return count;
+}
+
+/**
+ * Collect what `drain` cannot see: the last overflowed message.
+ */
+size_t destroy(TestQueue& q, Config::LocalState& ls)
+{
+  size_t count = 0;
+  q.template destroy_and_iterate<Config>(
+    domesticate_nop,
+    [&count](freelist::HeadPtr o) {
+      snmalloc::dealloc(o.as_void().unsafe_ptr());
+      count++;
+    },
+    &ls);
+  return count;
+}
+
+void test_footprint()
+{
+  using Remote = RemoteAllocatorT<BBQRemoteQueue<>>;
+  std::cout << "sizeof(RemoteAllocatorT<BBQRemoteQueue<>>) = "
+            << sizeof(Remote) << std::endl;
+  SNMALLOC_CHECK(sizeof(Remote) <= 4 * REMOTE_MIN_ALIGN);
+}
+
+void test_grow_and_shrink()
+{
+  Config::LocalState ls;
+  TestQueue q;
+
+  SNMALLOC_CHECK(q.segment_count() == 0);
+  SNMALLOC_CHECK(q.is_empty());
+  SNMALLOC_CHECK(drain(q, ls) == 0);
+  SNMALLOC_CHECK(q.segment_count() == 0);
+
+  // Fill every segment the queue may have, and then some.
+  size_t pushed = 3 * segment_capacity * max_segments;
+  for (size_t i = 0; i < pushed; i++)
+    push_one(q, ls);
+
+  SNMALLOC_CHECK(q.segment_count() == max_segments);
+  SNMALLOC_CHECK(!q.is_empty());
+
+  // Draining returns everything and releases all but the tail segment.
+  size_t drained = drain(q, ls);
+  SNMALLOC_CHECK(drained + 1 == pushed);
+  SNMALLOC_CHECK(drained + destroy(q, ls) == pushed);
+  SNMALLOC_CHECK(q.segment_count() == 1);
+
+  // The remaining segment is reused.
+  for (size_t i = 0; i < segment_capacity; i++)
+    push_one(q, ls);
+  SNMALLOC_CHECK(q.segment_count() == 1);
+  SNMALLOC_CHECK(drain(q, ls) == segment_capacity);
+}
+
+void test_concurrent()
+{
+  static constexpr size_t producers = 4;
+  static constexpr size_t per_producer = 20000;
+
+  Config::LocalState consumer_ls;
+  TestQueue q;
+  std::atomic<size_t> live{producers};
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < producers; i++)
+  {
+    threads.emplace_back([&q, &live]() {
+      Config::LocalState ls;
+      for (size_t j = 0; j < per_producer; j++)
+        push_one(q, ls);
+      live--;
+    });
+  }
+
+  size_t received = 0;
+  while (live != 0)
+  {
+    received += drain(q, consumer_ls);
+    std::this_thread::yield();
+  }
+  for (auto& t : threads)
+    t.join();
+
+  received += drain(q, consumer_ls);
+  received += destroy(q, consumer_ls);
+
+  SNMALLOC_CHECK(received == producers * per_producer);
+  SNMALLOC_CHECK(q.segment_count() == 1);
+  SNMALLOC_CHECK(q.is_empty());
+}
+
+void test_partial_overflow_drain()
+{
+  Config::LocalState ls;
+  TestQueue q;
+
+  size_t pushed = 2 * segment_capacity * max_segments;
+  for (size_t i = 0; i < pushed; i++)
+    push_one(q, ls);
+
+  // Stop after every message; the queue must resume where it left off.
+  size_t count = 0;
+  auto cb = [&count](freelist::HeadPtr o) {
+    snmalloc::dealloc(o.as_void().unsafe_ptr());
+    count++;
+    return false;
+  };
+  while (q.template front<Config>(domesticate_nop, domesticate_nop, cb, &ls) !=
+         Status::EMPTY)
+  {
+  }
+
+  SNMALLOC_CHECK(count + destroy(q, ls) == pushed);
+  SNMALLOC_CHECK(q.is_empty());
+}
+
+void test_has_work()
+{
+  Config::LocalState ls;
+  TestQueue q;
+
+  SNMALLOC_CHECK(!q.has_work());
+
+  push_one(q, ls);
+  SNMALLOC_CHECK(q.has_work());
+  SNMALLOC_CHECK(!q.is_empty());
+
+  // A partial drain leaves the hint set.
+  push_one(q, ls);
+  auto stop = [](freelist::HeadPtr o) {
+    snmalloc::dealloc(o.as_void().unsafe_ptr());
+    return false;
+  };
+  q.template front<Config>(domesticate_nop, domesticate_nop, stop, &ls);
+  SNMALLOC_CHECK(q.has_work());
+
+  SNMALLOC_CHECK(drain(q, ls) == 1);
+  SNMALLOC_CHECK(!q.has_work());
+  SNMALLOC_CHECK(q.is_empty());
+}
+
+int main()
+{
+  setup();
+
+  test_footprint();
+  test_has_work();
+  test_grow_and_shrink();
+  test_partial_overflow_drain();
+  test_concurrent();
+
+  std::cout << "message_queue passed" << std::endl;
+  return 0;
+}
+
+#else
+
+int main()
+{
+  std::cout << "BBQ message queue disabled, nothing to test" << std::endl;
+  return 0;
+}
+
+#endif
@@ -101,7 +101,7 @@ namespace snmalloc::miracle
     // We have additional references to this object.
     // We should not free it.
     // TOOD this assumes this is not an internal pointer.
-    memset(ptr, 0, snmalloc::libc::malloc_usable_size(ptr));
+    ::memset(ptr, 0, snmalloc::libc::malloc_usable_size(ptr));
   }
 
   inline void acquire(void* p)
@@ -2,6 +2,11 @@
 #  define __has_feature(x) 0
 #endif
 
+// Per-CPU allocators are not torn down per thread.
+#ifdef SNMALLOC_PER_CPU_ALLOC
+#  undef SNMALLOC_PER_CPU_ALLOC
+#endif
+
 // These test partially override the libc malloc/free functions to test
 // interesting corner cases.  This breaks the sanitizers as they will be
 // partially overridden.  So we disable the tests if any of the sanitizers are
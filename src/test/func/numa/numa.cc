@@ -0,0 +1,167 @@
+/**
+ * Checks NUMA awareness on a machine of any shape.  The range that splits
+ * memory between nodes is driven with a simulated two node topology, and the
+ * allocator built NUMA aware is run on the real one, which is commonly a
+ * single node.
+ */
+
+#ifndef SNMALLOC_NUMA
+#  define SNMALLOC_NUMA
+#endif
+
+#include <iostream>
+#include <snmalloc/snmalloc.h>
+#include <test/setup.h>
+#include <thread>
+#include <vector>
+
+using namespace snmalloc;
+
+/**
+ * The platform, with the node of each thread set by the test and placement
+ * requests counted rather than made.
+ */
+class SimulatedNumaPal : public DefaultPal
+{
+public:
+  static constexpr uint64_t pal_features = DefaultPal::pal_features | NumaAware;
+
+  static inline thread_local size_t current_node = 0;
+
+  static inline stl::Atomic<size_t> bound[2]{};
+
+  static size_t numa_node() noexcept
+  {
+    return current_node;
+  }
+
+  static void numa_bind(void*, size_t size, size_t node) noexcept
+  {
+    bound[node] += size;
+  }
+};
+
+using Pal = SimulatedNumaPal;
+
+using Entry = DefaultPagemapEntry<NoClientMetaDataProvider>;
+using Pagemap = BasicPagemap<
+  Pal,
+  FlatPagemap<MIN_CHUNK_BITS, Entry, Pal, false>,
+  Entry,
+  false>;
+
+static constexpr size_t refill_bits = 24;
+
+using NodeRange = Pipe<
+  PalRange<Pal>,
+  PagemapRegisterRange<Pagemap>,
+  LargeBuddyRange<refill_bits, bits::BITS - 1, Pagemap>,
+  LockRange>;
+
+using Numa = Pipe<NodeRange, NumaRange<Pal, 2>>;
+
+static constexpr size_t size = bits::one_at_bit(20);
+
+static bool contains(capptr::Arena<void> block, capptr::Arena<void> p)
+{
+  return address_cast(p) - address_cast(block) < size;
+}
+
+static void test_simulated()
+{
+  Pagemap::concretePagemap.init<false>();
+
+  Numa on[2];
+  on[1].set_node(1);
+
+  auto a0 = on[0].alloc_range(size);
+  auto a1 = on[1].alloc_range(size);
+  SNMALLOC_CHECK(a0 != nullptr && a1 != nullptr);
+  SNMALLOC_CHECK(on[0].node_of(address_cast(a0)) == 0);
+  SNMALLOC_CHECK(on[0].node_of(address_cast(a1)) == 1);
+  SNMALLOC_CHECK(Pal::bound[0] == size && Pal::bound[1] == size);
+
+  // Memory freed on the wrong node goes back to its owner.  Node 0 never
+  // hands it out, and node 1 does before it needs more memory.
+  on[0].dealloc_range(a1, size);
+  std::vector<capptr::Arena<void>> held;
+  for (size_t i = 0; i < 64; i++)
+  {
+    auto p = on[0].alloc_range(size);
+    SNMALLOC_CHECK(!contains(a1, p));
+    held.push_back(p);
+  }
+  for (auto p : held)
+    on[0].dealloc_range(p, size);
+
+  bool found = false;
+  size_t bound_before = Pal::bound[1];
+  for (size_t i = 0; !found && i < 64; i++)
+  {
+    auto p = on[1].alloc_range(size);
+    found = contains(a1, p);
+    if (found)
+    {
+      // Already placed on node 1.
+      SNMALLOC_CHECK(Pal::bound[1] == bound_before);
+    }
+  }
+  SNMALLOC_CHECK(found);
+
+  // Rebinding an instance moves it to the other node's memory.
+  SNMALLOC_CHECK(on[1].set_node(0));
+  SNMALLOC_CHECK(!on[1].set_node(0));
+  on[0].dealloc_range(a0, size);
+  auto again = on[1].alloc_range(size);
+  SNMALLOC_CHECK(on[1].node_of(address_cast(again)) == 0);
+}
+
+static void test_allocator()
+{
+  static constexpr size_t threads = 4;
+
+  std::cout << "Running on node " << DefaultPal::numa_node() << std::endl;
+
+  // Objects allocated on one thread and freed on another go back to their
+  // owner.
+  std::vector<void*> objects[threads];
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; t++)
+  {
+    workers.emplace_back([&objects, t]() {
+      for (size_t i = 0; i < 1000; i++)
+      {
+        size_t sz = 16 << (i % 16);
+        void* p = snmalloc::alloc(sz);
+        memset(p, static_cast<int>(t), sz);
+        objects[t].push_back(p);
+      }
+    });
+  }
+  for (auto& w : workers)
+    w.join();
+  workers.clear();
+
+  for (size_t t = 0; t < threads; t++)
+  {
+    workers.emplace_back([&objects, t]() {
+      for (auto p : objects[(t + 1) % threads])
+        snmalloc::dealloc(p);
+    });
+  }
+  for (auto& w : workers)
+    w.join();
+
+  snmalloc::debug_check_empty();
+}
+
+int main()
+{
+  setup();
+
+  test_simulated();
+  test_allocator();
+
+  std::cout << "numa passed" << std::endl;
+  return 0;
+}
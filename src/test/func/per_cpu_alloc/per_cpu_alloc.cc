@@ -0,0 +1,145 @@
+/**
+ * Checks the per-CPU allocator mode: threads started one after another share
+ * the allocators of the CPUs they ran on rather than each creating one,
+ * objects freed concurrently by threads other than the allocating one are
+ * all returned, teardown and thread exit leave allocators with their CPUs,
+ * and statistics include every CPU's allocator.
+ */
+
+#ifndef SNMALLOC_PER_CPU_ALLOC
+#  define SNMALLOC_PER_CPU_ALLOC
+#endif
+#ifndef SNMALLOC_STATS
+#  define SNMALLOC_STATS
+#endif
+
+#include <atomic>
+#include <iostream>
+#include <snmalloc/snmalloc.h>
+#include <test/setup.h>
+#include <thread>
+#include <vector>
+
+using namespace snmalloc;
+
+static size_t count_allocators()
+{
+  size_t count = 0;
+  for (auto* a = AllocPool<Config>::iterate(); a != nullptr;
+       a = AllocPool<Config>::iterate(a))
+    count++;
+  return count;
+}
+
+static void test_sequential_threads()
+{
+  static constexpr size_t threads = 64;
+
+  for (size_t i = 0; i < threads; i++)
+  {
+    std::thread t([]() {
+      void* p = snmalloc::alloc(64);
+      snmalloc::dealloc(p);
+    });
+    t.join();
+  }
+
+  // Only one thread ran at a time, so it always found its CPU's allocator
+  // free.
+  size_t cpus = bits::max<size_t>(std::thread::hardware_concurrency(), 1);
+  size_t count = count_allocators();
+  std::cout << count << " allocators for " << threads << " threads on "
+            << cpus << " CPUs" << std::endl;
+  SNMALLOC_CHECK(count <= cpus);
+}
+
+static void test_cross_thread_frees()
+{
+  static constexpr size_t threads = 8;
+  static constexpr size_t objects = 4096;
+
+  std::vector<void*> slots[threads];
+  std::atomic<size_t> allocated{0};
+
+  auto worker = [&](size_t id) {
+    for (size_t i = 0; i < objects; i++)
+      slots[id].push_back(snmalloc::alloc(16 + ((i * 7 + id) % 512)));
+
+    allocated++;
+    while (allocated.load() < threads)
+      std::this_thread::yield();
+
+    // Free another thread's objects.
+    for (auto* p : slots[(id + 1) % threads])
+      snmalloc::dealloc(p);
+  };
+
+  std::vector<std::thread> ts;
+  for (size_t i = 0; i < threads; i++)
+    ts.emplace_back(worker, i);
+  for (auto& t : ts)
+    t.join();
+}
+
+static void test_teardown()
+{
+  std::thread t([]() {
+    void* p = snmalloc::alloc(64);
+    snmalloc::debug_teardown();
+    void* q = snmalloc::alloc(64);
+    snmalloc::dealloc(p);
+    snmalloc::dealloc(q);
+  });
+  t.join();
+  snmalloc::debug_teardown();
+
+  // No allocator went back to the pool.
+  SNMALLOC_CHECK(AllocPool<Config>::extract() == nullptr);
+}
+
+static void test_stats()
+{
+  static constexpr size_t size = 48;
+  static constexpr size_t count = 1000;
+  smallsizeclass_t sc = size_to_sizeclass(size);
+
+  AllocStatsSnapshot before;
+  get_stats(before);
+
+  // Hold this CPU's allocator, so that the thread uses another one.
+  std::vector<void*> objects;
+  ThreadAlloc::with([&](Alloc&) {
+    std::thread t([&objects]() {
+      for (size_t i = 0; i < count; i++)
+        objects.push_back(snmalloc::alloc(size));
+    });
+    t.join();
+  });
+
+  AllocStatsSnapshot during;
+  get_stats(during);
+  SNMALLOC_CHECK(during.small[sc].allocs - before.small[sc].allocs == count);
+
+  for (auto* p : objects)
+    snmalloc::dealloc(p);
+
+  AllocStatsSnapshot after;
+  get_stats(after);
+  SNMALLOC_CHECK(
+    after.small[sc].deallocs - before.small[sc].deallocs == count);
+}
+
+int main()
+{
+  setup();
+
+  test_sequential_threads();
+  test_cross_thread_frees();
+  test_teardown();
+  test_stats();
+
+  snmalloc::debug_check_empty();
+
+  std::cout << "per_cpu_alloc passed" << std::endl;
+  return 0;
+}
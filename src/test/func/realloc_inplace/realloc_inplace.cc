@@ -0,0 +1,113 @@
+/**
+ * Checks that large reallocations shrink and grow in place when the
+ * neighbouring address space is free, that contents survive a run of
+ * doubling reallocations, and that moving pages preserves their contents.
+ */
+
+// Growing in place claims neighbours from the cache they were freed to.
+#ifdef SNMALLOC_PER_CPU_ALLOC
+#  undef SNMALLOC_PER_CPU_ALLOC
+#endif
+
+#include <iostream>
+#include <snmalloc/snmalloc.h>
+#include <test/setup.h>
+
+using namespace snmalloc;
+
+static constexpr size_t large = bits::one_at_bit(20);
+
+static void fill(void* p, size_t size, uint8_t seed)
+{
+  auto* bytes = static_cast<uint8_t*>(p);
+  for (size_t i = 0; i < size; i += 512)
+    bytes[i] = static_cast<uint8_t>(seed + (i >> 9));
+}
+
+static bool check(void* p, size_t size, uint8_t seed)
+{
+  auto* bytes = static_cast<uint8_t*>(p);
+  for (size_t i = 0; i < size; i += 512)
+  {
+    if (bytes[i] != static_cast<uint8_t>(seed + (i >> 9)))
+      return false;
+  }
+  return true;
+}
+
+static void test_shrink_then_grow()
+{
+  void* p = snmalloc::alloc(large);
+  fill(p, large, 1);
+
+  // Shrinking returns the tail to this thread's cache as the buddies of the
+  // remaining chunk, so growing back can take them again.
+  SNMALLOC_CHECK(snmalloc::resize_in_place(p, large / 4));
+  SNMALLOC_CHECK(snmalloc::alloc_size(p) == large / 4);
+  SNMALLOC_CHECK(snmalloc::resize_in_place(p, large));
+  SNMALLOC_CHECK(snmalloc::alloc_size(p) == large);
+  SNMALLOC_CHECK(check(p, large / 4, 1));
+
+  // The same through realloc.
+  SNMALLOC_CHECK(libc::realloc(p, large / 2) == p);
+  SNMALLOC_CHECK(libc::realloc(p, large - 1) == p);
+  SNMALLOC_CHECK(check(p, large / 2, 1));
+
+  // Small objects and interior pointers are left alone.
+  void* small = snmalloc::alloc(64);
+  SNMALLOC_CHECK(!snmalloc::resize_in_place(small, large));
+  SNMALLOC_CHECK(!snmalloc::resize_in_place(pointer_offset(p, 4096), large));
+  snmalloc::dealloc(small);
+  snmalloc::dealloc(p);
+}
+
+static void test_doubling()
+{
+  size_t size = MAX_SMALL_SIZECLASS_SIZE;
+  void* p = snmalloc::alloc(size);
+  fill(p, size, 7);
+  for (; size < bits::one_at_bit(25); size *= 2)
+  {
+    p = libc::realloc(p, size * 2);
+    SNMALLOC_CHECK(p != nullptr);
+    SNMALLOC_CHECK(check(p, size, 7));
+    fill(p, size * 2, 7);
+  }
+  snmalloc::dealloc(p);
+}
+
+static void test_remap()
+{
+  using Pal = Config::Pal;
+  if constexpr (pal_supports<RemapPages, Pal>)
+  {
+    size_t size = REALLOC_REMAP_THRESHOLD * 2;
+    void* src = snmalloc::alloc(size);
+    void* dst = snmalloc::alloc(size);
+    fill(src, size, 3);
+    if (Pal::remap(dst, src, size))
+    {
+      SNMALLOC_CHECK(check(dst, size, 3));
+      // The source stays usable.
+      SNMALLOC_CHECK(static_cast<uint8_t*>(src)[0] == 0);
+    }
+    else
+    {
+      std::cout << "remap not supported by this kernel" << std::endl;
+    }
+    snmalloc::dealloc(src);
+    snmalloc::dealloc(dst);
+  }
+}
+
+int main()
+{
+  setup();
+
+  test_shrink_then_grow();
+  test_doubling();
+  test_remap();
+
+  std::cout << "realloc_inplace passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ * Checks that moving the pages of large reallocations, with
+ * SNMALLOC_REALLOC_REMAP, does not keep splitting the heap into more
+ * mappings: a long run of growing reallocations should leave the number of
+ * lines in /proc/self/maps bounded by the live heap, not by the number of
+ * reallocations.
+ */
+
+#ifndef SNMALLOC_REALLOC_REMAP
+#  define SNMALLOC_REALLOC_REMAP
+#endif
+
+#include <iostream>
+#include <snmalloc/snmalloc.h>
+#include <test/setup.h>
+
+using namespace snmalloc;
+
+static_assert(REALLOC_REMAP_ENABLED);
+
+#ifdef __linux__
+#  include <stdio.h>
+#  include <string.h>
+
+static size_t mappings()
+{
+  FILE* f = fopen("/proc/self/maps", "r");
+  SNMALLOC_CHECK(f != nullptr);
+  size_t lines = 0;
+  int c;
+  while ((c = fgetc(f)) != EOF)
+    lines += (c == '\n') ? 1 : 0;
+  fclose(f);
+  return lines;
+}
+
+/**
+ * Grow buffers from 2 to 6 MiB, with another allocation made in between so
+ * that they cannot grow in place and their pages are moved, keeping a
+ * changing set of them live.
+ */
+static void reallocs(void** live, size_t count, size_t rounds)
+{
+  for (size_t r = 0; r < rounds; r++)
+  {
+    size_t size = (2 + r % 3) * REALLOC_REMAP_THRESHOLD;
+    void* p = libc::malloc(size);
+    memset(p, static_cast<int>(r), size);
+    void* blocker = snmalloc::alloc(REALLOC_REMAP_THRESHOLD);
+    p = libc::realloc(p, size * 2);
+    SNMALLOC_CHECK(p != nullptr);
+    SNMALLOC_CHECK(static_cast<uint8_t*>(p)[size - 1] == (r & 0xff));
+    snmalloc::dealloc(blocker);
+
+    size_t slot = (r * 7) % count;
+    libc::free(live[slot]);
+    live[slot] = p;
+  }
+}
+
+int main()
+{
+  setup();
+
+  static constexpr size_t count = 16;
+  void* live[count]{};
+
+  // Warm up until the heap has reached its working size.
+  reallocs(live, count, 100);
+  size_t before = mappings();
+  reallocs(live, count, 1000);
+  size_t after = mappings();
+  std::cout << "Mappings " << before << " before and " << after
+            << " after 1000 reallocations" << std::endl;
+  SNMALLOC_CHECK(after <= before + 2 * count);
+
+  for (auto p : live)
+    libc::free(p);
+
+  std::cout << "realloc_remap passed" << std::endl;
+  return 0;
+}
+#else
+int main()
+{
+  std::cout << "realloc_remap test only runs on Linux" << std::endl;
+  return 0;
+}
+#endif
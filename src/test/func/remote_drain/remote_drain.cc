@@ -0,0 +1,193 @@
+/**
+ * Runs remote frees through configurations with small remote drain budgets,
+ * one of messages and one of ticks, and checks that each pass over the
+ * message queue stops at its budget, that later passes handle what was left,
+ * and that every object is returned.
+ */
+
+#include "test/setup.h"
+
+#include <iostream>
+#include <snmalloc/backend/backend.h>
+#include <snmalloc/backend/standard_range.h>
+#include <snmalloc/backend_helpers/backend_helpers.h>
+#include <snmalloc/mem/secondary/default.h>
+#include <snmalloc/snmalloc_core.h>
+#include <vector>
+
+namespace snmalloc
+{
+  /**
+   * The default transport, counting the messages handed out by the last
+   * `dequeue`.  `Tag` keeps the counts of each configuration apart.
+   */
+  template<size_t Tag>
+  class alignas(REMOTE_MIN_ALIGN) CountingRemoteQueue
+  : public DefaultRemoteQueue
+  {
+  public:
+    static inline size_t handled = 0;
+
+    template<
+      typename Config,
+      typename Domesticator_head,
+      typename Domesticator_queue,
+      typename Cb>
+    void dequeue(
+      Domesticator_head domesticate_head,
+      Domesticator_queue domesticate_queue,
+      Cb cb,
+      typename Config::LocalState* local_state)
+    {
+      auto counted = [cb](auto msg) SNMALLOC_FAST_PATH_LAMBDA {
+        handled++;
+        return cb(msg);
+      };
+      DefaultRemoteQueue::template dequeue<Config>(
+        domesticate_head, domesticate_queue, counted, local_state);
+    }
+  };
+
+  template<size_t DrainMessages, uint64_t DrainTicks>
+  class DrainConfig final : public CommonConfig
+  {
+  public:
+    using Pal = DefaultPal;
+    using PagemapEntry = DefaultPagemapEntry<NoClientMetaDataProvider>;
+    using ClientMeta = NoClientMetaDataProvider;
+    using SecondaryAllocator = DefaultSecondaryAllocator;
+    using RemoteQueue = CountingRemoteQueue<DrainMessages>;
+
+  private:
+    using ConcretePagemap =
+      FlatPagemap<MIN_CHUNK_BITS, PagemapEntry, Pal, false>;
+
+  public:
+    using Pagemap = BasicPagemap<Pal, ConcretePagemap, PagemapEntry, false>;
+
+    using ConcreteAuthmap =
+      FlatPagemap<MinBaseSizeBits<Pal>(), capptr::Arena<void>, Pal, false>;
+
+    using Authmap = DefaultAuthmap<ConcreteAuthmap>;
+
+    using Base = Pipe<
+      PalRange<Pal>,
+      PagemapRegisterRange<Pagemap>,
+      PagemapRegisterRange<Authmap>>;
+
+    using LocalState = StandardLocalState<Pal, Pagemap, Base>;
+
+    using GlobalPoolState = PoolState<Allocator<DrainConfig>>;
+
+    using Backend =
+      BackendAllocator<Pal, PagemapEntry, Pagemap, Authmap, LocalState>;
+
+  private:
+    SNMALLOC_REQUIRE_CONSTINIT
+    inline static GlobalPoolState alloc_pool;
+
+  public:
+    static constexpr Flags Options = []() constexpr {
+      Flags opts = {};
+      opts.RemoteDrainBytes = SIZE_MAX;
+      opts.RemoteDrainMessages = DrainMessages;
+      opts.RemoteDrainTicks = DrainTicks;
+      return opts;
+    }();
+
+    static GlobalPoolState& pool()
+    {
+      return alloc_pool;
+    }
+  };
+
+  using MessageConfig = DrainConfig<4, 0>;
+  using TickConfig = DrainConfig<0, 1>;
+  using Config = MessageConfig;
+}
+
+#define SNMALLOC_PROVIDE_OWN_CONFIG
+#include <snmalloc/snmalloc.h>
+
+using namespace snmalloc;
+
+/**
+ * Objects of a size that few share a slab, so that freeing them sends many
+ * messages.
+ */
+static constexpr size_t size = MAX_SMALL_SIZECLASS_SIZE;
+static constexpr size_t count = 256;
+
+/**
+ * Free `count` objects of one allocator from another, and drain the first
+ * one pass at a time.  Returns the number of messages each pass handled.
+ */
+template<typename Config>
+static std::vector<size_t> drain()
+{
+  using Queue = typename Config::RemoteQueue;
+  std::vector<size_t> passes;
+
+  {
+    ScopedAllocator<Allocator<Config>> owner;
+    ScopedAllocator<Allocator<Config>> other;
+
+    std::vector<void*> objects;
+    for (size_t i = 0; i < count; i++)
+      objects.push_back(owner->alloc(size));
+    for (auto* p : objects)
+      other->dealloc(p);
+    other->flush();
+
+    while (true)
+    {
+      Queue::handled = 0;
+      owner->template handle_message_queue<true>([]() {});
+      if (Queue::handled == 0)
+        break;
+      passes.push_back(Queue::handled);
+    }
+  }
+
+  // The passes above handled every message.
+  Queue::handled = 0;
+  debug_check_empty<Config>();
+  SNMALLOC_CHECK(Queue::handled == 0);
+  return passes;
+}
+
+int main()
+{
+  setup();
+
+  static constexpr bool pagemap_randomize =
+    mitigations(random_pagemap) && !aal_supports<StrictProvenance>;
+  Config::Pagemap::concretePagemap.init<pagemap_randomize>();
+  if constexpr (aal_supports<StrictProvenance>)
+    Config::Authmap::init();
+
+  LocalEntropy entropy;
+  entropy.init<DefaultPal>();
+  entropy.make_free_list_key(RemoteAllocator::key_global);
+  entropy.make_free_list_key(freelist::Object::key_root);
+
+  auto passes = drain<MessageConfig>();
+  std::cout << "Message budget: " << passes.size() << " passes" << std::endl;
+  SNMALLOC_CHECK(passes.size() > 1);
+  for (size_t i = 0; i < passes.size(); i++)
+  {
+    SNMALLOC_CHECK(passes[i] <= 4);
+    SNMALLOC_CHECK(passes[i] == 4 || i == passes.size() - 1);
+  }
+
+  // The clock is read every sixteen messages, and a pass stops at the
+  // first reading a tick or more after it started.
+  passes = drain<TickConfig>();
+  std::cout << "Tick budget: " << passes.size() << " passes" << std::endl;
+  SNMALLOC_CHECK(passes.size() > 1);
+  for (size_t i = 0; i < passes.size() - 1; i++)
+    SNMALLOC_CHECK((passes[i] % 16) == 0);
+
+  std::cout << "remote_drain passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,64 @@
+/**
+ * Runs cross-thread deallocation through a configuration that chooses the
+ * remote transport the build does not default to, so that both transports
+ * are exercised whichever way SNMALLOC_USE_BBQ is set.
+ */
+
+#include "test/setup.h"
+
+#include <iostream>
+#include <snmalloc/backend/globalconfig.h>
+#include <snmalloc/snmalloc_core.h>
+#include <thread>
+#include <vector>
+
+namespace snmalloc
+{
+#if defined(__SNMALLOC_USE_BBQ__)
+  using OtherRemoteQueue = FreeListRemoteQueue;
+#else
+  // Small segments, so that the queue has to grow and overflow.
+  using OtherRemoteQueue = BBQRemoteQueue<2, 4, 4>;
+#endif
+
+  using Config = snmalloc::StandardConfigClientMeta<
+    NoClientMetaDataProvider,
+    DefaultSecondaryAllocator,
+    OtherRemoteQueue>;
+}
+
+#define SNMALLOC_PROVIDE_OWN_CONFIG
+#include <snmalloc/snmalloc.h>
+
+using namespace snmalloc;
+
+static_assert(stl::is_same_v<Alloc::Config::RemoteQueue, OtherRemoteQueue>);
+
+int main()
+{
+  setup();
+
+  static constexpr size_t rounds = 20;
+  static constexpr size_t count = 10000;
+
+  for (size_t r = 0; r < rounds; r++)
+  {
+    std::vector<void*> objects;
+    std::thread producer([&objects]() {
+      for (size_t i = 0; i < count; i++)
+        objects.push_back(snmalloc::alloc(16 + (i % 64) * 16));
+    });
+    producer.join();
+
+    // Every free is remote, as the producer's allocator is now idle.
+    std::thread consumer([&objects]() {
+      for (auto p : objects)
+        snmalloc::dealloc(p);
+    });
+    consumer.join();
+  }
+
+  snmalloc::debug_check_empty();
+  std::cout << "remote_queue passed" << std::endl;
+  return 0;
+}
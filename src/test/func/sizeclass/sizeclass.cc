@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <iostream>
 #include <snmalloc/snmalloc.h>
 #include <test/setup.h>
+#include <vector>
 
 NOINLINE
 snmalloc::smallsizeclass_t size_to_sizeclass(size_t size)
@@ -17,6 +19,21 @@ void test_align_size()
 
   SNMALLOC_CHECK(snmalloc::aligned_size(128, 160) == 256);
 
+  // The sizes of the small sizeclasses that are multiples of each alignment,
+  // in increasing order.
+  std::vector<size_t> aligned_classes[snmalloc::MAX_SMALL_SIZECLASS_BITS];
+  for (size_t sc = 0; sc < snmalloc::NUM_SMALL_SIZECLASSES; sc++)
+  {
+    auto sc_size = snmalloc::sizeclass_to_size(sc);
+    for (size_t bits = 0; bits < snmalloc::MAX_SMALL_SIZECLASS_BITS; bits++)
+    {
+      if ((sc_size & (((size_t)1 << bits) - 1)) == 0)
+        aligned_classes[bits].push_back(sc_size);
+    }
+  }
+  for (auto& classes : aligned_classes)
+    std::sort(classes.begin(), classes.end());
+
   for (size_t size = 1;
        size < snmalloc::sizeclass_to_size(snmalloc::NUM_SMALL_SIZECLASSES - 1);
        size++)
@@ -61,6 +78,19 @@ void test_align_size()
                   << " Size: " << size << " ASize: " << asize << std::endl;
         failed |= true;
       }
+
+      // Aligned requests must not waste more than the slab layout needs:
+      // they use the smallest sizeclass whose objects are all aligned.
+      auto& classes = aligned_classes[alignment_bits];
+      auto best = std::lower_bound(classes.begin(), classes.end(), size);
+      if (best != classes.end() && snmalloc::round_size(asize) != *best)
+      {
+        std::cout << "Not the smallest aligned sizeclass! Alignment: "
+                  << alignment << " Size: " << size
+                  << " Rounded: " << snmalloc::round_size(asize)
+                  << " Smallest: " << *best << std::endl;
+        failed |= true;
+      }
     }
   }
 
@@ -5,6 +5,11 @@
  * and deallocation.
  */
 
+// Per-CPU allocators are not torn down per thread.
+#ifdef SNMALLOC_PER_CPU_ALLOC
+#  undef SNMALLOC_PER_CPU_ALLOC
+#endif
+
 #include "test/setup.h"
 
 #include <iostream>
@@ -7,6 +7,9 @@
 #ifdef SNMALLOC_USE_CXX11_DESTRUCTORS
 #  undef SNMALLOC_USE_CXX11_DESTRUCTORS
 #endif
+#ifdef SNMALLOC_PER_CPU_ALLOC
+#  undef SNMALLOC_PER_CPU_ALLOC
+#endif
 
 #include <new>
 #include <snmalloc/snmalloc_core.h>
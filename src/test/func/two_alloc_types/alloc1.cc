@@ -2,6 +2,11 @@
 #  define SNMALLOC_TRACING
 #endif
 
+// The enclave PAL cannot report the current CPU.
+#ifdef SNMALLOC_PER_CPU_ALLOC
+#  undef SNMALLOC_PER_CPU_ALLOC
+#endif
+
 // Redefine the namespace, so we can have two versions.
 #define snmalloc snmalloc_enclave
 
@@ -0,0 +1,123 @@
+/**
+ * Compares the batch allocation and deallocation APIs against loops of
+ * `malloc` and `free`, for objects freed by the allocating thread and by
+ * another thread.
+ */
+
+#include <algorithm>
+#include <random>
+#include <snmalloc/snmalloc.h>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <thread>
+#include <vector>
+
+using namespace snmalloc;
+
+using Ptrs = std::vector<void*>;
+
+template<typename F>
+static std::chrono::nanoseconds time(F f)
+{
+  MeasureTime m(true);
+  f();
+  return m.get_time();
+}
+
+static void alloc_loop(Ptrs& ptrs, size_t size)
+{
+  for (auto& p : ptrs)
+    p = libc::malloc(size);
+}
+
+static void alloc_batched(Ptrs& ptrs, size_t size)
+{
+  size_t got = snmalloc::alloc_batch(size, ptrs.size(), ptrs.data());
+  SNMALLOC_CHECK(got == ptrs.size());
+}
+
+static void free_loop(Ptrs& ptrs)
+{
+  for (auto* p : ptrs)
+    libc::free(p);
+}
+
+static void free_batched(Ptrs& ptrs)
+{
+  snmalloc::dealloc_batch(ptrs.data(), ptrs.size());
+}
+
+/**
+ * Allocate `ptrs` on another thread, so that freeing them here is remote.
+ */
+template<typename Alloc>
+static void alloc_elsewhere(Ptrs& ptrs, Alloc alloc)
+{
+  std::thread t([&]() { alloc(ptrs); });
+  t.join();
+}
+
+static void test_batch(
+  size_t size, size_t batch, size_t rounds, bool shuffle, bool remote)
+{
+  Ptrs ptrs(batch);
+  std::mt19937 rng(42);
+  std::chrono::nanoseconds times[4]{};
+
+  for (size_t r = 0; r < rounds; r++)
+  {
+    for (size_t batched = 0; batched < 2; batched++)
+    {
+      auto alloc = [&](Ptrs& ptrs) {
+        batched ? alloc_batched(ptrs, size) : alloc_loop(ptrs, size);
+      };
+
+      if (remote)
+        alloc_elsewhere(ptrs, alloc);
+      else
+        times[batched] += time([&]() { alloc(ptrs); });
+
+      if (shuffle)
+        std::shuffle(ptrs.begin(), ptrs.end(), rng);
+
+      times[2 + batched] += time([&]() {
+        batched ? free_batched(ptrs) : free_loop(ptrs);
+      });
+    }
+  }
+
+  std::cout << "size " << std::setw(5) << size << ", batch " << std::setw(5)
+            << batch << (shuffle ? ", shuffled" : "")
+            << (remote ? ", remote" : "");
+  if (!remote)
+    std::cout << "\n  malloc " << std::setw(10) << times[0].count()
+              << " ns, alloc_batch   " << std::setw(10) << times[1].count()
+              << " ns";
+  std::cout << "\n  free   " << std::setw(10) << times[2].count()
+            << " ns, dealloc_batch " << std::setw(10) << times[3].count()
+            << " ns" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+  opt::Opt opt(argc, argv);
+  size_t rounds = opt.is<size_t>("--rounds", 100);
+
+  for (size_t size : {16, 48, 128, 1024})
+  {
+    for (size_t batch : {64, 512, 4096})
+      test_batch(size, batch, rounds, false, false);
+    test_batch(size, 4096, rounds, true, false);
+  }
+
+  for (size_t size : {16, 128})
+  {
+    test_batch(size, 4096, rounds / 10 + 1, false, true);
+    test_batch(size, 4096, rounds / 10 + 1, true, true);
+  }
+
+  snmalloc::debug_check_empty();
+  return 0;
+}
@@ -1,3 +1,4 @@
+#include "test/bench.h"
 #include "test/opt.h"
 #include "test/setup.h"
 #include "test/usage.h"
@@ -6,6 +7,7 @@
 #include <iomanip>
 #include <iostream>
 #include <snmalloc/snmalloc.h>
+#include <sstream>
 #include <thread>
 #include <vector>
 
@@ -13,62 +15,6 @@ using namespace snmalloc;
 
 bool use_malloc = false;
 
-template<void f(size_t id)>
-class ParallelTest
-{
-private:
-  std::atomic<bool> flag = false;
-  std::atomic<size_t> ready = 0;
-  uint64_t start;
-  uint64_t end;
-  std::atomic<size_t> complete = 0;
-
-  size_t cores;
-
-  void run(size_t id)
-  {
-    auto prev = ready.fetch_add(1);
-    if (prev + 1 == cores)
-    {
-      start = Aal::tick();
-      flag = true;
-    }
-    while (!flag)
-      Aal::pause();
-
-    f(id);
-
-    prev = complete.fetch_add(1);
-    if (prev + 1 == cores)
-    {
-      end = Aal::tick();
-    }
-  }
-
-public:
-  ParallelTest(size_t cores) : cores(cores)
-  {
-    std::thread* t = new std::thread[cores];
-
-    for (size_t i = 0; i < cores; i++)
-    {
-      t[i] = std::thread(&ParallelTest::run, this, i);
-    }
-    // Wait for all the threads.
-    for (size_t i = 0; i < cores; i++)
-    {
-      t[i].join();
-    }
-
-    delete[] t;
-  }
-
-  uint64_t time()
-  {
-    return end - start;
-  }
-};
-
 std::atomic<size_t*>* contention;
 size_t swapsize;
 size_t swapcount;
@@ -107,35 +53,28 @@ void test_tasks_f(size_t id)
   }
 };
 
-void test_tasks(size_t num_tasks, size_t count, size_t size)
+void test_tasks(
+  bench::Harness& harness, size_t num_tasks, size_t count, size_t size)
 {
-  std::cout << "Sequential setup" << std::endl;
-
-  contention = new std::atomic<size_t*>[size];
-  xoroshiro::p128r32 r;
-
-  for (size_t n = 0; n < size; n++)
-  {
-    size_t alloc_size = 16 + (r.next() % 1024);
-    size_t* res =
-      (size_t*)(use_malloc ? malloc(alloc_size) : snmalloc::alloc(alloc_size));
-    *res = alloc_size;
-    contention[n] = res;
-  }
-  swapcount = count;
-  swapsize = size;
+  std::stringstream name;
+  name << "threads=" << num_tasks;
 
-#ifdef USE_SNMALLOC_STATS
-  Stats s0;
-  current_alloc_pool()->aggregate_stats(s0);
-#endif
-  std::cout << "Begin parallel test:" << std::endl;
+  harness.run(name.str(), num_tasks * count, [&](bench::Timer& timer) {
+    contention = new std::atomic<size_t*>[size];
+    xoroshiro::p128r32 r;
 
-  {
-    ParallelTest<test_tasks_f> test(num_tasks);
+    for (size_t n = 0; n < size; n++)
+    {
+      size_t alloc_size = 16 + (r.next() % 1024);
+      size_t* res = (size_t*)(use_malloc ? malloc(alloc_size) :
+                                           snmalloc::alloc(alloc_size));
+      *res = alloc_size;
+      contention[n] = res;
+    }
+    swapcount = count;
+    swapsize = size;
 
-    std::cout << "Task test, " << num_tasks << " threads, " << count
-              << " swaps per thread " << test.time() << " ticks" << std::endl;
+    timer.set(harness.parallel(num_tasks, test_tasks_f));
 
     for (size_t n = 0; n < swapsize; n++)
     {
@@ -149,16 +88,17 @@ void test_tasks(size_t num_tasks, size_t count, size_t size)
     }
 
     delete[] contention;
-  }
 
 #ifndef NDEBUG
-  snmalloc::debug_check_empty();
+    snmalloc::debug_check_empty();
 #endif
+  });
 };
 
 int main(int argc, char** argv)
 {
   setup();
+  bench::Harness harness("contention", argc, argv);
 
   opt::Opt opt(argc, argv);
   size_t cores = opt.is<size_t>("--cores", 8);
@@ -171,7 +111,7 @@ int main(int argc, char** argv)
             << std::endl;
 
   for (size_t i = cores; i > 0; i >>= 1)
-    test_tasks(i, count, size);
+    test_tasks(harness, i, count, size);
 
   if (opt.has("--stats"))
   {
@@ -1,5 +1,5 @@
 #include <snmalloc/snmalloc.h>
-#include <test/measuretime.h>
+#include <test/bench.h>
 #include <test/setup.h>
 #include <test/xoroshiro.h>
 #include <unordered_set>
@@ -50,7 +50,7 @@ namespace test
     snmalloc::debug_check_empty();
   }
 
-  void test_external_pointer(xoroshiro::p128r64& r)
+  void test_external_pointer(bench::Harness& harness, xoroshiro::p128r64& r)
   {
     // This is very slow on Windows at the moment.  Until this is fixed, help
     // CI terminate.
@@ -65,11 +65,10 @@ namespace test
     static constexpr size_t iterations = 100000;
 #  endif
 #endif
-    setup(r);
+    harness.run("queries", iterations, [&](bench::Timer& timer) {
+      setup(r);
 
-    {
-      MeasureTime m;
-      m << "External pointer queries ";
+      timer.start();
       for (size_t i = 0; i < iterations; i++)
       {
         size_t rand = (size_t)r.next();
@@ -86,21 +85,22 @@ namespace test
           abort();
         }
       }
-    }
+      timer.stop();
 
-    teardown();
+      teardown();
+    });
   }
 }
 
-int main(int, char**)
+int main(int argc, char** argv)
 {
   setup();
 
-  xoroshiro::p128r64 r;
+  bench::Harness harness(
+    "external_pointer", argc, argv, snmalloc::Debug ? 30 : 3);
 
-  size_t nn = snmalloc::Debug ? 30 : 3;
+  xoroshiro::p128r64 r;
 
-  for (size_t n = 0; n < nn; n++)
-    test::test_external_pointer(r);
+  test::test_external_pointer(harness, r);
   return 0;
 }
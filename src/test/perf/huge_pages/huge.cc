@@ -0,0 +1,13 @@
+// A second copy of snmalloc whose heap is backed by transparent huge pages,
+// so that the two modes can be compared in one process.
+#ifndef SNMALLOC_HUGE_PAGES
+#  define SNMALLOC_HUGE_PAGES
+#endif
+
+// Redefine the namespace, so we can have two versions.
+#define snmalloc snmalloc_huge
+
+#include <snmalloc/snmalloc.h>
+
+#define SNMALLOC_NAME_MANGLE(a) huge_##a
+#include <snmalloc/override/malloc.cc>
@@ -0,0 +1,100 @@
+/**
+ * Compares random access over a large allocation from the default
+ * allocator with the same access pattern over an allocation from a copy of
+ * snmalloc built with SNMALLOC_HUGE_PAGES.  The access pattern is a random
+ * cyclic pointer chase, so nearly every load misses in the data TLB when the
+ * buffer is backed by base pages.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <snmalloc/snmalloc.h>
+#include <string>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <test/xoroshiro.h>
+
+extern "C" void* huge_malloc(size_t);
+extern "C" void huge_free(void*);
+
+using namespace snmalloc;
+
+/**
+ * Build a single random cycle through the `count` slots of `buffer`, with
+ * each slot holding the index of the next.
+ */
+static void make_cycle(size_t* buffer, size_t count)
+{
+  xoroshiro::p128r64 r;
+  for (size_t i = 0; i < count; i++)
+    buffer[i] = i;
+
+  // Sattolo's algorithm produces a permutation with a single cycle.
+  for (size_t i = count - 1; i > 0; i--)
+  {
+    size_t j = static_cast<size_t>(r.next() % i);
+    size_t tmp = buffer[i];
+    buffer[i] = buffer[j];
+    buffer[j] = tmp;
+  }
+}
+
+static size_t chase(const size_t* buffer, size_t steps)
+{
+  size_t index = 0;
+  for (size_t i = 0; i < steps; i++)
+    index = buffer[index];
+  return index;
+}
+
+/**
+ * Report how much of the process is backed by transparent huge pages, where
+ * the kernel exposes it.
+ */
+static void report_huge_pages()
+{
+  std::ifstream smaps("/proc/self/smaps_rollup");
+  std::string line;
+  while (std::getline(smaps, line))
+  {
+    if (line.rfind("AnonHugePages:", 0) == 0)
+      std::cout << line << std::endl;
+  }
+}
+
+static size_t run(const char* name, void* p, size_t size, size_t steps)
+{
+  auto* buffer = static_cast<size_t*>(p);
+  make_cycle(buffer, size / sizeof(size_t));
+  report_huge_pages();
+
+  MeasureTime m;
+  m << name << " random access over " << (size >> 20) << " MiB";
+  return chase(buffer, steps);
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+
+  opt::Opt opt(argc, argv);
+  size_t size = opt.is<size_t>("--size", bits::one_at_bit(26));
+  size_t steps = opt.is<size_t>("--steps", bits::one_at_bit(22));
+
+  size_t sink = 0;
+
+  void* base = snmalloc::alloc(size);
+  sink += run("base pages", base, size, steps);
+  snmalloc::dealloc(base);
+
+  void* huge = huge_malloc(size);
+  sink += run("huge pages", huge, size, steps);
+  huge_free(huge);
+
+  // Keep the chase from being optimised away.
+  if (sink == SIZE_MAX)
+    std::cout << sink << std::endl;
+
+  return 0;
+}
@@ -20,6 +20,7 @@
 using namespace std;
 
 #include <snmalloc/snmalloc.h>
+#include <test/bench.h>
 #define malloc snmalloc::libc::malloc
 #define free snmalloc::libc::free
 #define malloc_usable_size snmalloc::libc::malloc_usable_size
@@ -90,8 +91,10 @@ void looper(size_t iterations)
   flush();
 }
 
-int main()
+int main(int argc, char** argv)
 {
+  bench::Harness harness("lotsofthreads", argc, argv);
+
 #ifdef SNMALLOC_THREAD_SANITIZER_ENABLED
   size_t iterations = 50000;
 #elif defined(__APPLE__) && !defined(SNMALLOC_APPLE_HAS_OS_SYNC_WAIT_ON_ADDRESS)
@@ -102,21 +105,24 @@ int main()
   size_t iterations = 200000;
 #endif
 
-  int threadcount = 8;
-  vector<thread> threads;
-
-  for (int i = 0; i < threadcount; ++i)
-    threads.emplace_back(looper, iterations);
+  size_t threadcount = 8;
 
-  std::thread freeloop_thread(freeloop);
+  harness.run(
+    "allocating_threads=8",
+    threadcount * iterations * 8,
+    [&](bench::Timer& timer) {
+      mustexit.store(0);
+      std::thread freeloop_thread([&]() {
+        harness.pin_worker(threadcount);
+        freeloop();
+      });
 
-  for (auto& thread : threads)
-  {
-    thread.join();
-  }
+      timer.set(
+        harness.parallel(threadcount, [&](size_t) { looper(iterations); }));
 
-  mustexit.store(1);
-  freeloop_thread.join();
+      mustexit.store(1);
+      freeloop_thread.join();
+    });
 
   puts("Done!");
   return 0;
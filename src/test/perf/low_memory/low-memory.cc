@@ -1,6 +1,7 @@
 #include <atomic>
 #include <iostream>
 #include <snmalloc/snmalloc.h>
+#include <test/bench.h>
 #include <test/opt.h>
 #include <test/setup.h>
 #include <unordered_set>
@@ -107,6 +108,7 @@ void register_for_pal_notifications()
 int main(int argc, char** argv)
 {
   opt::Opt opt(argc, argv);
+  bench::Harness harness("low_memory", argc, argv);
 
   // TODO reinstate
 
@@ -143,13 +145,15 @@ int main(int argc, char** argv)
 
   //   setup();
 
-  //   for (size_t i = 0; i < 10; i++)
-  //   {
-  //     reach_pressure(allocations);
-  //     std::cout << "Pressure " << i << std::endl;
+  //   harness.run("pressure", 10, [&](bench::Timer&) {
+  //     for (size_t i = 0; i < 10; i++)
+  //     {
+  //       reach_pressure(allocations);
+  //       std::cout << "Pressure " << i << std::endl;
 
-  //     reduce_pressure(allocations);
-  //   }
+  //       reduce_pressure(allocations);
+  //     }
+  //   });
 
   //   // Deallocate everything
   //   while (allocations.try_remove())
@@ -1,5 +1,5 @@
 #include <snmalloc/snmalloc.h>
-#include <test/measuretime.h>
+#include <test/bench.h>
 #include <test/opt.h>
 #include <vector>
 
@@ -64,19 +64,14 @@ void test_memcpy(size_t size, void* src, Memcpy mc)
 
 template<typename Memcpy>
 void test(
-  size_t size,
-  Memcpy mc,
-  std::vector<std::pair<size_t, std::chrono::nanoseconds>>& stats)
+  bench::Harness& harness, const char* variant, size_t size, Memcpy mc)
 {
   auto src = snmalloc::alloc(size);
   shape(size);
-  for (size_t i = 0; i < 10; i++)
-  {
-    MeasureTime m(true);
-    test_memcpy(size, src, mc);
-    auto time = m.get_time();
-    stats.push_back({size, time});
-  }
+  harness.run(
+    std::string(variant) + "/size=" + std::to_string(size),
+    allocs.size(),
+    [&](bench::Timer&) { test_memcpy(size, src, mc); });
   snmalloc::dealloc(src);
   unshape();
 }
@@ -103,10 +98,134 @@ void* memcpy_platform_checked(void* dst, const void* src, size_t size)
     [&]() { return memcpy(dst, src, size); });
 }
 
+#if defined(__x86_64__) || defined(_M_X64)
+/**
+ * Times one of the large-copy kernels that `X86_64Arch` chooses between, at a
+ * given size and misalignment of the source and destination, copying about
+ * the same number of bytes for each size.
+ */
+template<typename Kernel>
+void test_kernel(
+  bench::Harness& harness,
+  const char* name,
+  size_t size,
+  size_t src_offset,
+  size_t dst_offset,
+  Kernel kernel)
+{
+  static constexpr size_t bytes = 4 * 1024 * 1024;
+  size_t copies = bits::max<size_t>(bytes / size, 1);
+  auto src = static_cast<char*>(snmalloc::alloc(size + 64));
+  auto dst = static_cast<char*>(snmalloc::alloc(size + 64));
+  memset(src, 0x5a, size + 64);
+  memset(dst, 0xFF, size + 64);
+
+  harness.run(
+    std::string("kernel/") + name + "/size=" + std::to_string(size) +
+      "/align=" + std::to_string(src_offset) + ":" + std::to_string(dst_offset),
+    copies,
+    [&](bench::Timer&) {
+      for (size_t i = 0; i < copies; i++)
+        kernel(dst + dst_offset, src + src_offset, size);
+    });
+
+  snmalloc::dealloc(src);
+  snmalloc::dealloc(dst);
+}
+
+/**
+ * Sweeps each kernel this CPU supports over sizes and alignments.  The set
+ * kernels ignore the source, so only the destination offset matters to them.
+ */
+void test_kernels(bench::Harness& harness, bool full_test)
+{
+  using x86_copy::Kernel;
+  struct Vector
+  {
+    const char* name;
+    Kernel kernel;
+  };
+  const Vector vectors[] = {
+    {"sse2", Kernel::SSE2}, {"avx2", Kernel::AVX2}, {"avx512", Kernel::AVX512}};
+  const size_t alignments[][2] = {{0, 0}, {1, 0}, {0, 1}, {17, 33}};
+
+  std::vector<size_t> sizes = {512, 4096, 65536, 1024 * 1024};
+  if (full_test)
+    sizes.push_back(64 * 1024 * 1024);
+
+  for (auto size : sizes)
+  {
+    for (auto& a : alignments)
+    {
+      test_kernel(
+        harness,
+        "rep_movsb",
+        size,
+        a[0],
+        a[1],
+        [](void* dst, const void* src, size_t len) {
+          x86_copy::copy_rep_movsb(dst, src, len);
+        });
+      test_kernel(
+        harness,
+        "rep_stosb",
+        size,
+        a[0],
+        a[1],
+        [](void* dst, const void*, size_t len) {
+          x86_copy::set_rep_stosb(dst, 0x5a, len);
+        });
+      for (auto& v : vectors)
+      {
+        if (!x86_copy::supported(v.kernel))
+          continue;
+        test_kernel(
+          harness,
+          v.name,
+          size,
+          a[0],
+          a[1],
+          [&](void* dst, const void* src, size_t len) {
+            x86_copy::copy_vector(v.kernel, dst, src, len);
+          });
+        test_kernel(
+          harness,
+          (std::string(v.name) + "-nt").c_str(),
+          size,
+          a[0],
+          a[1],
+          [&](void* dst, const void* src, size_t len) {
+            x86_copy::copy_vector<true>(v.kernel, dst, src, len);
+          });
+        test_kernel(
+          harness,
+          (std::string(v.name) + "-set").c_str(),
+          size,
+          a[0],
+          a[1],
+          [&](void* dst, const void*, size_t len) {
+            x86_copy::set_vector(v.kernel, dst, 0x5a, len);
+          });
+        test_kernel(
+          harness,
+          (std::string(v.name) + "-set-nt").c_str(),
+          size,
+          a[0],
+          a[1],
+          [&](void* dst, const void*, size_t len) {
+            x86_copy::set_vector<true>(v.kernel, dst, 0x5a, len);
+          });
+      }
+    }
+  }
+}
+#endif
+
 int main(int argc, char** argv)
 {
   opt::Opt opt(argc, argv);
   bool full_test = opt.has("--full_test");
+  bench::Harness harness("memcpy", argc, argv, full_test ? 800 : 10);
 
   //  size_t size = 0;
   auto mc_platform_checked = [](void* dst, const void* src, size_t len) {
@@ -148,36 +267,16 @@ int main(int argc, char** argv)
     sizes.push_back(size + 5);
   }
 
-  std::vector<std::pair<size_t, std::chrono::nanoseconds>> stats_sn,
-    stats_sn_checked, stats_platform, stats_platform_checked;
-
-  printf("size, sn, sn-checked, platform, platform-checked\n");
-
-  size_t repeats = full_test ? 80 : 1;
-
-  for (auto repeat = repeats; 0 < repeat; repeat--)
+  for (auto copy_size : sizes)
   {
-    for (auto copy_size : sizes)
-    {
-      test(copy_size, mc_platform_checked, stats_platform_checked);
-      test(copy_size, mc_sn, stats_sn);
-      test(copy_size, mc_platform, stats_platform);
-      test(copy_size, mc_sn_checked, stats_sn_checked);
-    }
-    for (size_t i = 0; i < stats_sn.size(); i++)
-    {
-      auto& s1 = stats_sn[i];
-      auto& s2 = stats_sn_checked[i];
-      auto& s3 = stats_platform[i];
-      auto& s4 = stats_platform_checked[i];
-      std::cout << s1.first << ", " << s1.second.count() << ", "
-                << s2.second.count() << ", " << s3.second.count() << ", "
-                << s4.second.count() << std::endl;
-    }
-    stats_sn.clear();
-    stats_sn_checked.clear();
-    stats_platform.clear();
-    stats_platform_checked.clear();
+    test(harness, "platform-checked", copy_size, mc_platform_checked);
+    test(harness, "sn", copy_size, mc_sn);
+    test(harness, "platform", copy_size, mc_platform);
+    test(harness, "sn-checked", copy_size, mc_sn_checked);
   }
+
+#if defined(__x86_64__) || defined(_M_X64)
+  test_kernels(harness, full_test);
+#endif
   return 0;
 }
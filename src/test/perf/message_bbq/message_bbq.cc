@@ -5,6 +5,7 @@
 #include "snmalloc/backend/globalconfig.h"
 #include "snmalloc/backend_helpers/commonconfig.h"
 #include "snmalloc/mem/backend_concept.h"
+#include "test/bench.h"
 #include "test/xoroshiro.h"
 
 // #include <barrier>
@@ -235,7 +236,7 @@ void check(size_t iterations)
 }
 #endif
 
-int main()
+int main(int argc, char** argv)
 {
   constexpr int batched = -1;
   using Config = StandardConfigClientMeta<NoClientMetaDataProvider>;
@@ -243,19 +244,27 @@ int main()
 #if defined(DEBUG) && (defined(__unix__) || defined(__APPLE__))
   std::signal(SIGQUIT, signal_handler);
 #endif
-  auto begin = std::chrono::steady_clock::now();
-  std::thread t3(writer, 1);
-  std::thread t1(writer, -1);
-  std::thread t2(reader, ITERS * 2 * batched);
+  bench::Harness harness("message_bbq", argc, argv);
+  uint64_t total_op =
+    (batched == -1) ? ITERS * 2 : ITERS * 4; // producer's and consumer's
+
+  harness.run("batched_mpsc", total_op, [&](bench::Timer& timer) {
+    reads_count = 0;
+    timer.set(harness.parallel(3, [&](size_t i) {
+      if (i == 0)
+        writer(1);
+      else if (i == 1)
+        writer(-1);
+      else
+        reader(ITERS * 2 * batched);
+    }));
+  });
 
   // std::thread t4(reader, ITERS * 2);
   //     std::thread t5(writer, 10);
   //    std::thread t6(reader, ITERS + 20);
   //    std::thread t7(reader, 50);
   //   std::thread t8(writer, 2);
-  t1.join();
-  t2.join();
-  t3.join();
   // t4.join();
   //     t7.join();
   //          t5.join();
@@ -263,18 +272,8 @@ int main()
   //         t6.join();
   //      log << "\v\v===============================================\n";
   //      std::cout << q;
-  auto end = std::chrono::steady_clock::now();
-  double time_in_sec =
-    std::chrono::duration<double, std::milli>(end - begin).count() / 1000.0;
-  uint64_t total_op =
-    (batched == -1) ? ITERS * 2 : ITERS * 4; // producer's and consumer's
-  log << "BatchedBBQ(MPSC): finish writing and reading with throughput = "
-
-      << static_cast<double>(total_op) / time_in_sec << " op/s."
 #if defined(TEST_BBQ_CHECK_ENTRIES)
-      << "  [check_entries enabled(turn off to get real throughput)]\n";
-#else
-      << '\n';
+  log << "[check_entries enabled(turn off to get real throughput)]\n";
 #endif
 //    log << q;
 // std::cout << "===========\n";
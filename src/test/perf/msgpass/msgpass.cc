@@ -20,6 +20,7 @@
 #endif
 
 #include "snmalloc/mem/message_bbq.h"
+#include "test/bench.h"
 #include "test/opt.h"
 #include "test/setup.h"
 #include "test/usage.h"
@@ -293,6 +294,7 @@ void consumer(const struct params* param, size_t qix)
     int main(int argc, char** argv)
     {
       struct params param;
+      bench::Harness harness("msgpass", argc, argv);
 
       opt::Opt opt(argc, argv);
       param.N_PRODUCER = opt.is<size_t>("--producers", 3);
@@ -333,67 +335,84 @@ void consumer(const struct params* param, size_t qix)
                 << " --max-batch=" << param.N_MAX_BATCH_SIZE << std::endl;
 
       param.N_QUEUE = param.N_CONSUMER + param.N_PROXY;
-      param.msgqueue =
+
+      /* Each producer batch is one operation */
+      harness.run(
+        "batches",
+        param.N_PRODUCER * param.N_PRODUCER_BATCH,
+        [&](bench::Timer&) {
+          param.msgqueue =
 #  if defined(__SNMALLOC_USE_BBQ__)
-        new batchedBBQ_MPSC<
-          params::block_num,
-          params::block_size,
-          &msgqueue_key,
-          msgqueue_key_tweak>[param.N_QUEUE];
+            new batchedBBQ_MPSC<
+              params::block_num,
+              params::block_size,
+              &msgqueue_key,
+              msgqueue_key_tweak>[param.N_QUEUE];
 #  else
-        new FreeListMPSCQ<msgqueue_key, msgqueue_key_tweak>[param.N_QUEUE];
+            new FreeListMPSCQ<msgqueue_key, msgqueue_key_tweak>[param.N_QUEUE];
 #  endif
 
-      auto* producer_threads = new std::thread[param.N_PRODUCER];
-      auto* queue_threads = new std::thread[param.N_QUEUE];
+          auto* producer_threads = new std::thread[param.N_PRODUCER];
+          auto* queue_threads = new std::thread[param.N_QUEUE];
 
 #  if !defined(__SNMALLOC_USE_BBQ__)
-      for (size_t i = 0; i < param.N_QUEUE; i++)
-      {
-    param.msgqueue[i].init();
-      }
+          for (size_t i = 0; i < param.N_QUEUE; i++)
+          {
+            param.msgqueue[i].init();
+          }
 #  endif
 
-      producers_live = true;
-      queue_gate = param.N_QUEUE;
-      messages_outstanding = 0;
+          producers_live = true;
+          queue_gate = param.N_QUEUE;
+          messages_outstanding = 0;
 
-      /* Spawn consumers */
-      for (size_t i = 0; i < param.N_CONSUMER; i++)
-      {
-    queue_threads[i] = std::thread(consumer, &param, i);
-      }
+          /* Spawn consumers */
+          for (size_t i = 0; i < param.N_CONSUMER; i++)
+          {
+            queue_threads[i] = std::thread([&, i]() {
+              harness.pin_worker(param.N_PRODUCER + i);
+              consumer(&param, i);
+            });
+          }
 
-      /* Spawn proxies */
-      for (size_t i = param.N_CONSUMER; i < param.N_QUEUE; i++)
-      {
-    queue_threads[i] = std::thread(::proxy, &param, i);
-      }
+          /* Spawn proxies */
+          for (size_t i = param.N_CONSUMER; i < param.N_QUEUE; i++)
+          {
+            queue_threads[i] = std::thread([&, i]() {
+              harness.pin_worker(param.N_PRODUCER + i);
+              ::proxy(&param, i);
+            });
+          }
 
-      /* Spawn producers */
-      for (size_t i = 0; i < param.N_PRODUCER; i++)
-      {
-    producer_threads[i] = std::thread(producer, &param, i);
-      }
+          /* Spawn producers */
+          for (size_t i = 0; i < param.N_PRODUCER; i++)
+          {
+            producer_threads[i] = std::thread([&, i]() {
+              harness.pin_worker(i);
+              producer(&param, i);
+            });
+          }
 
-      /* Wait for producers to finish */
-      for (size_t i = 0; i < param.N_PRODUCER; i++)
-      {
-    producer_threads[i].join();
-      }
-      producers_live = false;
+          /* Wait for producers to finish */
+          for (size_t i = 0; i < param.N_PRODUCER; i++)
+          {
+            producer_threads[i].join();
+          }
+          producers_live = false;
 
-      /* Wait for proxies and consumers to finish */
-      for (size_t i = 0; i < param.N_QUEUE; i++)
-      {
-    queue_threads[param.N_QUEUE - 1 - i].join();
-      }
+          /* Wait for proxies and consumers to finish */
+          for (size_t i = 0; i < param.N_QUEUE; i++)
+          {
+            queue_threads[param.N_QUEUE - 1 - i].join();
+          }
 
-      delete[] producer_threads;
-      delete[] queue_threads;
+          delete[] producer_threads;
+          delete[] queue_threads;
+          delete[] param.msgqueue;
 
-      /* Ensure that we have not lost any allocations */
-      debug_check_empty<snmalloc::Alloc::Config>();
+          /* Ensure that we have not lost any allocations */
+          debug_check_empty<snmalloc::Alloc::Config>();
+        });
 
       return 0;
     }
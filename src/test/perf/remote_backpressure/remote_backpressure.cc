@@ -0,0 +1,109 @@
+/**
+ * Latency of pushing to a remote message queue whose consumer has stalled.
+ *
+ * Producers fill a small lazily materialised BBQ well past its segment limit
+ * while the consumer does nothing.  Every push must still complete promptly:
+ * the tail of the latency distribution is reported so that a regression to
+ * busy-waiting on a full queue is visible.  The consumer then wakes up and
+ * checks that every message arrived.
+ */
+
+#include "test/opt.h"
+#include "test/setup.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <snmalloc/snmalloc.h>
+#include <thread>
+#include <vector>
+
+using namespace snmalloc;
+
+#if defined(__SNMALLOC_USE_BBQ__)
+
+static FreeListKey backpressure_key{0x600dcafe, 0x12345678, 0x0badf00d};
+
+using Config = Alloc::Config;
+using Queue = lazyBBQ_MPSC<4, 16, &backpressure_key, NO_KEY_TWEAK, 4>;
+
+freelist::HeadPtr domesticate_nop(freelist::QueuePtr p)
+{
+  return freelist::HeadPtr::unsafe_from(p.unsafe_ptr());
+}
+
+void report(std::vector<uint64_t>& ns)
+{
+  std::sort(ns.begin(), ns.end());
+  auto at = [&ns](double q) {
+    return ns[std::min(ns.size() - 1, static_cast<size_t>(q * ns.size()))];
+  };
+  std::cout << "emplace latency (ns): p50 " << at(0.5) << " p99 " << at(0.99)
+            << " p99.9 " << at(0.999) << " max " << ns.back() << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+  opt::Opt opt(argc, argv);
+  size_t producers = opt.is<size_t>("--producers", 4);
+  size_t per_producer = opt.is<size_t>("--messages", 100000);
+
+  Queue q;
+  std::vector<std::vector<uint64_t>> latencies(producers);
+  std::vector<std::thread> threads;
+
+  for (size_t i = 0; i < producers; i++)
+  {
+    threads.emplace_back([&q, &latencies, i, per_producer]() {
+      Config::LocalState ls;
+      auto& ns = latencies[i];
+      ns.reserve(per_producer);
+      for (size_t j = 0; j < per_producer; j++)
+      {
+        auto o = capptr::Alloc<void>::unsafe_from(snmalloc::alloc(16))
+                   .template as_reinterpret<freelist::Object::T<>>();
+        auto start = std::chrono::steady_clock::now();
+        q.template emplace<Config>(o, o, domesticate_nop, &ls);
+        auto end = std::chrono::steady_clock::now();
+        ns.push_back(static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+            .count()));
+      }
+    });
+  }
+
+  for (auto& t : threads)
+    t.join();
+
+  std::vector<uint64_t> all;
+  for (auto& ns : latencies)
+    all.insert(all.end(), ns.begin(), ns.end());
+  report(all);
+
+  Config::LocalState ls;
+  size_t received = 0;
+  q.template destroy_and_iterate<Config>(
+    domesticate_nop,
+    [&received](freelist::HeadPtr o) {
+      snmalloc::dealloc(o.as_void().unsafe_ptr());
+      received++;
+    },
+    &ls);
+
+  std::cout << "received " << received << " of " << producers * per_producer
+            << " in " << q.segment_count() << " segment(s)" << std::endl;
+  SNMALLOC_CHECK(received == producers * per_producer);
+  return 0;
+}
+
+#else
+
+int main()
+{
+  std::cout << "BBQ message queue disabled, nothing to test" << std::endl;
+  return 0;
+}
+
+#endif
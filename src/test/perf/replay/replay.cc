@@ -0,0 +1,348 @@
+/**
+ * Replays an allocation trace, as recorded by the `snmallocshim-record`
+ * shim, against the allocator this is built with.  Each recorded thread is
+ * replayed on a thread of its own, and a free waits until the object it
+ * frees has been allocated, wherever that was, so the replay keeps the
+ * trace's cross-thread frees without running in lock step.
+ *
+ *   perf-replay-fast [--trace FILE] [--rounds N]
+ *
+ * reports the throughput, the peak resident set size and the peak memory
+ * committed by the backend.  Without a trace, a synthetic one is replayed.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <snmalloc/snmalloc.h>
+#include <stdio.h>
+#include <test/measuretime.h>
+#include <test/opt.h>
+#include <test/setup.h>
+#include <test/xoroshiro.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __unix__
+#  include <sys/resource.h>
+#endif
+
+using namespace snmalloc;
+
+/**
+ * A call to replay.  Objects are numbered densely from one, in the order
+ * they were allocated; zero is no object.
+ */
+struct Op
+{
+  AllocOp op;
+  uint8_t align_bits;
+  uint32_t id;
+  uint32_t old_id;
+  size_t size;
+};
+
+struct Trace
+{
+  std::vector<std::vector<Op>> threads;
+  size_t objects = 0;
+  size_t ops = 0;
+};
+
+/**
+ * Turn recorded entries, in the order the calls took effect, into
+ * per-thread lists of calls on numbered objects.
+ * Frees of objects allocated before recording started, and failed calls, are
+ * dropped.
+ */
+static Trace load(const AllocRecordEntry* entries, size_t count)
+{
+  Trace trace;
+  std::unordered_map<uint64_t, uint32_t> live;
+  std::unordered_map<uint32_t, size_t> thread_index;
+
+  auto take = [&](uint64_t address) -> uint32_t {
+    auto it = live.find(address);
+    if (it == live.end())
+      return 0;
+    uint32_t id = it->second;
+    live.erase(it);
+    return id;
+  };
+
+  auto fresh = [&](uint64_t address) -> uint32_t {
+    if (address == 0)
+      return 0;
+    uint32_t id = static_cast<uint32_t>(++trace.objects);
+    live[address] = id;
+    return id;
+  };
+
+  for (size_t i = 0; i < count; i++)
+  {
+    const auto& e = entries[i];
+    Op op{e.op, e.align_bits, 0, 0, e.size};
+    switch (e.op)
+    {
+      case AllocOp::Malloc:
+      case AllocOp::Memalign:
+        op.id = fresh(e.result);
+        if (op.id == 0)
+          continue;
+        break;
+
+      case AllocOp::Free:
+        op.old_id = take(e.old);
+        if (op.old_id == 0)
+          continue;
+        break;
+
+      case AllocOp::Realloc:
+        // Failed, leaving the object as it was.
+        if (e.result == 0 && e.size != 0)
+          continue;
+        op.old_id = take(e.old);
+        op.id = fresh(e.result);
+        if (op.old_id == 0)
+        {
+          if (op.id == 0)
+            continue;
+          op.op = AllocOp::Malloc;
+        }
+        break;
+
+      default:
+        continue;
+    }
+
+    auto [it, added] = thread_index.emplace(e.thread, trace.threads.size());
+    if (added)
+      trace.threads.emplace_back();
+    trace.threads[it->second].push_back(op);
+    trace.ops++;
+  }
+  return trace;
+}
+
+static Trace load_file(const char* path)
+{
+  FILE* f = fopen(path, "rb");
+  if (f == nullptr)
+  {
+    perror(path);
+    exit(1);
+  }
+
+  AllocRecordHeader header;
+  if (
+    fread(&header, sizeof(header), 1, f) != 1 ||
+    header.magic != AllocRecordHeader::MAGIC ||
+    header.entry_size != sizeof(AllocRecordEntry))
+  {
+    fprintf(stderr, "%s: not an allocation trace\n", path);
+    exit(1);
+  }
+
+  std::vector<AllocRecordEntry> entries;
+  AllocRecordEntry buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, sizeof(buffer[0]), 4096, f)) != 0)
+    entries.insert(entries.end(), buffer, buffer + n);
+  fclose(f);
+
+  std::stable_sort(
+    entries.begin(),
+    entries.end(),
+    [](const AllocRecordEntry& a, const AllocRecordEntry& b) {
+      return a.sequence < b.sequence;
+    });
+  return load(entries.data(), entries.size());
+}
+
+/**
+ * A trace of `threads` threads passing objects of mixed sizes between each
+ * other, with some reallocation and aligned allocation.
+ */
+static Trace synthesise(uint32_t threads, size_t count)
+{
+  xoroshiro::p128r64 rng(42);
+  std::vector<AllocRecordEntry> entries;
+  std::vector<uint64_t> live;
+  uint64_t next_address = 0x1000;
+
+  auto size = [&]() -> size_t {
+    auto r = rng.next();
+    if ((r % 64) == 0)
+      return bits::one_at_bit(16 + (r >> 8) % 5);
+    return 16 + (r >> 8) % 1024;
+  };
+
+  for (size_t i = 0; i < count; i++)
+  {
+    AllocRecordEntry e;
+    e.thread = static_cast<uint32_t>(rng.next() % threads) + 1;
+
+    auto r = rng.next() % 100;
+    if (live.empty() || r < 50)
+    {
+      e.op = AllocOp::Malloc;
+      e.size = size();
+      if (r < 3)
+      {
+        e.op = AllocOp::Memalign;
+        e.align_bits = static_cast<uint8_t>(6 + r);
+      }
+      e.result = next_address += 16;
+      live.push_back(e.result);
+    }
+    else
+    {
+      size_t index = rng.next() % live.size();
+      e.old = live[index];
+      if (r < 55)
+      {
+        e.op = AllocOp::Realloc;
+        e.size = size();
+        e.result = live[index] = next_address += 16;
+      }
+      else
+      {
+        e.op = AllocOp::Free;
+        live[index] = live.back();
+        live.pop_back();
+      }
+    }
+    entries.push_back(e);
+  }
+
+  for (auto address : live)
+  {
+    AllocRecordEntry e;
+    e.op = AllocOp::Free;
+    e.thread = static_cast<uint32_t>(rng.next() % threads) + 1;
+    e.old = address;
+    entries.push_back(e);
+  }
+
+  return load(entries.data(), entries.size());
+}
+
+static void* wait_for(std::atomic<void*>& slot)
+{
+  size_t spins = 0;
+  void* p;
+  while ((p = slot.load(std::memory_order_acquire)) == nullptr)
+  {
+    if ((++spins % 64) == 0)
+      std::this_thread::yield();
+    else
+      Aal::pause();
+  }
+  slot.store(nullptr, std::memory_order_relaxed);
+  return p;
+}
+
+static void publish(std::atomic<void*>& slot, void* p, size_t size)
+{
+  SNMALLOC_CHECK(p != nullptr);
+  // Touch the object, as the program that was recorded would.
+  memset(p, 0x5a, bits::min<size_t>(size, 64));
+  slot.store(p, std::memory_order_release);
+}
+
+static void
+replay_thread(const std::vector<Op>& ops, std::atomic<void*>* objects)
+{
+  for (const auto& op : ops)
+  {
+    switch (op.op)
+    {
+      case AllocOp::Malloc:
+        publish(objects[op.id], libc::malloc(op.size), op.size);
+        break;
+
+      case AllocOp::Memalign:
+        publish(
+          objects[op.id],
+          libc::memalign(bits::one_at_bit(op.align_bits), op.size),
+          op.size);
+        break;
+
+      case AllocOp::Free:
+        libc::free(wait_for(objects[op.old_id]));
+        break;
+
+      case AllocOp::Realloc:
+      {
+        void* p = libc::realloc(wait_for(objects[op.old_id]), op.size);
+        if (op.id != 0)
+          publish(objects[op.id], p, op.size);
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+}
+
+static std::chrono::nanoseconds replay(const Trace& trace)
+{
+  std::unique_ptr<std::atomic<void*>[]> objects(
+    new std::atomic<void*>[trace.objects + 1]());
+
+  MeasureTime m(true);
+  std::vector<std::thread> threads;
+  for (const auto& ops : trace.threads)
+    threads.emplace_back([&ops, &objects]() {
+      replay_thread(ops, objects.get());
+    });
+  for (auto& t : threads)
+    t.join();
+  auto time = m.get_time();
+
+  // Objects the recorded program never freed.
+  for (size_t i = 1; i <= trace.objects; i++)
+  {
+    void* p = objects[i].load(std::memory_order_relaxed);
+    if (p != nullptr)
+      libc::free(p);
+  }
+  return time;
+}
+
+int main(int argc, char** argv)
+{
+  setup();
+  opt::Opt opt(argc, argv);
+  const char* path = opt.is("--trace", static_cast<const char*>(nullptr));
+  size_t rounds = opt.is<size_t>("--rounds", 1);
+
+  Trace trace = path != nullptr ? load_file(path) : synthesise(4, 200000);
+  std::cout << (path != nullptr ? path : "synthetic trace") << ": "
+            << trace.ops << " calls on " << trace.objects << " objects from "
+            << trace.threads.size() << " threads" << std::endl;
+
+  std::chrono::nanoseconds time{0};
+  for (size_t r = 0; r < rounds; r++)
+    time += replay(trace);
+
+  double seconds = static_cast<double>(time.count()) / 1e9;
+  std::cout << "  " << static_cast<double>(trace.ops * rounds) / seconds
+            << " calls/s over " << rounds << " rounds" << std::endl;
+
+#ifdef __unix__
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    std::cout << "  peak RSS: " << usage.ru_maxrss << " KiB" << std::endl;
+#endif
+
+  AllocStatsSnapshot stats;
+  get_stats(stats);
+  std::cout << "  peak committed: " << stats.peak_committed_bytes << " bytes"
+            << std::endl;
+
+  snmalloc::debug_check_empty();
+  return 0;
+}
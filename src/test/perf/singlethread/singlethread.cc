@@ -1,86 +1,119 @@
 #include <snmalloc/snmalloc.h>
-#include <test/measuretime.h>
+#include <sstream>
+#include <test/bench.h>
 #include <test/setup.h>
 #include <unordered_set>
 
 using namespace snmalloc;
 
 template<typename Conts>
-void test_alloc_dealloc(size_t count, size_t size, bool write)
+void test_alloc_dealloc(
+  bench::Harness& harness, size_t count, size_t size, bool write)
 {
-  {
-    MeasureTime m;
-    m << "Count: " << std::setw(6) << count << ", Size: " << std::setw(6)
-      << size
-      << ", ZeroMem: " << std::is_same_v<Conts, Zero> << ", Write: " << write;
-
-    std::unordered_set<void*> set;
-
-    // alloc 1.5x objects
-    for (size_t i = 0; i < ((count * 3) / 2); i++)
-    {
-      void* p = snmalloc::alloc<Conts>(size);
-      SNMALLOC_CHECK(set.find(p) == set.end());
+  std::stringstream name;
+  name << (std::is_same_v<Conts, Zero> ? "zero" : "uninit")
+       << "/count=" << count << "/size=" << size << "/write=" << write;
 
-      if (write)
-        *(int*)p = 4;
+  // Each object allocated is freed again.
+  size_t ops = ((count * 3) / 2) + count;
 
-      set.insert(p);
-    }
-
-    // free 0.25x of the objects
-    for (size_t i = 0; i < (count / 4); i++)
+  harness.run(name.str(), ops, [&](bench::Timer& timer) {
     {
-      auto it = set.begin();
-      void* p = *it;
-      set.erase(it);
-      SNMALLOC_CHECK(set.find(p) == set.end());
-      snmalloc::dealloc(p, size);
+      std::unordered_set<void*> set;
+
+      // alloc 1.5x objects
+      for (size_t i = 0; i < ((count * 3) / 2); i++)
+      {
+        void* p = snmalloc::alloc<Conts>(size);
+        SNMALLOC_CHECK(set.find(p) == set.end());
+
+        if (write)
+          *(int*)p = 4;
+
+        set.insert(p);
+      }
+
+      // free 0.25x of the objects
+      for (size_t i = 0; i < (count / 4); i++)
+      {
+        auto it = set.begin();
+        void* p = *it;
+        set.erase(it);
+        SNMALLOC_CHECK(set.find(p) == set.end());
+        snmalloc::dealloc(p, size);
+      }
+
+      // alloc 1x objects
+      for (size_t i = 0; i < count; i++)
+      {
+        void* p = snmalloc::alloc<Conts>(size);
+        SNMALLOC_CHECK(set.find(p) == set.end());
+
+        if (write)
+          *(int*)p = 4;
+
+        set.insert(p);
+      }
+
+      // free everything
+      while (!set.empty())
+      {
+        auto it = set.begin();
+        snmalloc::dealloc(*it, size);
+        set.erase(it);
+      }
+      timer.stop();
     }
 
-    // alloc 1x objects
-    for (size_t i = 0; i < count; i++)
-    {
-      void* p = snmalloc::alloc<Conts>(size);
-      SNMALLOC_CHECK(set.find(p) == set.end());
-
-      if (write)
-        *(int*)p = 4;
+    snmalloc::debug_check_empty();
+  });
+}
 
-      set.insert(p);
-    }
+/**
+ * Repeatedly allocate a large zeroed object, write to every page of it and
+ * free it, so each allocation reuses the chunk the last one freed.  This is
+ * the cost of zeroing memory that is already committed and hot.
+ */
+void test_zero_reuse(bench::Harness& harness, size_t size)
+{
+  static constexpr size_t rounds = 64;
+  std::stringstream name;
+  name << "zero-reuse/size=" << size;
 
-    // free everything
-    while (!set.empty())
+  harness.run(name.str(), rounds, [&](bench::Timer&) {
+    for (size_t i = 0; i < rounds; i++)
     {
-      auto it = set.begin();
-      snmalloc::dealloc(*it, size);
-      set.erase(it);
+      auto* p = static_cast<char*>(snmalloc::alloc<Zero>(size));
+      for (size_t j = 0; j < size; j += OS_PAGE_SIZE)
+        p[j] = 1;
+      snmalloc::dealloc(p, size);
     }
-  }
-
-  snmalloc::debug_check_empty();
+  });
 }
 
-int main(int, char**)
+int main(int argc, char** argv)
 {
   setup();
+  bench::Harness harness("singlethread", argc, argv);
 
   for (size_t size = 16; size <= 128; size <<= 1)
   {
-    test_alloc_dealloc<Uninit>(1 << 15, size, false);
-    test_alloc_dealloc<Uninit>(1 << 15, size, true);
-    test_alloc_dealloc<Zero>(1 << 15, size, false);
-    test_alloc_dealloc<Zero>(1 << 15, size, true);
+    test_alloc_dealloc<Uninit>(harness, 1 << 15, size, false);
+    test_alloc_dealloc<Uninit>(harness, 1 << 15, size, true);
+    test_alloc_dealloc<Zero>(harness, 1 << 15, size, false);
+    test_alloc_dealloc<Zero>(harness, 1 << 15, size, true);
   }
 
   for (size_t size = 1 << 12; size <= 1 << 17; size <<= 1)
   {
-    test_alloc_dealloc<Uninit>(1 << 10, size, false);
-    test_alloc_dealloc<Uninit>(1 << 10, size, true);
-    test_alloc_dealloc<Zero>(1 << 10, size, false);
-    test_alloc_dealloc<Zero>(1 << 10, size, true);
+    test_alloc_dealloc<Uninit>(harness, 1 << 10, size, false);
+    test_alloc_dealloc<Uninit>(harness, 1 << 10, size, true);
+    test_alloc_dealloc<Zero>(harness, 1 << 10, size, false);
+    test_alloc_dealloc<Zero>(harness, 1 << 10, size, true);
   }
 
+  for (size_t size = 1 << 16; size <= 1 << 23; size <<= 1)
+    test_zero_reuse(harness, size);
+
   return 0;
 }
@@ -1,9 +1,9 @@
+#include "test/bench.h"
 #include "test/opt.h"
 #include "test/setup.h"
 #include "test/usage.h"
 #include "test/xoroshiro.h"
 
-#include <algorithm>
 #include <iostream>
 #include <snmalloc/snmalloc.h>
 #include <thread>
@@ -11,85 +11,29 @@
 
 using namespace snmalloc;
 
-std::vector<uint64_t> counters{};
-
-template<typename F>
-class ParallelTest
-{
-private:
-  std::atomic<bool> flag = false;
-  std::atomic<size_t> ready = 0;
-  uint64_t start;
-  uint64_t end;
-  std::atomic<size_t> complete = 0;
-  size_t cores;
-  F f;
-
-  void run(size_t id)
-  {
-    auto prev = ready.fetch_add(1);
-    if (prev + 1 == cores)
-    {
-      start = Aal::tick();
-      flag = true;
-    }
-    while (!flag)
-      Aal::pause();
-
-    f(id);
-
-    prev = complete.fetch_add(1);
-    if (prev + 1 == cores)
-    {
-      end = Aal::tick();
-    }
-  }
-
-public:
-  ParallelTest(F&& f, size_t cores) : cores(cores), f(std::forward<F>(f))
-  {
-    std::thread* t = new std::thread[cores];
-
-    for (size_t i = 0; i < cores; i++)
-    {
-      t[i] = std::thread(&ParallelTest::run, this, i);
-    }
-    // Wait for all the threads.
-    for (size_t i = 0; i < cores; i++)
-    {
-      t[i].join();
-    }
-
-    delete[] t;
-  }
-
-  uint64_t time()
-  {
-    return end - start;
-  }
-};
-
-int main()
+/**
+ * Times each thread's first allocation, which sets up its allocator, with all
+ * the threads starting at once.  The latency percentiles are over the
+ * threads' first allocations.
+ *
+ * Only the first run creates allocators: the threads return them to the
+ * pool when they exit, and the threads of later runs take them from there.
+ * The first run is reported as `cold_first_alloc`, and the rest, including
+ * any warmup, as `warm_first_alloc`.
+ */
+int main(int argc, char** argv)
 {
+  bench::Harness harness("startup", argc, argv);
   auto nthreads = std::thread::hardware_concurrency();
-  counters.resize(nthreads);
 
-  ParallelTest test(
-    [](size_t id) {
-      auto start = Aal::tick();
+  auto first_alloc = [&](bench::Timer& timer) {
+    timer.set(harness.parallel(nthreads, [&](size_t) {
+      auto start = bench::Clock::now();
       snmalloc::dealloc(snmalloc::alloc(1));
-      auto end = Aal::tick();
-      counters[id] = end - start;
-    },
-    nthreads);
+      timer.latency(bench::Clock::now() - start);
+    }));
+  };
 
-  std::cout << "Taken: " << test.time() << std::endl;
-  std::sort(counters.begin(), counters.end());
-  uint64_t start = 0;
-  for (auto counter : counters)
-  {
-    std::cout << "Thread time " << counter << " (" << counter - start << ")"
-              << std::endl;
-    start = counter;
-  }
-}
\ No newline at end of file
+  harness.run_once("cold_first_alloc", nthreads, first_alloc);
+  harness.run("warm_first_alloc", nthreads, first_alloc);
+}
@@ -0,0 +1,274 @@
+/**
+ * Compares the results of two runs of the performance tests, as written by
+ * their `--csv` or `--json` options (see `src/test/bench.h`).
+ *
+ *   snmalloc-bench-compare [--metric M] [--threshold PCT] BASELINE CURRENT
+ *
+ * prints, for each case in both files, the metric in each and the change,
+ * and flags as a regression any case whose metric is more than PCT percent
+ * worse.  The metric is one of the columns of the results, `p50_ns` by
+ * default; `ops_per_sec` is better when higher, the others when lower.  The
+ * threshold is 5 percent by default.  Exits with 1 if there is a regression,
+ * and 2 if a file cannot be read.
+ */
+
+#include <ctype.h>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <test/opt.h>
+#include <vector>
+
+namespace
+{
+  using Row = std::map<std::string, std::string>;
+
+  /**
+   * Results by benchmark and case name.
+   */
+  using Results = std::map<std::string, Row>;
+
+  bool read_file(const char* path, std::string& text)
+  {
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr)
+    {
+      perror(path);
+      return false;
+    }
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) != 0)
+      text.append(buffer, n);
+    fclose(f);
+    return true;
+  }
+
+  void add(Results& results, const std::string& benchmark, Row& row)
+  {
+    if (row.count("name") != 0)
+      results[benchmark + "/" + row["name"]] = row;
+    row.clear();
+  }
+
+  std::vector<std::string> split(const std::string& line)
+  {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true)
+    {
+      size_t comma = line.find(',', start);
+      fields.push_back(line.substr(start, comma - start));
+      if (comma == std::string::npos)
+        return fields;
+      start = comma + 1;
+    }
+  }
+
+  bool parse_csv(const std::string& text, Results& results)
+  {
+    std::vector<std::string> header;
+    size_t start = 0;
+    while (start < text.size())
+    {
+      size_t end = text.find('\n', start);
+      if (end == std::string::npos)
+        end = text.size();
+      std::string line = text.substr(start, end - start);
+      start = end + 1;
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      if (line.empty())
+        continue;
+
+      auto fields = split(line);
+      if (header.empty())
+      {
+        header = fields;
+        continue;
+      }
+      if (fields.size() != header.size())
+        return false;
+
+      Row row;
+      for (size_t i = 0; i < fields.size(); i++)
+        row[header[i]] = fields[i];
+      add(results, row["benchmark"], row);
+    }
+    return !header.empty();
+  }
+
+  /**
+   * Reads the flat objects of the JSON that `bench::Harness` writes, rather
+   * than JSON in general: each object with a "name" is a case of the
+   * benchmark last named by a "benchmark" key.
+   */
+  bool parse_json(const std::string& text, Results& results)
+  {
+    std::string benchmark;
+    std::string key;
+    Row row;
+    size_t i = 0;
+
+    auto read_string = [&](std::string& out) {
+      out.clear();
+      for (i++; i < text.size() && text[i] != '"'; i++)
+      {
+        if (text[i] == '\\' && i + 1 < text.size())
+          i++;
+        out += text[i];
+      }
+      i++;
+      return i <= text.size();
+    };
+
+    while (i < text.size())
+    {
+      char c = text[i];
+      if (c == '"')
+      {
+        std::string s;
+        if (!read_string(s))
+          return false;
+        while (i < text.size() && isspace(static_cast<unsigned char>(text[i])))
+          i++;
+        if (i < text.size() && text[i] == ':')
+        {
+          key = s;
+          i++;
+          continue;
+        }
+        if (key == "benchmark")
+          benchmark = s;
+        row[key] = s;
+        continue;
+      }
+      if (c == '{')
+        row.clear();
+      else if (c == '}')
+        add(results, benchmark, row);
+      else if (
+        !key.empty() && (isalnum(static_cast<unsigned char>(c)) || c == '-'))
+      {
+        size_t end = text.find_first_of(",}] \n\r\t", i);
+        if (end == std::string::npos)
+          return false;
+        row[key] = text.substr(i, end - i);
+        key.clear();
+        i = end;
+        continue;
+      }
+      i++;
+    }
+    return true;
+  }
+
+  bool load(const char* path, Results& results)
+  {
+    std::string text;
+    if (!read_file(path, text))
+      return false;
+
+    size_t first = text.find_first_not_of(" \n\r\t");
+    bool ok = first != std::string::npos && text[first] == '{' ?
+      parse_json(text, results) :
+      parse_csv(text, results);
+    if (!ok)
+      fprintf(stderr, "%s: not a results file\n", path);
+    return ok;
+  }
+
+  bool value(const Row& row, const std::string& metric, double& out)
+  {
+    auto it = row.find(metric);
+    if (it == row.end())
+      return false;
+    char* end;
+    out = strtod(it->second.c_str(), &end);
+    return end != it->second.c_str();
+  }
+} // namespace
+
+int main(int argc, char** argv)
+{
+  opt::Opt opt(argc, argv);
+  std::string metric =
+    opt.is("--metric", static_cast<const char*>("p50_ns"));
+  double threshold =
+    strtod(opt.is("--threshold", static_cast<const char*>("5")), nullptr);
+
+  // The two positional arguments, skipping options and their values.
+  std::vector<const char*> files;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strncmp(argv[i], "--", 2) == 0)
+    {
+      if (strchr(argv[i], '=') == nullptr)
+        i++;
+      continue;
+    }
+    files.push_back(argv[i]);
+  }
+  if (files.size() != 2)
+  {
+    fprintf(
+      stderr,
+      "usage: %s [--metric M] [--threshold PCT] BASELINE CURRENT\n",
+      argv[0]);
+    return 2;
+  }
+
+  Results baseline;
+  Results current;
+  if (!load(files[0], baseline) || !load(files[1], current))
+    return 2;
+
+  bool higher_is_better = metric == "ops_per_sec";
+  size_t regressions = 0;
+  size_t compared = 0;
+
+  printf("%-56s %14s %14s %9s\n", "case", "baseline", "current", "change");
+  for (auto& [name, row] : current)
+  {
+    auto it = baseline.find(name);
+    double now;
+    if (!value(row, metric, now))
+      continue;
+    if (it == baseline.end())
+    {
+      printf("%-56s %14s %14.3f %9s\n", name.c_str(), "-", now, "new");
+      continue;
+    }
+    double before;
+    if (!value(it->second, metric, before))
+      continue;
+
+    compared++;
+    double change = before == 0 ? 0 : (now - before) * 100 / before;
+    double worse = higher_is_better ? -change : change;
+    bool regressed = worse > threshold;
+    regressions += regressed ? 1 : 0;
+    printf(
+      "%-56s %14.3f %14.3f %+8.1f%%%s\n",
+      name.c_str(),
+      before,
+      now,
+      change,
+      regressed ? "  REGRESSION" : "");
+  }
+  for (auto& [name, row] : baseline)
+  {
+    if (current.count(name) == 0)
+      printf("%-56s %14s %14s %9s\n", name.c_str(), "", "-", "missing");
+  }
+
+  printf(
+    "%zu cases compared on %s, %zu regressed by more than %g%%\n",
+    compared,
+    metric.c_str(),
+    regressions,
+    threshold);
+  return regressions == 0 ? 0 : 1;
+}
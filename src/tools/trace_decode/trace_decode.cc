@@ -0,0 +1,128 @@
+/**
+ * Decodes event traces written by `snmalloc::trace_flush` in builds with
+ * SNMALLOC_EVENT_TRACE.
+ *
+ *   snmalloc-trace-decode [--summary] FILE
+ *
+ * prints one line per event:
+ *
+ *   <allocator> <tick> <event> sc=<sizeclass> n=<count> bytes=<bytes>
+ *     target=<allocator>
+ *
+ * followed, or with --summary only, by the number of each event and of
+ * events lost to full rings.  Ticks are in `Aal::tick` units; each flush is
+ * also printed with its tick and wall-clock time, to relate the two.
+ */
+
+#include <inttypes.h>
+#include <snmalloc/snmalloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace snmalloc;
+
+namespace
+{
+  struct Printer
+  {
+    bool summary_only = false;
+    uint64_t counts[TRACE_EVENT_COUNT]{};
+    uint64_t flushes = 0;
+    uint64_t dropped = 0;
+
+    void flush(const TraceFlushHeader& h)
+    {
+      flushes++;
+      if (!summary_only)
+        printf(
+          "# flush tick=%" PRIu64 " time_ms=%" PRIu64 " rings=%" PRIu64 "\n",
+          h.tick,
+          h.time_ms,
+          h.rings);
+    }
+
+    void ring(const TraceRingHeader& h)
+    {
+      dropped += h.dropped;
+      if (!summary_only && h.dropped != 0)
+        printf("# 0x%" PRIx64 " dropped %" PRIu64 "\n", h.owner, h.dropped);
+    }
+
+    void record(const TraceRingHeader& h, const TraceRecord& r)
+    {
+      auto event = static_cast<size_t>(r.event);
+      if (event < TRACE_EVENT_COUNT)
+        counts[event]++;
+
+      if (summary_only)
+        return;
+
+      printf(
+        "0x%" PRIx64 " %" PRIu64 " %s sc=%u n=%u bytes=%" PRIu64
+        " target=0x%" PRIx64 "\n",
+        h.owner,
+        r.timestamp,
+        trace_event_name(r.event),
+        static_cast<unsigned>(r.sizeclass),
+        static_cast<unsigned>(r.count),
+        r.bytes,
+        r.target);
+    }
+
+    void print_summary()
+    {
+      printf("# %" PRIu64 " flushes\n", flushes);
+      for (size_t i = 1; i < TRACE_EVENT_COUNT; i++)
+        printf(
+          "# %-14s %" PRIu64 "\n",
+          trace_event_name(static_cast<TraceEvent>(i)),
+          counts[i]);
+      printf("# %-14s %" PRIu64 "\n", "dropped", dropped);
+    }
+  };
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Printer printer;
+  const char* path = nullptr;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--summary") == 0)
+      printer.summary_only = true;
+    else
+      path = argv[i];
+  }
+
+  if (path == nullptr)
+  {
+    fprintf(stderr, "usage: %s [--summary] FILE\n", argv[0]);
+    return 2;
+  }
+
+  FILE* f = fopen(path, "rb");
+  if (f == nullptr)
+  {
+    perror(path);
+    return 1;
+  }
+
+  std::vector<char> data;
+  char buffer[1 << 16];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), f)) != 0)
+    data.insert(data.end(), buffer, buffer + n);
+  fclose(f);
+
+  bool ok = trace_decode(data.data(), data.size(), printer);
+  printer.print_summary();
+
+  if (!ok)
+  {
+    fprintf(stderr, "%s: malformed or truncated trace\n", path);
+    return 1;
+  }
+  return 0;
+}